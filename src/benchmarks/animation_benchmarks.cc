@@ -0,0 +1,134 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include "drawable/model_animation.h"
+#include "job_system.h"
+
+namespace ts {
+
+// Each sampling benchmark takes the number of channels and of workers.
+static void ChannelCountArguments(benchmark::internal::Benchmark* benchmark) {
+  const auto workers =
+      static_cast<int64_t>(JobSystem::GetDefaultWorkerCount());
+  benchmark->ArgsProduct({{1000, 10000, 100000}, {0, workers}});
+  benchmark->Unit(benchmark::kMicrosecond);
+  benchmark->UseRealTime();
+}
+
+// Linearly interpolated channels that animate the translation, rotation and
+// scale of each node in turn.
+struct RandomAnimation {
+  ModelRig rig;
+  std::vector<AnimationChannel> channels;
+};
+
+static RandomAnimation MakeRandomAnimation(size_t channel_count) {
+  constexpr size_t kKeyCount = 32u;
+  std::mt19937 generator(42u);
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  RandomAnimation animation;
+  animation.rig.rest_pose.resize((channel_count + 2u) / 3u);
+  for (size_t i = 0; i < channel_count; i++) {
+    AnimationChannel channel;
+    channel.node = i / 3u;
+    channel.path = static_cast<AnimationPath>(i % 3u);
+    for (size_t key = 0; key < kKeyCount; key++) {
+      channel.times.push_back(key / 30.0f);
+      glm::vec4 value = {distribution(generator), distribution(generator),
+                         distribution(generator), distribution(generator)};
+      if (channel.path == AnimationPath::kRotation) {
+        value = glm::normalize(value);
+      } else {
+        value.w = 0.0f;
+      }
+      channel.values.push_back(value);
+    }
+    animation.channels.push_back(std::move(channel));
+  }
+  return animation;
+}
+
+// What the sampler must produce for a channel.
+static glm::vec4 SampleReference(const AnimationChannel& channel, float time) {
+  const auto next =
+      std::upper_bound(channel.times.begin(), channel.times.end(), time) -
+      channel.times.begin();
+  const auto previous = next - 1;
+  const auto t = (time - channel.times[previous]) /
+                 (channel.times[next] - channel.times[previous]);
+  const auto& a = channel.values[previous];
+  const auto& b = channel.values[next];
+  if (channel.path != AnimationPath::kRotation) {
+    return glm::mix(a, b, t);
+  }
+  const auto q = glm::normalize(glm::slerp(glm::quat{a.w, a.x, a.y, a.z},
+                                           glm::quat{b.w, b.x, b.y, b.z}, t));
+  return {q.x, q.y, q.z, q.w};
+}
+
+static bool MatchesReference(const RandomAnimation& random,
+                             const std::vector<ModelNodeTransform>& pose,
+                             float time) {
+  for (const auto& channel : random.channels) {
+    const auto expected = SampleReference(channel, time);
+    const auto& transform = pose[channel.node];
+    glm::vec4 actual = {};
+    switch (channel.path) {
+      case AnimationPath::kTranslation:
+        actual = glm::vec4{transform.translation, 0.0f};
+        break;
+      case AnimationPath::kRotation:
+        actual = glm::vec4{transform.rotation.x, transform.rotation.y,
+                           transform.rotation.z, transform.rotation.w};
+        break;
+      case AnimationPath::kScale:
+        actual = glm::vec4{transform.scale, 0.0f};
+        break;
+    }
+    if (glm::any(glm::greaterThan(glm::abs(actual - expected),
+                                  glm::vec4{1e-4f}))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void BM_MakeModelAnimation(benchmark::State& state) {
+  const auto random = MakeRandomAnimation(state.range(0));
+  for (auto _ : state) {
+    auto animation = MakeModelAnimation("Random", random.channels);
+    benchmark::DoNotOptimize(animation);
+  }
+  state.SetItemsProcessed(state.iterations() * random.channels.size());
+}
+BENCHMARK(BM_MakeModelAnimation)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_SampleAnimation(benchmark::State& state) {
+  const auto random = MakeRandomAnimation(state.range(0));
+  const auto animation = MakeModelAnimation("Random", random.channels);
+  JobSystem jobs(state.range(1));
+  std::vector<ModelNodeTransform> pose;
+
+  // Checked against glm before sampling over and over.
+  constexpr float kCheckTime = 0.51f;
+  SampleAnimation(random.rig, animation, kCheckTime, pose, jobs);
+  if (!MatchesReference(random, pose, kCheckTime)) {
+    state.SkipWithError("Pose doesn't match the reference.");
+    return;
+  }
+
+  float time = 0.0f;
+  for (auto _ : state) {
+    SampleAnimation(random.rig, animation, time, pose, jobs);
+    benchmark::DoNotOptimize(pose.data());
+    time += 1.0f / 60.0f;
+  }
+  state.SetItemsProcessed(state.iterations() * random.channels.size());
+}
+BENCHMARK(BM_SampleAnimation)->Apply(ChannelCountArguments);
+
+}  // namespace ts
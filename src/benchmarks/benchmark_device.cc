@@ -0,0 +1,30 @@
+#include "benchmarks/benchmark_device.h"
+
+#include <fml/logging.h>
+#include "shader_blob.h"
+
+namespace ts {
+
+static UniqueGPUDevice CreateBenchmarkDevice() {
+  // The video subsystem is still necessary to load the Vulkan library. The
+  // offscreen driver doesn't need a display server.
+  SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+  if (!SDL_Init(SDL_INIT_VIDEO)) {
+    FML_LOG(ERROR) << "Couldn't initialize SDL: " << SDL_GetError();
+    return {};
+  }
+  UniqueGPUDevice device(
+      ::SDL_CreateGPUDevice(kBundledShaderFormats, false, NULL));
+  if (!device.is_valid()) {
+    FML_LOG(ERROR) << "Could not create GPU device: " << SDL_GetError();
+    return {};
+  }
+  return device;
+}
+
+const UniqueGPUDevice& GetBenchmarkDevice() {
+  static UniqueGPUDevice device = CreateBenchmarkDevice();
+  return device;
+}
+
+}  // namespace ts
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "sdl_types.h"
+
+namespace ts {
+
+// A GPU device without a window shared by all benchmarks. The device is
+// invalid if none could be created, in which case the benchmarks that need
+// one are skipped.
+const UniqueGPUDevice& GetBenchmarkDevice();
+
+}  // namespace ts
@@ -0,0 +1,20 @@
+#include <benchmark/benchmark.h>
+#include "compute_pipeline.h"
+
+namespace ts {
+
+// The dispatch math for every pixel of square images of the given size.
+static void BM_MakeGroupCount(benchmark::State& state) {
+  const glm::ivec2 thread_count = {8, 8};
+  const int size = state.range(0);
+  for (auto _ : state) {
+    for (int y = 1; y <= size; y++) {
+      auto groups = MakeGroupCount(glm::ivec2{size, y}, thread_count);
+      benchmark::DoNotOptimize(groups);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_MakeGroupCount)->RangeMultiplier(4)->Range(64, 4096);
+
+}  // namespace ts
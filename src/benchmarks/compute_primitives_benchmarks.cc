@@ -0,0 +1,173 @@
+#include <benchmark/benchmark.h>
+#include <functional>
+#include <numeric>
+#include <random>
+#include "benchmarks/benchmark_device.h"
+#include "buffer.h"
+#include "compute_primitives.h"
+
+namespace ts {
+
+// Each compute primitive benchmark takes the number of items. Results are
+// checked against the CPU in tests/compute_primitives_unittests.cc.
+static void ItemCountArguments(benchmark::internal::Benchmark* benchmark) {
+  benchmark->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+  benchmark->Unit(benchmark::kMicrosecond);
+  benchmark->UseRealTime();
+}
+
+static ComputePrimitives* GetPrimitives(benchmark::State& state) {
+  const auto& device = GetBenchmarkDevice();
+  static ShaderLibrary library;
+  static std::unique_ptr<ComputePrimitives> primitives =
+      device.is_valid() ? std::make_unique<ComputePrimitives>(device, library)
+                        : nullptr;
+  if (!primitives || !primitives->IsValid()) {
+    state.SkipWithError("Could not create compute primitives.");
+    return nullptr;
+  }
+  return primitives.get();
+}
+
+static std::vector<uint32_t> MakeRandomItems(size_t count, uint32_t max) {
+  std::mt19937 generator(42u);
+  std::uniform_int_distribution<uint32_t> distribution(0u, max);
+  std::vector<uint32_t> items(count);
+  for (auto& item : items) {
+    item = distribution(generator);
+  }
+  return items;
+}
+
+static UniqueGPUBuffer UploadItems(const std::vector<uint32_t>& items) {
+  return PerformHostToDeviceTransfer(
+      GetBenchmarkDevice(), items,
+      SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ |
+          SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE);
+}
+
+// Records the work into a command buffer and waits for the device to finish
+// it.
+static bool RunAndWait(
+    const std::function<bool(SDL_GPUCommandBuffer*)>& record) {
+  auto device = GetBenchmarkDevice().get();
+  auto command_buffer = SDL_AcquireGPUCommandBuffer(device);
+  if (!command_buffer) {
+    return false;
+  }
+  if (!record(command_buffer)) {
+    SDL_CancelGPUCommandBuffer(command_buffer);
+    return false;
+  }
+  auto fence = SDL_SubmitGPUCommandBufferAndAcquireFence(command_buffer);
+  if (!fence) {
+    return false;
+  }
+  const auto waited = SDL_WaitForGPUFences(device, true, &fence, 1u);
+  SDL_ReleaseGPUFence(device, fence);
+  return waited;
+}
+
+static void BM_ExclusiveScan(benchmark::State& state) {
+  auto primitives = GetPrimitives(state);
+  if (!primitives) {
+    return;
+  }
+  const auto count = static_cast<Uint32>(state.range(0));
+  auto items = MakeRandomItems(count, 255u);
+  auto buffer = UploadItems(items);
+  auto scan = [&](SDL_GPUCommandBuffer* command_buffer) {
+    return primitives->ExclusiveScan(command_buffer, buffer.get().value,
+                                     count);
+  };
+
+  for (auto _ : state) {
+    if (!RunAndWait(scan)) {
+      state.SkipWithError("Could not scan.");
+      return;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ExclusiveScan)->Apply(ItemCountArguments);
+
+static void BM_Reduce(benchmark::State& state) {
+  auto primitives = GetPrimitives(state);
+  if (!primitives) {
+    return;
+  }
+  const auto count = static_cast<Uint32>(state.range(0));
+  auto items = MakeRandomItems(count, 0xffffffffu);
+  auto input = UploadItems(items);
+  auto result = UploadItems({0u});
+
+  for (auto _ : state) {
+    if (!RunAndWait([&](SDL_GPUCommandBuffer* command_buffer) {
+          return primitives->Reduce(command_buffer, input.get().value, count,
+                                    ReduceOperation::kSum, result.get().value);
+        })) {
+      state.SkipWithError("Could not reduce.");
+      return;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_Reduce)->Apply(ItemCountArguments);
+
+// Keeps about half of the items.
+static void BM_Compact(benchmark::State& state) {
+  auto primitives = GetPrimitives(state);
+  if (!primitives) {
+    return;
+  }
+  const auto count = static_cast<Uint32>(state.range(0));
+  auto values = MakeRandomItems(count, 0xffffffffu);
+  auto flags = MakeRandomItems(count, 1u);
+  auto values_buffer = UploadItems(values);
+  auto flags_buffer = UploadItems(flags);
+  auto output = UploadItems(std::vector<uint32_t>(count));
+  auto output_count = UploadItems({0u});
+  auto compact = [&](SDL_GPUCommandBuffer* command_buffer) {
+    return primitives->Compact(command_buffer, values_buffer.get().value,
+                               flags_buffer.get().value, count,
+                               output.get().value, output_count.get().value);
+  };
+
+  for (auto _ : state) {
+    if (!RunAndWait(compact)) {
+      state.SkipWithError("Could not compact.");
+      return;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_Compact)->Apply(ItemCountArguments);
+
+static void BM_SortKeyValue(benchmark::State& state) {
+  auto primitives = GetPrimitives(state);
+  if (!primitives) {
+    return;
+  }
+  const auto count = static_cast<Uint32>(state.range(0));
+  auto keys = MakeRandomItems(count, 0xffffffffu);
+  std::vector<uint32_t> values(count);
+  std::iota(values.begin(), values.end(), 0u);
+  auto keys_buffer = UploadItems(keys);
+  auto values_buffer = UploadItems(values);
+  auto sort = [&](SDL_GPUCommandBuffer* command_buffer) {
+    return primitives->SortKeyValue(command_buffer, keys_buffer.get().value,
+                                    values_buffer.get().value, count);
+  };
+
+  // Sorting sorted keys costs the same since every pass moves every item.
+  for (auto _ : state) {
+    if (!RunAndWait(sort)) {
+      state.SkipWithError("Could not sort.");
+      return;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_SortKeyValue)->Apply(ItemCountArguments);
+
+}  // namespace ts
@@ -0,0 +1,38 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include "draw_queue.h"
+
+namespace ts {
+
+// Sorts packets spread over a handful of passes, pipelines and materials at
+// random depths. A fresh copy is sorted each iteration.
+static void BM_SortDrawPackets(benchmark::State& state) {
+  std::mt19937 generator(42u);
+  std::uniform_int_distribution<int> pass(0, 2);
+  std::uniform_int_distribution<int> pipeline(0, 15);
+  std::uniform_int_distribution<int> material(0, 63);
+  std::uniform_real_distribution<float> depth(0.1f, 100.0f);
+  std::vector<DrawPacket> unsorted;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    unsorted.push_back(DrawPacket{
+        .key = MakeDrawSortKey(static_cast<DrawPass>(pass(generator)),  //
+                               pipeline(generator),                     //
+                               material(generator),                     //
+                               depth(generator)                         //
+                               ),
+        .draw = static_cast<uint32_t>(i),
+    });
+  }
+  std::vector<DrawPacket> packets;
+  std::vector<DrawPacket> scratch;
+  for (auto _ : state) {
+    packets = unsorted;
+    SortDrawPackets(packets, scratch);
+    benchmark::DoNotOptimize(packets.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SortDrawPackets)->RangeMultiplier(8)->Range(64, 32768);
+
+}  // namespace ts
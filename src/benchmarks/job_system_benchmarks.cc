@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+#include "job_system.h"
+
+namespace ts {
+
+// Each job system benchmark takes the number of workers.
+static void WorkerCountArguments(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Arg(0);
+  for (int workers = 1; workers <= 16; workers *= 2) {
+    benchmark->Arg(workers);
+  }
+  benchmark->UseRealTime();
+}
+
+// Measures the overhead of scheduling and running jobs that do nothing.
+static void BM_RunEmptyJobs(benchmark::State& state) {
+  JobSystem jobs(state.range(0));
+  constexpr size_t kJobCount = 4096u;
+  for (auto _ : state) {
+    JobCounter counter;
+    for (size_t i = 0; i < kJobCount; i++) {
+      jobs.Run([]() {}, counter);
+    }
+    jobs.Wait(counter);
+  }
+  state.SetItemsProcessed(state.iterations() * kJobCount);
+}
+BENCHMARK(BM_RunEmptyJobs)->Apply(WorkerCountArguments);
+
+// Measures how a compute bound loop scales with the number of workers.
+static void BM_ParallelFor(benchmark::State& state) {
+  JobSystem jobs(state.range(0));
+  std::vector<float> values(1u << 20u, 2.0f);
+  for (auto _ : state) {
+    jobs.ParallelFor(values.size(), 4096u, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        values[i] = std::sqrt(values[i] * values[i] + 1.0f);
+      }
+    });
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_ParallelFor)->Apply(WorkerCountArguments);
+
+// Measures jobs that spawn and wait on their own jobs. Waiting threads run
+// the pending jobs so this doesn't deadlock.
+static void BM_NestedJobs(benchmark::State& state) {
+  JobSystem jobs(state.range(0));
+  constexpr size_t kOuterCount = 64u;
+  constexpr size_t kInnerCount = 64u;
+  for (auto _ : state) {
+    JobCounter outer;
+    for (size_t i = 0; i < kOuterCount; i++) {
+      jobs.Run(
+          [&]() {
+            JobCounter inner;
+            for (size_t j = 0; j < kInnerCount; j++) {
+              jobs.Run([]() {}, inner);
+            }
+            jobs.Wait(inner);
+          },
+          outer);
+    }
+    jobs.Wait(outer);
+  }
+  state.SetItemsProcessed(state.iterations() * kOuterCount * kInnerCount);
+}
+BENCHMARK(BM_NestedJobs)->Apply(WorkerCountArguments);
+
+}  // namespace ts
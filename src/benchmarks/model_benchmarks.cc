@@ -0,0 +1,194 @@
+#include <benchmark/benchmark.h>
+#include <tiny_gltf.h>
+#include "benchmarks/benchmark_device.h"
+#include "buffer.h"
+#include "drawable/model_loader.h"
+#include "drawable/model_renderer.h"
+
+namespace ts {
+
+// Each model benchmark takes the index of a model in the catalog.
+static void ModelCatalogArguments(benchmark::internal::Benchmark* benchmark) {
+  benchmark->DenseRange(0, GetModelCatalog().size() - 1);
+  benchmark->Unit(benchmark::kMillisecond);
+}
+
+static std::unique_ptr<fml::Mapping> MapCatalogModel(benchmark::State& state) {
+  const std::string name = GetModelCatalog()[state.range(0)];
+  state.SetLabel(name);
+  auto mapping = fml::FileMapping::CreateReadOnly(fml::paths::JoinPaths(
+      {MODELS_LOCATION, name, "glTF-Binary", name + ".glb"}));
+  if (!mapping) {
+    state.SkipWithError("Could not map model. Are the submodules synced?");
+    return nullptr;
+  }
+  return mapping;
+}
+
+static std::unique_ptr<tinygltf::Model> ParseCatalogModel(
+    benchmark::State& state) {
+  auto mapping = MapCatalogModel(state);
+  if (!mapping) {
+    return nullptr;
+  }
+  auto model = ParseModel(*mapping);
+  if (!model) {
+    state.SkipWithError("Could not parse model.");
+    return nullptr;
+  }
+  return model;
+}
+
+// Parsing includes decoding all images embedded in the model.
+static void BM_ParseModel(benchmark::State& state) {
+  auto mapping = MapCatalogModel(state);
+  if (!mapping) {
+    return;
+  }
+  for (auto _ : state) {
+    auto model = ParseModel(*mapping);
+    if (!model) {
+      state.SkipWithError("Could not parse model.");
+      return;
+    }
+    benchmark::DoNotOptimize(model);
+  }
+  state.SetBytesProcessed(state.iterations() * mapping->GetSize());
+}
+BENCHMARK(BM_ParseModel)->Apply(ModelCatalogArguments);
+
+static void BM_ReadModelGeometry(benchmark::State& state) {
+  auto model = ParseCatalogModel(state);
+  if (!model) {
+    return;
+  }
+  size_t vertex_count = 0u;
+  for (auto _ : state) {
+    auto geometry = ReadModelGeometry(*model);
+    vertex_count = geometry.vertices.size();
+    benchmark::DoNotOptimize(geometry);
+  }
+  state.SetItemsProcessed(state.iterations() * vertex_count);
+}
+BENCHMARK(BM_ReadModelGeometry)->Apply(ModelCatalogArguments);
+
+static void BM_DecodeModelImages(benchmark::State& state) {
+  auto model = ParseCatalogModel(state);
+  if (!model) {
+    return;
+  }
+  // The images have already been decoded by the parser. Decode them again
+  // from the encoded bytes in their buffer views.
+  std::vector<std::pair<const unsigned char*, int>> encoded_images;
+  for (const auto& image : model->images) {
+    if (image.bufferView < 0) {
+      continue;
+    }
+    const auto& view = model->bufferViews[image.bufferView];
+    const auto& buffer = model->buffers[view.buffer];
+    encoded_images.emplace_back(buffer.data.data() + view.byteOffset,
+                                static_cast<int>(view.byteLength));
+  }
+  if (encoded_images.empty()) {
+    state.SkipWithError("Model has no embedded images.");
+    return;
+  }
+  size_t encoded_size = 0u;
+  for (const auto& [data, size] : encoded_images) {
+    encoded_size += size;
+  }
+  for (auto _ : state) {
+    int index = 0;
+    for (const auto& [data, size] : encoded_images) {
+      tinygltf::Image image;
+      std::string error;
+      std::string warning;
+      if (!tinygltf::LoadImageData(&image, index++, &error, &warning, 0, 0,
+                                   data, size, nullptr)) {
+        state.SkipWithError("Could not decode image.");
+        return;
+      }
+      benchmark::DoNotOptimize(image.image.data());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * encoded_size);
+}
+BENCHMARK(BM_DecodeModelImages)->Apply(ModelCatalogArguments);
+
+// Measures staging the repacked geometry through a transfer buffer and
+// waiting for the copies to land.
+static void BM_UploadModelGeometry(benchmark::State& state) {
+  const auto& device = GetBenchmarkDevice();
+  if (!device.is_valid()) {
+    state.SkipWithError("Could not create a GPU device.");
+    return;
+  }
+  auto model = ParseCatalogModel(state);
+  if (!model) {
+    return;
+  }
+  const auto geometry = ReadModelGeometry(*model);
+  for (auto _ : state) {
+    auto vertex_buffer =
+        PerformHostToDeviceTransfer(device,                     //
+                                    geometry.vertices,          //
+                                    SDL_GPU_BUFFERUSAGE_VERTEX  //
+        );
+    auto index_buffer =
+        PerformHostToDeviceTransfer(device,                    //
+                                    geometry.indices,          //
+                                    SDL_GPU_BUFFERUSAGE_INDEX  //
+        );
+    if (!vertex_buffer.is_valid() || !index_buffer.is_valid()) {
+      state.SkipWithError("Could not upload geometry.");
+      return;
+    }
+    SDL_WaitForGPUIdle(device.get());
+  }
+  state.SetBytesProcessed(
+      state.iterations() *
+      (geometry.vertices.size() * sizeof(ModelVertex) +
+       geometry.indices.size() * sizeof(uint32_t)));
+}
+BENCHMARK(BM_UploadModelGeometry)->Apply(ModelCatalogArguments);
+
+// Measures staging the decoded images of the model into sampled textures.
+static void BM_UploadModelImages(benchmark::State& state) {
+  const auto& device = GetBenchmarkDevice();
+  if (!device.is_valid()) {
+    state.SkipWithError("Could not create a GPU device.");
+    return;
+  }
+  auto model = ParseCatalogModel(state);
+  if (!model) {
+    return;
+  }
+  size_t image_size = 0u;
+  for (auto _ : state) {
+    image_size = 0u;
+    for (const auto& image : model->images) {
+      auto format =
+          PickImageFormat(image.component, image.pixel_type, image.bits);
+      if (!format.has_value()) {
+        continue;
+      }
+      auto texture = PerformHostToDeviceTransferTexture2D(
+          device.get(), format.value(), {image.width, image.height},
+          image.image.data(), image.image.size());
+      if (!texture.IsValid()) {
+        state.SkipWithError("Could not upload image.");
+        return;
+      }
+      image_size += image.image.size();
+    }
+    SDL_WaitForGPUIdle(device.get());
+  }
+  if (image_size == 0u) {
+    state.SkipWithError("Model has no images that may be uploaded.");
+    return;
+  }
+  state.SetBytesProcessed(state.iterations() * image_size);
+}
+BENCHMARK(BM_UploadModelImages)->Apply(ModelCatalogArguments);
+
+}  // namespace ts
@@ -1,6 +1,9 @@
 #include "buffer.h"
 
 #include <fml/closure.h>
+#include <algorithm>
+#include "frame_counters.h"
+#include "profiler.h"
 
 namespace ts {
 
@@ -27,9 +30,29 @@ struct ScopedCopyPass {
     if (copy_pass_) {
       SDL_EndGPUCopyPass(copy_pass_);
       SDL_SubmitGPUCommandBuffer(command_buffer_);
+      CountSubmission();
     }
   }
 
+  // Ends the pass early and submits the command buffer. The returned fence
+  // signals once the copies have completed on the device.
+  SDL_GPUFence* SubmitAndAcquireFence() {
+    if (!copy_pass_) {
+      return nullptr;
+    }
+    SDL_EndGPUCopyPass(copy_pass_);
+    copy_pass_ = nullptr;
+    auto fence = SDL_SubmitGPUCommandBufferAndAcquireFence(command_buffer_);
+    CountSubmission();
+    if (!fence) {
+      FML_LOG(ERROR) << "Could not submit command buffer: " << SDL_GetError();
+      return nullptr;
+    }
+    GPUMemoryTracker::GetInstance().TrackCreation(GPUResourceCategory::kFence,
+                                                  fence);
+    return fence;
+  }
+
   bool IsValid() const { return !!copy_pass_; }
 
   SDL_GPUCopyPass* GetPass() const { return copy_pass_; }
@@ -42,6 +65,34 @@ struct ScopedCopyPass {
   FML_DISALLOW_COPY_ASSIGN_AND_MOVE(ScopedCopyPass);
 };
 
+static size_t EstimateTextureSize(const SDL_GPUTextureCreateInfo& info) {
+  size_t size = 0u;
+  for (Uint32 level = 0u; level < info.num_levels; level++) {
+    // Only the depth of 3D textures shrinks with each level. Layers don't.
+    const auto depth = info.type == SDL_GPU_TEXTURETYPE_3D
+                           ? std::max(info.layer_count_or_depth >> level, 1u)
+                           : info.layer_count_or_depth;
+    size += SDL_CalculateGPUTextureFormatSize(
+        info.format, std::max(info.width >> level, 1u),
+        std::max(info.height >> level, 1u), depth);
+  }
+  switch (info.sample_count) {
+    case SDL_GPU_SAMPLECOUNT_1:
+      return size;
+    case SDL_GPU_SAMPLECOUNT_2:
+      return size * 2u;
+    case SDL_GPU_SAMPLECOUNT_4:
+      return size * 4u;
+    case SDL_GPU_SAMPLECOUNT_8:
+      return size * 8u;
+  }
+  return size;
+}
+
+size_t GPUTexture::GetSize() const {
+  return IsValid() ? EstimateTextureSize(info) : 0u;
+}
+
 GPUTexture CreateGPUTexture(SDL_GPUDevice* device,
                             glm::ivec3 dims,
                             SDL_GPUTextureType type,
@@ -63,6 +114,9 @@ GPUTexture CreateGPUTexture(SDL_GPUDevice* device,
     FML_LOG(ERROR) << "Could not create texture: " << SDL_GetError();
     return {};
   }
+  GPUMemoryTracker::GetInstance().TrackCreation(GPUResourceCategory::kTexture,
+                                                texture,
+                                                EstimateTextureSize(info));
   UniqueGPUTexture::element_type res = {};
   res.device = device;
   res.value = texture;
@@ -88,6 +142,8 @@ UniqueGPUBuffer CreateGPUBuffer(SDL_GPUDevice* device,
     FML_LOG(ERROR) << "Could not create graphics buffer: " << SDL_GetError();
     return {};
   }
+  GPUMemoryTracker::GetInstance().TrackCreation(GPUResourceCategory::kBuffer,
+                                                element.value, size);
   return UniqueGPUBuffer{element};
 }
 
@@ -95,6 +151,7 @@ static UniqueGPUBuffer PerformHostToDeviceTransfer(
     const UniqueGPUTransferBuffer& xfer_buffer,
     Uint32 size,
     SDL_GPUBufferUsageFlags usage) {
+  TS_PROFILE_SCOPE("PerformHostToDeviceTransfer");
   auto buffer = CreateGPUBuffer(xfer_buffer.get().device, size, usage);
   if (!buffer.is_valid()) {
     return {};
@@ -129,16 +186,17 @@ UniqueGPUBuffer PerformHostToDeviceTransfer(const UniqueGPUDevice& device,
   return PerformHostToDeviceTransfer(xfer_buffer, size, usage);
 }
 
-UniqueGPUTransferBuffer PopulateGPUTransferBuffer(SDL_GPUDevice* device,
-                                                  const uint8_t* data,
-                                                  size_t data_size) {
-  if (data_size == 0) {
+UniqueGPUTransferBuffer CreateGPUTransferBuffer(
+    SDL_GPUDevice* device,
+    Uint32 size,
+    SDL_GPUTransferBufferUsage usage) {
+  if (size == 0) {
     FML_LOG(ERROR) << "Could not create zero sized transfer buffer.";
     return {};
   }
   SDL_GPUTransferBufferCreateInfo info = {};
-  info.size = data_size;
-  info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+  info.size = size;
+  info.usage = usage;
   UniqueGPUTransferBuffer::element_type value;
   value.device = device;
   value.value = SDL_CreateGPUTransferBuffer(device, &info);
@@ -146,7 +204,19 @@ UniqueGPUTransferBuffer PopulateGPUTransferBuffer(SDL_GPUDevice* device,
     FML_LOG(ERROR) << "Could not create transfer buffer: " << SDL_GetError();
     return {};
   }
-  UniqueGPUTransferBuffer buffer(value);
+  GPUMemoryTracker::GetInstance().TrackCreation(
+      GPUResourceCategory::kTransferBuffer, value.value, size);
+  return UniqueGPUTransferBuffer{value};
+}
+
+UniqueGPUTransferBuffer PopulateGPUTransferBuffer(SDL_GPUDevice* device,
+                                                  const uint8_t* data,
+                                                  size_t data_size) {
+  auto buffer = CreateGPUTransferBuffer(device, data_size,
+                                        SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD);
+  if (!buffer.is_valid()) {
+    return {};
+  }
   auto memory = SDL_MapGPUTransferBuffer(device, buffer.get().value, false);
   if (!memory) {
     FML_LOG(ERROR) << "Could not map buffer: " << SDL_GetError();
@@ -162,6 +232,7 @@ GPUTexture PerformHostToDeviceTransferTexture2D(SDL_GPUDevice* device,
                                                 glm::ivec2 dims,
                                                 const uint8_t* data,
                                                 size_t data_size) {
+  TS_PROFILE_SCOPE("PerformHostToDeviceTransferTexture2D");
   auto texture = CreateGPUTexture(device,                          //
                                   glm::ivec3{dims.x, dims.y, 1u},  //
                                   SDL_GPU_TEXTURETYPE_2D,          //
@@ -199,4 +270,190 @@ GPUTexture PerformHostToDeviceTransferTexture2D(SDL_GPUDevice* device,
   return texture;
 }
 
+BufferReadback::BufferReadback() = default;
+
+BufferReadback::BufferReadback(UniqueGPUTransferBuffer transfer_buffer,
+                               UniqueGPUFence fence,
+                               Uint32 size)
+    : transfer_buffer_(std::move(transfer_buffer)),
+      fence_(std::move(fence)),
+      size_(size) {}
+
+BufferReadback::~BufferReadback() = default;
+
+BufferReadback::BufferReadback(BufferReadback&&) = default;
+
+BufferReadback& BufferReadback::operator=(BufferReadback&&) = default;
+
+bool BufferReadback::IsValid() const {
+  return transfer_buffer_.is_valid() && fence_.is_valid();
+}
+
+bool BufferReadback::IsReady() const {
+  if (!IsValid()) {
+    return false;
+  }
+  return SDL_QueryGPUFence(fence_.get().device, fence_.get().value);
+}
+
+std::optional<std::vector<uint8_t>> BufferReadback::Take() {
+  TS_PROFILE_SCOPE("BufferReadback::Take");
+  if (!IsValid()) {
+    return std::nullopt;
+  }
+  // Released on return whatever happens.
+  auto transfer_buffer = std::move(transfer_buffer_);
+  auto fence = std::move(fence_);
+  auto device = fence.get().device;
+  if (!SDL_WaitForGPUFences(device, true, &fence.get().value, 1u)) {
+    FML_LOG(ERROR) << "Could not wait for readback: " << SDL_GetError();
+    return std::nullopt;
+  }
+  auto memory =
+      SDL_MapGPUTransferBuffer(device, transfer_buffer.get().value, false);
+  if (!memory) {
+    FML_LOG(ERROR) << "Could not map buffer: " << SDL_GetError();
+    return std::nullopt;
+  }
+  FML_DEFER(SDL_UnmapGPUTransferBuffer(device, transfer_buffer.get().value));
+  std::vector<uint8_t> data(size_);
+  ::memcpy(data.data(), memory, size_);
+  return data;
+}
+
+TextureReadback::TextureReadback() = default;
+
+TextureReadback::TextureReadback(BufferReadback readback,
+                                 glm::ivec2 size,
+                                 SDL_GPUTextureFormat format)
+    : readback_(std::move(readback)), size_(size), format_(format) {}
+
+TextureReadback::~TextureReadback() = default;
+
+TextureReadback::TextureReadback(TextureReadback&&) = default;
+
+TextureReadback& TextureReadback::operator=(TextureReadback&&) = default;
+
+bool TextureReadback::IsValid() const {
+  return readback_.IsValid();
+}
+
+bool TextureReadback::IsReady() const {
+  return readback_.IsReady();
+}
+
+std::optional<HostTexture> TextureReadback::Take() {
+  auto pixels = readback_.Take();
+  if (!pixels.has_value()) {
+    return std::nullopt;
+  }
+  HostTexture result;
+  result.size = size_;
+  result.format = format_;
+  result.pixels = std::move(pixels.value());
+  return result;
+}
+
+// Takes ownership of the fence the copy pass was submitted with.
+static UniqueGPUFence SubmitReadback(SDL_GPUDevice* device,
+                                     ScopedCopyPass& copy_pass) {
+  UniqueGPUFence::element_type fence;
+  fence.device = device;
+  fence.value = copy_pass.SubmitAndAcquireFence();
+  if (!fence.value) {
+    return {};
+  }
+  return UniqueGPUFence{fence};
+}
+
+BufferReadback PerformDeviceToHostTransfer(const UniqueGPUBuffer& buffer,
+                                           Uint32 offset,
+                                           Uint32 size) {
+  TS_PROFILE_SCOPE("PerformDeviceToHostTransfer");
+  if (!buffer.is_valid()) {
+    return {};
+  }
+  auto device = buffer.get().device;
+  auto xfer_buffer = CreateGPUTransferBuffer(
+      device, size, SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD);
+  if (!xfer_buffer.is_valid()) {
+    return {};
+  }
+
+  ScopedCopyPass copy_pass(device);
+  if (!copy_pass.IsValid()) {
+    return {};
+  }
+  const auto src = SDL_GPUBufferRegion{
+      .buffer = buffer.get().value,
+      .offset = offset,
+      .size = size,
+  };
+  const auto dst = SDL_GPUTransferBufferLocation{
+      .transfer_buffer = xfer_buffer.get().value,
+      .offset = 0u,
+  };
+  SDL_DownloadFromGPUBuffer(copy_pass.GetPass(), &src, &dst);
+  auto fence = SubmitReadback(device, copy_pass);
+  if (!fence.is_valid()) {
+    return {};
+  }
+  return BufferReadback{std::move(xfer_buffer), std::move(fence), size};
+}
+
+TextureReadback PerformDeviceToHostTransferTexture2DAsync(
+    const GPUTexture& texture) {
+  TS_PROFILE_SCOPE("PerformDeviceToHostTransferTexture2DAsync");
+  if (!texture.IsValid()) {
+    return {};
+  }
+  auto device = texture.texture.get().device;
+  const auto dims = glm::ivec2{texture.info.width, texture.info.height};
+  const auto data_size = SDL_CalculateGPUTextureFormatSize(
+      texture.info.format, dims.x, dims.y, 1u);
+  if (data_size == 0) {
+    FML_LOG(ERROR) << "Could not read back zero sized texture.";
+    return {};
+  }
+
+  auto xfer_buffer = CreateGPUTransferBuffer(
+      device, data_size, SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD);
+  if (!xfer_buffer.is_valid()) {
+    return {};
+  }
+
+  ScopedCopyPass copy_pass(device);
+  if (!copy_pass.IsValid()) {
+    return {};
+  }
+  const auto src = SDL_GPUTextureRegion{
+      .texture = texture.texture.get().value,
+      .w = static_cast<Uint32>(dims.x),
+      .h = static_cast<Uint32>(dims.y),
+      .d = 1,
+  };
+  const auto dst = SDL_GPUTextureTransferInfo{
+      .transfer_buffer = xfer_buffer.get().value,
+      .pixels_per_row = static_cast<Uint32>(dims.x),
+      .rows_per_layer = static_cast<Uint32>(dims.y),
+  };
+  SDL_DownloadFromGPUTexture(copy_pass.GetPass(), &src, &dst);
+  auto fence = SubmitReadback(device, copy_pass);
+  if (!fence.is_valid()) {
+    return {};
+  }
+  return TextureReadback{
+      BufferReadback{std::move(xfer_buffer), std::move(fence),
+                     static_cast<Uint32>(data_size)},
+      dims,
+      texture.info.format,
+  };
+}
+
+std::optional<HostTexture> PerformDeviceToHostTransferTexture2D(
+    const GPUTexture& texture) {
+  TS_PROFILE_SCOPE("PerformDeviceToHostTransferTexture2D");
+  return PerformDeviceToHostTransferTexture2DAsync(texture).Take();
+}
+
 }  // namespace ts
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <optional>
+#include <vector>
 #include "macros.h"
 #include "sdl_types.h"
 
@@ -16,6 +18,77 @@ struct GPUTexture {
       : info(info), texture(std::move(texture)) {}
 
   bool IsValid() const { return texture.is_valid(); }
+
+  // An estimate of the device memory the texture occupies.
+  size_t GetSize() const;
+};
+
+struct HostTexture {
+  glm::ivec2 size = {};
+  SDL_GPUTextureFormat format = SDL_GPU_TEXTUREFORMAT_INVALID;
+  std::vector<uint8_t> pixels;
+
+  size_t GetBytesPerRow() const {
+    return SDL_CalculateGPUTextureFormatSize(format, size.x, 1u, 1u);
+  }
+};
+
+// A copy from the device to host memory in flight. The fence is polled so
+// callers may check on the copy between frames without stalling.
+class BufferReadback {
+ public:
+  BufferReadback();
+
+  BufferReadback(UniqueGPUTransferBuffer transfer_buffer,
+                 UniqueGPUFence fence,
+                 Uint32 size);
+
+  ~BufferReadback();
+
+  BufferReadback(BufferReadback&&);
+
+  BufferReadback& operator=(BufferReadback&&);
+
+  bool IsValid() const;
+
+  // Whether the copy has completed. Never blocks.
+  bool IsReady() const;
+
+  // Blocks till the copy has completed and copies the data out. The readback
+  // is invalid afterwards.
+  std::optional<std::vector<uint8_t>> Take();
+
+ private:
+  UniqueGPUTransferBuffer transfer_buffer_;
+  UniqueGPUFence fence_;
+  Uint32 size_ = 0u;
+};
+
+// A buffer readback of the first mip level of a 2D texture.
+class TextureReadback {
+ public:
+  TextureReadback();
+
+  TextureReadback(BufferReadback readback,
+                  glm::ivec2 size,
+                  SDL_GPUTextureFormat format);
+
+  ~TextureReadback();
+
+  TextureReadback(TextureReadback&&);
+
+  TextureReadback& operator=(TextureReadback&&);
+
+  bool IsValid() const;
+
+  bool IsReady() const;
+
+  std::optional<HostTexture> Take();
+
+ private:
+  BufferReadback readback_;
+  glm::ivec2 size_ = {};
+  SDL_GPUTextureFormat format_ = SDL_GPU_TEXTUREFORMAT_INVALID;
 };
 
 [[nodiscard]]
@@ -52,6 +125,12 @@ template <class T>
   );
 }
 
+[[nodiscard]]
+UniqueGPUTransferBuffer CreateGPUTransferBuffer(
+    SDL_GPUDevice* device,
+    Uint32 size,
+    SDL_GPUTransferBufferUsage usage);
+
 [[nodiscard]]
 UniqueGPUTransferBuffer PopulateGPUTransferBuffer(SDL_GPUDevice* device,
                                                   const uint8_t* data,
@@ -64,4 +143,20 @@ UniqueGPUTransferBuffer PopulateGPUTransferBuffer(SDL_GPUDevice* device,
     const uint8_t* data,
     size_t data_size);
 
+// Starts copying a range of a buffer back to host memory. The copy is
+// submitted in its own command buffer after the work already submitted.
+[[nodiscard]] BufferReadback PerformDeviceToHostTransfer(
+    const UniqueGPUBuffer& buffer,
+    Uint32 offset,
+    Uint32 size);
+
+// Starts copying the first mip level of a 2D texture back to host memory.
+[[nodiscard]] TextureReadback PerformDeviceToHostTransferTexture2DAsync(
+    const GPUTexture& texture);
+
+// Copies the first mip level of a 2D texture back to host memory. This blocks
+// till the GPU is done with the copy.
+[[nodiscard]] std::optional<HostTexture> PerformDeviceToHostTransferTexture2D(
+    const GPUTexture& texture);
+
 }  // namespace ts
@@ -0,0 +1,70 @@
+#include "cached_compute_product.h"
+
+#include <fml/logging.h>
+#include "frame_counters.h"
+#include "gpu_memory.h"
+#include "profiler.h"
+
+namespace ts {
+
+CachedComputeProduct::CachedComputeProduct(const char* owner,
+                                           SDL_GPUTextureFormat format)
+    : owner_(owner), format_(format) {}
+
+CachedComputeProduct::~CachedComputeProduct() = default;
+
+void CachedComputeProduct::Invalidate() {
+  is_stale_ = true;
+}
+
+bool CachedComputeProduct::IsStale() const {
+  return is_stale_;
+}
+
+const GPUTexture& CachedComputeProduct::GetTexture() const {
+  return texture_;
+}
+
+bool CachedComputeProduct::Update(SDL_GPUDevice* device,
+                                  glm::ivec2 size,
+                                  const Producer& producer) {
+  TS_PROFILE_SCOPE("CachedComputeProduct::Update");
+  if (size.x <= 0 || size.y <= 0) {
+    return true;
+  }
+  const auto& info = texture_.info;
+  if (!texture_.IsValid() || static_cast<int>(info.width) != size.x ||
+      static_cast<int>(info.height) != size.y) {
+    TS_GPU_MEMORY_OWNER(owner_);
+    auto texture = CreateGPUTexture(device, {size.x, size.y, 1},
+                                    SDL_GPU_TEXTURETYPE_2D, format_,
+                                    SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_WRITE |
+                                        SDL_GPU_TEXTUREUSAGE_SAMPLER);
+    if (!texture.IsValid()) {
+      FML_LOG(ERROR) << "Could not resize compute product.";
+      return false;
+    }
+    // Frames in flight that sample the old texture keep it alive.
+    texture_ = std::move(texture);
+    is_stale_ = true;
+  }
+  if (!is_stale_) {
+    return true;
+  }
+
+  auto command_buffer = SDL_AcquireGPUCommandBuffer(device);
+  if (!command_buffer) {
+    FML_LOG(ERROR) << "Could not create command buffer: " << SDL_GetError();
+    return false;
+  }
+  const auto produced = producer(command_buffer, texture_);
+  if (!SDL_SubmitGPUCommandBuffer(command_buffer)) {
+    FML_LOG(ERROR) << "Could not submit command buffer: " << SDL_GetError();
+    return false;
+  }
+  CountSubmission();
+  is_stale_ = !produced;
+  return produced;
+}
+
+}  // namespace ts
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <functional>
+#include <glm/glm.hpp>
+#include "buffer.h"
+#include "sdl_types.h"
+
+namespace ts {
+
+// A storage texture written by compute work that is only recomputed when its
+// inputs change. The texture follows the size it is updated with and keeps
+// the previous result otherwise. So static products cost no GPU time.
+class CachedComputeProduct {
+ public:
+  // Records the work that writes the texture into the command buffer.
+  using Producer =
+      std::function<bool(SDL_GPUCommandBuffer*, const GPUTexture&)>;
+
+  // The owner is the GPU memory owner the texture is accounted to.
+  CachedComputeProduct(const char* owner, SDL_GPUTextureFormat format);
+
+  ~CachedComputeProduct();
+
+  // Marks the product stale. Call this when parameters or shaders change.
+  void Invalidate();
+
+  bool IsStale() const;
+
+  // Resizes the texture if the size changed and runs the producer in its own
+  // command buffer if the product is stale. The product stays stale if the
+  // producer fails. Empty sizes are ignored.
+  bool Update(SDL_GPUDevice* device,
+              glm::ivec2 size,
+              const Producer& producer);
+
+  // Invalid until the first successful update.
+  const GPUTexture& GetTexture() const;
+
+ private:
+  const char* owner_;
+  SDL_GPUTextureFormat format_;
+  GPUTexture texture_;
+  bool is_stale_ = true;
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(CachedComputeProduct);
+};
+
+}  // namespace ts
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace ts {
+
+// The view drawables render the scene from. Edited in the Viewport window or
+// driven by the camera path of the frame benchmark.
+struct Camera {
+  glm::vec3 eye = glm::vec3{0.0f, 0.0f, -5.0f};
+  // The vertical field of view in degrees.
+  float fov = 60.0f;
+};
+
+}  // namespace ts
@@ -9,12 +9,20 @@ ComputePipelineBuilder::~ComputePipelineBuilder() {}
 ComputePipeline ComputePipelineBuilder::Build(
     const UniqueGPUDevice& device) const {
   SDL_GPUComputePipelineCreateInfo info = {};
-  if (shader_) {
+  info.format = format_;
+  if (blob_) {
+    auto code = blob_->PickCode(SDL_GetGPUShaderFormats(device.get()));
+    if (!code.has_value()) {
+      return {};
+    }
+    info.code = code->data;
+    info.code_size = code->size;
+    info.format = code->format;
+  } else if (shader_) {
     info.code = shader_->GetMapping();
     info.code_size = shader_->GetSize();
   }
   info.entrypoint = entrypoint_.data();
-  info.format = format_;
   info.threadcount_x = dimensions_.x;
   info.threadcount_y = dimensions_.y;
   info.threadcount_z = dimensions_.z;
@@ -29,6 +37,8 @@ ComputePipeline ComputePipelineBuilder::Build(
     FML_LOG(ERROR) << "Could not create compute pipeline: " << SDL_GetError();
     return {};
   }
+  GPUMemoryTracker::GetInstance().TrackCreation(
+      GPUResourceCategory::kComputePipeline, pipeline);
   UniqueGPUComputePipeline::element_type res = {};
   res.device = device.get();
   res.value = pipeline;
@@ -40,6 +50,14 @@ ComputePipelineBuilder& ComputePipelineBuilder::SetShader(
     SDL_GPUShaderFormat format) {
   shader_ = shader;
   format_ = format;
+  blob_ = nullptr;
+  return *this;
+}
+
+ComputePipelineBuilder& ComputePipelineBuilder::SetShader(
+    const ShaderBlob* blob) {
+  blob_ = blob;
+  shader_ = nullptr;
   return *this;
 }
 
@@ -71,4 +89,21 @@ ComputePipelineBuilder& ComputePipelineBuilder::SetEntrypoint(
   return *this;
 }
 
+ComputePipelineBuilder& ComputePipelineBuilder::SetReflection(
+    const EntryPointReflection& reflection) {
+  FML_DCHECK(reflection.stage == ShaderStage::kCompute);
+  const auto& resources = reflection.resources;
+  return SetEntrypoint(reflection.name)
+      .SetDimensions({reflection.thread_count[0],  //
+                      reflection.thread_count[1],  //
+                      reflection.thread_count[2]})
+      .SetResourceCounts(resources.num_samplers,                    //
+                         resources.num_storage_textures,            //
+                         resources.num_storage_buffers,             //
+                         resources.num_readwrite_storage_textures,  //
+                         resources.num_readwrite_storage_buffers,   //
+                         resources.num_uniform_buffers              //
+      );
+}
+
 }  // namespace ts
@@ -3,6 +3,8 @@
 #include <fml/mapping.h>
 #include <glm/glm.hpp>
 #include "sdl_types.h"
+#include "shader_blob.h"
+#include "shader_reflection.h"
 
 namespace ts {
 
@@ -34,6 +36,10 @@ class ComputePipelineBuilder {
   ComputePipelineBuilder& SetShader(fml::Mapping* shader,
                                     SDL_GPUShaderFormat format);
 
+  // The code for a format supported by the device is picked from the blob when
+  // the pipeline is built.
+  ComputePipelineBuilder& SetShader(const ShaderBlob* blob);
+
   ComputePipelineBuilder& SetDimensions(glm::ivec3 dimensions);
 
   ComputePipelineBuilder& SetResourceCounts(
@@ -46,8 +52,12 @@ class ComputePipelineBuilder {
 
   ComputePipelineBuilder& SetEntrypoint(std::string entrypoint);
 
+  // Sets the entrypoint, dimensions and resource counts.
+  ComputePipelineBuilder& SetReflection(const EntryPointReflection& reflection);
+
  private:
   fml::Mapping* shader_ = nullptr;
+  const ShaderBlob* blob_ = nullptr;
   std::string entrypoint_;
   SDL_GPUShaderFormat format_ = SDL_GPU_SHADERFORMAT_MSL;
   glm::ivec3 dimensions_ = {1, 1, 1};
@@ -0,0 +1,283 @@
+#include "compute_primitives.h"
+
+#include <fml/logging.h>
+#include <algorithm>
+#include <utility>
+#include "buffer.h"
+#include "compute_primitives.slang.reflection.h"
+#include "frame_counters.h"
+#include "gpu_memory.h"
+#include "macros.h"
+#include "profiler.h"
+
+namespace ts {
+
+// Must match THREADS_PER_GROUP and ITEMS_PER_THREAD in
+// compute_primitives.slang.
+static constexpr Uint32 kThreadsPerGroup = 256u;
+static constexpr Uint32 kItemsPerThread = 4u;
+static constexpr Uint32 kItemsPerGroup = kThreadsPerGroup * kItemsPerThread;
+
+// Must match RADIX_BITS in compute_primitives.slang.
+static constexpr Uint32 kRadixBits = 4u;
+static constexpr Uint32 kRadixDigits = 1u << kRadixBits;
+
+static Uint32 GetGroupCount(Uint32 count) {
+  return std::max(MakeGroupCount(count, kItemsPerGroup), 1u);
+}
+
+static ComputePipeline BuildPipeline(const UniqueGPUDevice& device,
+                                     const ShaderBlob* blob,
+                                     const EntryPointReflection& reflection) {
+  auto pipeline = ComputePipelineBuilder{}
+                      .SetShader(blob)
+                      .SetReflection(reflection)
+                      .Build(device);
+  if (!pipeline.IsValid()) {
+    FML_LOG(ERROR) << "Could not build compute primitive " << reflection.name;
+  }
+  FML_DCHECK(pipeline.thread_count.x == static_cast<int>(kThreadsPerGroup));
+  return pipeline;
+}
+
+ComputePrimitives::ComputePrimitives(const UniqueGPUDevice& device,
+                                     const ShaderLibrary& library)
+    : device_(device.get()) {
+  TS_GPU_MEMORY_OWNER("ComputePrimitives");
+  auto blob = library.GetBlob("compute_primitives");
+  if (!blob) {
+    return;
+  }
+  namespace reflection = shaders::compute_primitives;
+  scan_blocks_ = BuildPipeline(device, blob.get(), reflection::kScanBlocks);
+  add_block_offsets_ =
+      BuildPipeline(device, blob.get(), reflection::kAddBlockOffsets);
+  reduce_ = BuildPipeline(device, blob.get(), reflection::kReduce);
+  compact_scatter_ =
+      BuildPipeline(device, blob.get(), reflection::kCompactScatter);
+  radix_count_ = BuildPipeline(device, blob.get(), reflection::kRadixCount);
+  radix_scatter_ = BuildPipeline(device, blob.get(), reflection::kRadixScatter);
+  is_valid_ = scan_blocks_.IsValid() && add_block_offsets_.IsValid() &&
+              reduce_.IsValid() && compact_scatter_.IsValid() &&
+              radix_count_.IsValid() && radix_scatter_.IsValid();
+}
+
+ComputePrimitives::~ComputePrimitives() = default;
+
+bool ComputePrimitives::IsValid() const {
+  return is_valid_;
+}
+
+SDL_GPUBuffer* ComputePrimitives::GetScratch(ScratchBuffer& scratch,
+                                             Uint32 count) {
+  count = std::max(count, 1u);
+  if (scratch.capacity < count) {
+    TS_GPU_MEMORY_OWNER("ComputePrimitives");
+    // Buffers still used by recorded work are kept alive by SDL.
+    scratch.buffer =
+        CreateGPUBuffer(device_, count * sizeof(Uint32),
+                        SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ |
+                            SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE);
+    scratch.capacity = scratch.buffer.is_valid() ? count : 0u;
+  }
+  return scratch.buffer.is_valid() ? scratch.buffer.get().value : nullptr;
+}
+
+SDL_GPUBuffer* ComputePrimitives::GetScratch(Scratch scratch, Uint32 count) {
+  return GetScratch(scratch_[static_cast<size_t>(scratch)], count);
+}
+
+bool ComputePrimitives::Dispatch(SDL_GPUCommandBuffer* command_buffer,
+                                 const ComputePipeline& pipeline,
+                                 std::initializer_list<SDL_GPUBuffer*> buffers,
+                                 const Uniforms& uniforms,
+                                 Uint32 group_count) {
+  std::array<SDL_GPUStorageBufferReadWriteBinding, 5u> bindings = {};
+  FML_DCHECK(buffers.size() <= bindings.size());
+  size_t binding_count = 0u;
+  for (auto buffer : buffers) {
+    if (!buffer) {
+      return false;
+    }
+    bindings[binding_count++].buffer = buffer;
+  }
+  // Each dispatch gets its own pass so that it sees the writes of the
+  // previous one.
+  auto pass = SDL_BeginGPUComputePass(command_buffer, nullptr, 0u,
+                                      bindings.data(), binding_count);
+  if (!pass) {
+    FML_LOG(ERROR) << "Could not create compute pass: " << SDL_GetError();
+    return false;
+  }
+  FML_DEFER(SDL_EndGPUComputePass(pass));
+  SDL_BindGPUComputePipeline(pass, pipeline.pipeline.get().value);
+  CountPipelineBind();
+  SDL_PushGPUComputeUniformData(command_buffer, 0u, &uniforms,
+                                sizeof(uniforms));
+  SDL_DispatchGPUCompute(pass, group_count, 1u, 1u);
+  CountDispatch();
+  return true;
+}
+
+bool ComputePrimitives::ScanLevel(SDL_GPUCommandBuffer* command_buffer,
+                                  SDL_GPUBuffer* data,
+                                  Uint32 count,
+                                  size_t level) {
+  const auto group_count = GetGroupCount(count);
+  if (scan_levels_.size() <= level) {
+    scan_levels_.resize(level + 1u);
+  }
+  auto totals = GetScratch(scan_levels_[level], group_count);
+  const auto uniforms = Uniforms{.count = count};
+  if (!Dispatch(command_buffer, scan_blocks_, {data, totals}, uniforms,
+                group_count)) {
+    return false;
+  }
+  // A single group is already scanned. Otherwise scan the group totals to
+  // find the offset of each group.
+  if (group_count == 1u) {
+    return true;
+  }
+  if (!ScanLevel(command_buffer, totals, group_count, level + 1u)) {
+    return false;
+  }
+  return Dispatch(command_buffer, add_block_offsets_, {data, totals}, uniforms,
+                  group_count);
+}
+
+bool ComputePrimitives::CopyBuffer(SDL_GPUCommandBuffer* command_buffer,
+                                   SDL_GPUBuffer* source,
+                                   SDL_GPUBuffer* destination,
+                                   Uint32 count) {
+  if (!source || !destination) {
+    return false;
+  }
+  auto pass = SDL_BeginGPUCopyPass(command_buffer);
+  if (!pass) {
+    FML_LOG(ERROR) << "Could not create copy pass: " << SDL_GetError();
+    return false;
+  }
+  FML_DEFER(SDL_EndGPUCopyPass(pass));
+  const auto src = SDL_GPUBufferLocation{
+      .buffer = source,
+      .offset = 0u,
+  };
+  const auto dst = SDL_GPUBufferLocation{
+      .buffer = destination,
+      .offset = 0u,
+  };
+  SDL_CopyGPUBufferToBuffer(pass, &src, &dst, count * sizeof(Uint32), false);
+  return true;
+}
+
+bool ComputePrimitives::ExclusiveScan(SDL_GPUCommandBuffer* command_buffer,
+                                      SDL_GPUBuffer* data,
+                                      Uint32 count) {
+  TS_PROFILE_SCOPE("ComputePrimitives::ExclusiveScan");
+  if (!IsValid() || count > kMaxCount) {
+    return false;
+  }
+  if (count == 0u) {
+    return true;
+  }
+  return ScanLevel(command_buffer, data, count, 0u);
+}
+
+bool ComputePrimitives::Reduce(SDL_GPUCommandBuffer* command_buffer,
+                               SDL_GPUBuffer* input,
+                               Uint32 count,
+                               ReduceOperation operation,
+                               SDL_GPUBuffer* result) {
+  TS_PROFILE_SCOPE("ComputePrimitives::Reduce");
+  if (!IsValid() || count > kMaxCount) {
+    return false;
+  }
+  // Each pass reduces every group to one item. Alternate between two scratch
+  // buffers till a single group is left. That one writes the result.
+  auto ping = Scratch::kReducePing;
+  auto pong = Scratch::kReducePong;
+  while (true) {
+    const auto group_count = GetGroupCount(count);
+    auto output = group_count == 1u ? result : GetScratch(ping, group_count);
+    const auto uniforms = Uniforms{
+        .count = count,
+        .operation = static_cast<Uint32>(operation),
+    };
+    if (!Dispatch(command_buffer, reduce_, {input, output}, uniforms,
+                  group_count)) {
+      return false;
+    }
+    if (group_count == 1u) {
+      return true;
+    }
+    input = output;
+    count = group_count;
+    std::swap(ping, pong);
+  }
+}
+
+bool ComputePrimitives::Compact(SDL_GPUCommandBuffer* command_buffer,
+                                SDL_GPUBuffer* values,
+                                SDL_GPUBuffer* flags,
+                                Uint32 count,
+                                SDL_GPUBuffer* output,
+                                SDL_GPUBuffer* output_count) {
+  TS_PROFILE_SCOPE("ComputePrimitives::Compact");
+  if (!IsValid() || count > kMaxCount) {
+    return false;
+  }
+  if (count == 0u) {
+    // The sum of no flags writes the zero count.
+    return Reduce(command_buffer, flags, 0u, ReduceOperation::kSum,
+                  output_count);
+  }
+  // The scan of the flags is where each kept value goes.
+  auto offsets = GetScratch(Scratch::kCompactOffsets, count);
+  if (!CopyBuffer(command_buffer, flags, offsets, count) ||
+      !ExclusiveScan(command_buffer, offsets, count)) {
+    return false;
+  }
+  return Dispatch(command_buffer, compact_scatter_,
+                  {values, flags, offsets, output, output_count},
+                  Uniforms{.count = count}, GetGroupCount(count));
+}
+
+bool ComputePrimitives::SortKeyValue(SDL_GPUCommandBuffer* command_buffer,
+                                     SDL_GPUBuffer* keys,
+                                     SDL_GPUBuffer* values,
+                                     Uint32 count) {
+  TS_PROFILE_SCOPE("ComputePrimitives::SortKeyValue");
+  if (!IsValid() || count > kMaxCount) {
+    return false;
+  }
+  if (count < 2u) {
+    return true;
+  }
+  const auto group_count = GetGroupCount(count);
+  const auto histogram_count = group_count * kRadixDigits;
+  auto histogram = GetScratch(Scratch::kRadixHistogram, histogram_count);
+  auto other_keys = GetScratch(Scratch::kRadixKeys, count);
+  auto other_values = GetScratch(Scratch::kRadixValues, count);
+  // An even number of passes leaves the result in the caller's buffers.
+  static_assert((32u / kRadixBits) % 2u == 0u);
+  for (Uint32 shift = 0u; shift < 32u; shift += kRadixBits) {
+    const auto uniforms = Uniforms{
+        .count = count,
+        .shift = shift,
+        .block_count = group_count,
+    };
+    if (!Dispatch(command_buffer, radix_count_, {keys, histogram}, uniforms,
+                  group_count) ||
+        !ExclusiveScan(command_buffer, histogram, histogram_count) ||
+        !Dispatch(command_buffer, radix_scatter_,
+                  {keys, histogram, values, other_keys, other_values},
+                  uniforms, group_count)) {
+      return false;
+    }
+    std::swap(keys, other_keys);
+    std::swap(values, other_values);
+  }
+  return true;
+}
+
+}  // namespace ts
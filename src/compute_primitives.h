@@ -0,0 +1,124 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <array>
+#include <initializer_list>
+#include <vector>
+#include "compute_pipeline.h"
+#include "sdl_types.h"
+#include "shader_library.h"
+
+namespace ts {
+
+// Must match the operations in compute_primitives.slang.
+enum class ReduceOperation : Uint32 {
+  kSum,
+  kMin,
+  kMax,
+};
+
+// Parallel building blocks over storage buffers of 32-bit unsigned integers.
+// Each call records its dispatches into the command buffer in separate
+// compute passes. Results are visible to work recorded afterwards.
+//
+// Buffers must have been created with SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE
+// and may not alias. Scratch buffers are reused between calls so the same
+// instance must not be used on multiple threads at once.
+class ComputePrimitives {
+ public:
+  // Sums and scans wrap around on overflow.
+  static constexpr Uint32 kMaxCount = 65535u * 1024u;
+
+  ComputePrimitives(const UniqueGPUDevice& device,
+                    const ShaderLibrary& library);
+
+  ~ComputePrimitives();
+
+  bool IsValid() const;
+
+  // Replaces data[0, count) with its exclusive prefix sum.
+  bool ExclusiveScan(SDL_GPUCommandBuffer* command_buffer,
+                     SDL_GPUBuffer* data,
+                     Uint32 count);
+
+  // Writes the reduction of input[0, count) to result[0]. The reduction of no
+  // items is the identity of the operation.
+  bool Reduce(SDL_GPUCommandBuffer* command_buffer,
+              SDL_GPUBuffer* input,
+              Uint32 count,
+              ReduceOperation operation,
+              SDL_GPUBuffer* result);
+
+  // Writes the values whose flags are non-zero to output in order and their
+  // number to output_count[0].
+  bool Compact(SDL_GPUCommandBuffer* command_buffer,
+               SDL_GPUBuffer* values,
+               SDL_GPUBuffer* flags,
+               Uint32 count,
+               SDL_GPUBuffer* output,
+               SDL_GPUBuffer* output_count);
+
+  // Sorts keys[0, count) along with the values at the same indices. The sort
+  // is stable.
+  bool SortKeyValue(SDL_GPUCommandBuffer* command_buffer,
+                    SDL_GPUBuffer* keys,
+                    SDL_GPUBuffer* values,
+                    Uint32 count);
+
+ private:
+  enum class Scratch {
+    kReducePing,
+    kReducePong,
+    kCompactOffsets,
+    kRadixHistogram,
+    kRadixKeys,
+    kRadixValues,
+    kCount,
+  };
+  // Grown as needed and kept for later calls.
+  struct ScratchBuffer {
+    UniqueGPUBuffer buffer;
+    Uint32 capacity = 0u;
+  };
+  struct Uniforms {
+    Uint32 count = 0u;
+    Uint32 operation = 0u;
+    Uint32 shift = 0u;
+    Uint32 block_count = 0u;
+  };
+  SDL_GPUDevice* device_ = nullptr;
+  ComputePipeline scan_blocks_;
+  ComputePipeline add_block_offsets_;
+  ComputePipeline reduce_;
+  ComputePipeline compact_scatter_;
+  ComputePipeline radix_count_;
+  ComputePipeline radix_scatter_;
+  std::array<ScratchBuffer, static_cast<size_t>(Scratch::kCount)> scratch_;
+  // The group totals of each level of a scan.
+  std::vector<ScratchBuffer> scan_levels_;
+  bool is_valid_ = false;
+
+  SDL_GPUBuffer* GetScratch(ScratchBuffer& scratch, Uint32 count);
+
+  SDL_GPUBuffer* GetScratch(Scratch scratch, Uint32 count);
+
+  bool Dispatch(SDL_GPUCommandBuffer* command_buffer,
+                const ComputePipeline& pipeline,
+                std::initializer_list<SDL_GPUBuffer*> buffers,
+                const Uniforms& uniforms,
+                Uint32 group_count);
+
+  bool ScanLevel(SDL_GPUCommandBuffer* command_buffer,
+                 SDL_GPUBuffer* data,
+                 Uint32 count,
+                 size_t level);
+
+  bool CopyBuffer(SDL_GPUCommandBuffer* command_buffer,
+                  SDL_GPUBuffer* source,
+                  SDL_GPUBuffer* destination,
+                  Uint32 count);
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(ComputePrimitives);
+};
+
+}  // namespace ts
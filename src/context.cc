@@ -1,12 +1,15 @@
 #include "context.h"
 
+#include "shader_blob.h"
+
 namespace ts {
 
+static constexpr bool kIsDebuggingEnabled = true;
+
 Context::Context(UniqueSDLWindow window) : window_(std::move(window)) {
-  constexpr bool kIsDebuggingEnabled = true;
-  // We are only wiring up MSL at the moment. There is no ability to select
-  // drivers.
-  device_.reset(::SDL_CreateGPUDevice(SDL_GPU_SHADERFORMAT_MSL,
+  // Any driver that can consume one of the formats in the shader blobs will
+  // do.
+  device_.reset(::SDL_CreateGPUDevice(kBundledShaderFormats,
                                       kIsDebuggingEnabled, NULL));
   FML_CHECK(device_.is_valid())
       << "Could not create GPU device: " << SDL_GetError();
@@ -17,10 +20,37 @@ Context::Context(UniqueSDLWindow window) : window_(std::move(window)) {
       SDL_GetGPUSwapchainTextureFormat(device_.get(), window_.get());
   depth_format_ = SDL_GPU_TEXTUREFORMAT_D32_FLOAT;
   color_samples_ = SDL_GPU_SAMPLECOUNT_4;
+  render_target_pool_ = std::make_unique<RenderTargetPool>(device_.get());
+}
+
+Context::Context(glm::ivec2 offscreen_size, const char* driver_name)
+    : offscreen_size_(glm::max(offscreen_size, glm::ivec2{1})) {
+  // Fail with a clear error instead of on the first shader the device can't
+  // consume.
+  FML_CHECK(SDL_GPUSupportsShaderFormats(kBundledShaderFormats, driver_name))
+      << "The " << (driver_name ? driver_name : "default")
+      << " GPU driver consumes none of the bundled shader formats.";
+  device_.reset(::SDL_CreateGPUDevice(kBundledShaderFormats,
+                                      kIsDebuggingEnabled, driver_name));
+  FML_CHECK(device_.is_valid())
+      << "Could not create headless GPU device: " << SDL_GetError();
+
+  // There is no swapchain to match. Pick a format that is trivial to read back
+  // and write out.
+  color_format_ = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+  depth_format_ = SDL_GPU_TEXTUREFORMAT_D32_FLOAT;
+  color_samples_ = SDL_GPU_SAMPLECOUNT_4;
+  render_target_pool_ = std::make_unique<RenderTargetPool>(device_.get());
 }
 
 Context::~Context() {
-  SDL_ReleaseWindowFromGPUDevice(device_.get(), window_.get());
+  if (window_.is_valid()) {
+    SDL_ReleaseWindowFromGPUDevice(device_.get(), window_.get());
+  }
+}
+
+bool Context::IsHeadless() const {
+  return !window_.is_valid();
 }
 
 const UniqueSDLWindow& Context::GetWindow() const {
@@ -31,6 +61,34 @@ const UniqueGPUDevice& Context::GetDevice() const {
   return device_;
 }
 
+PipelineCache& Context::GetPipelineCache() const {
+  return *pipeline_cache_;
+}
+
+ShaderLibrary& Context::GetShaderLibrary() const {
+  return *shader_library_;
+}
+
+JobSystem& Context::GetJobSystem() const {
+  return *job_system_;
+}
+
+RenderTargetPool& Context::GetRenderTargetPool() const {
+  return *render_target_pool_;
+}
+
+bool Context::StartShaderHotReload() const {
+  // Only one format needs to be compiled. Pick the one the device would pick
+  // from the bundled blobs.
+  const auto format = PickPreferredShaderFormat(
+      SDL_GetGPUShaderFormats(device_.get()) & kBundledShaderFormats);
+  return shader_library_->StartHotReload(format);
+}
+
+glm::ivec2 Context::GetOffscreenSize() const {
+  return offscreen_size_;
+}
+
 SDL_GPUTextureFormat Context::GetColorFormat() const {
   return color_format_;
 }
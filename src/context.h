@@ -1,7 +1,13 @@
 #pragma once
 
 #include <fml/unique_object.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include "job_system.h"
+#include "pipeline_cache.h"
+#include "render_target_pool.h"
 #include "sdl_types.h"
+#include "shader_library.h"
 
 namespace ts {
 
@@ -9,12 +15,34 @@ class Context {
  public:
   Context(UniqueSDLWindow window);
 
+  // Creates a context with no window or swapchain. Frames are rendered into
+  // offscreen textures of the given size. The Vulkan driver is picked by
+  // default so software ICDs like lavapipe may be used on GPU-less machines.
+  Context(glm::ivec2 offscreen_size, const char* driver_name = "vulkan");
+
   ~Context();
 
+  bool IsHeadless() const;
+
   const UniqueSDLWindow& GetWindow() const;
 
   const UniqueGPUDevice& GetDevice() const;
 
+  PipelineCache& GetPipelineCache() const;
+
+  ShaderLibrary& GetShaderLibrary() const;
+
+  JobSystem& GetJobSystem() const;
+
+  // Pooled textures must be given back before the context goes away.
+  RenderTargetPool& GetRenderTargetPool() const;
+
+  // Recompiles shaders as their sources change. Drawables must reload their
+  // shaders when the library has new blobs.
+  bool StartShaderHotReload() const;
+
+  glm::ivec2 GetOffscreenSize() const;
+
   SDL_GPUTextureFormat GetColorFormat() const;
 
   SDL_GPUTextureFormat GetDepthFormat() const;
@@ -24,9 +52,18 @@ class Context {
  private:
   UniqueSDLWindow window_;
   UniqueGPUDevice device_;
+  // Declared after the device so cached objects are released first.
+  std::unique_ptr<PipelineCache> pipeline_cache_ =
+      std::make_unique<PipelineCache>();
+  std::unique_ptr<ShaderLibrary> shader_library_ =
+      std::make_unique<ShaderLibrary>();
+  std::unique_ptr<RenderTargetPool> render_target_pool_;
+  glm::ivec2 offscreen_size_ = {};
   SDL_GPUTextureFormat color_format_ = SDL_GPU_TEXTUREFORMAT_INVALID;
   SDL_GPUTextureFormat depth_format_ = SDL_GPU_TEXTUREFORMAT_INVALID;
   SDL_GPUSampleCount color_samples_ = SDL_GPU_SAMPLECOUNT_1;
+  // Declared last so that no job outlives the objects above.
+  std::unique_ptr<JobSystem> job_system_ = std::make_unique<JobSystem>();
 
   FML_DISALLOW_COPY_ASSIGN_AND_MOVE(Context);
 };
@@ -0,0 +1,59 @@
+#include "draw_queue.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace ts {
+
+static constexpr uint64_t kPipelineMask = (1u << 14u) - 1u;
+
+static uint64_t DepthBits(float depth) {
+  // The bits of non-negative floats sort in the same order as the floats.
+  return std::bit_cast<uint32_t>(std::max(depth, 0.0f));
+}
+
+uint64_t MakeDrawSortKey(DrawPass pass,
+                         uint16_t pipeline,
+                         uint16_t material,
+                         float depth) {
+  const uint64_t pass_bits = static_cast<uint64_t>(pass) << 62u;
+  const uint64_t pipeline_bits = pipeline & kPipelineMask;
+  if (pass == DrawPass::kTransparent) {
+    const uint64_t inverted_depth = ~DepthBits(depth) & 0xffffffffu;
+    return pass_bits | inverted_depth << 30u | pipeline_bits << 16u |
+           material;
+  }
+  return pass_bits | pipeline_bits << 48u | uint64_t{material} << 32u |
+         DepthBits(depth);
+}
+
+void SortDrawPackets(std::vector<DrawPacket>& packets,
+                     std::vector<DrawPacket>& scratch) {
+  if (packets.size() < 2u) {
+    return;
+  }
+  scratch.resize(packets.size());
+  for (uint32_t shift = 0u; shift < 64u; shift += 8u) {
+    std::array<size_t, 256u> offsets = {};
+    for (const auto& packet : packets) {
+      offsets[(packet.key >> shift) & 0xffu]++;
+    }
+    // Every key has the same byte here. The order wouldn't change.
+    if (offsets[(packets.front().key >> shift) & 0xffu] == packets.size()) {
+      continue;
+    }
+    size_t offset = 0u;
+    for (auto& bucket : offsets) {
+      const auto count = bucket;
+      bucket = offset;
+      offset += count;
+    }
+    for (const auto& packet : packets) {
+      scratch[offsets[(packet.key >> shift) & 0xffu]++] = packet;
+    }
+    packets.swap(scratch);
+  }
+}
+
+}  // namespace ts
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace ts {
+
+// Draws are sorted by pass first. Passes are drawn in this order.
+enum class DrawPass : uint8_t {
+  kOpaque,
+  kAlphaTest,
+  kTransparent,
+};
+
+// A draw reduced to a sort key and the index of the draw in the list of the
+// drawable that issued it.
+struct DrawPacket {
+  uint64_t key = 0u;
+  uint32_t draw = 0u;
+};
+
+// Packs a 64-bit sort key. From the most significant bits:
+//
+// * Opaque and alpha tested draws: pass (2), pipeline (14), material (16),
+//   depth (32). Draws are grouped by state and front-to-back within a group.
+// * Transparent draws: pass (2), depth (32, inverted), pipeline (14),
+//   material (16). Draws are back-to-front. State is only grouped between
+//   draws at the same depth.
+//
+// Depth is the distance from the eye. Negative depths are clamped to zero.
+uint64_t MakeDrawSortKey(DrawPass pass,
+                         uint16_t pipeline,
+                         uint16_t material,
+                         float depth);
+
+// Sorts packets by key with an LSD radix sort. Byte positions where all keys
+// agree are skipped. The scratch vector is reused between calls to avoid
+// allocating every frame.
+void SortDrawPackets(std::vector<DrawPacket>& packets,
+                     std::vector<DrawPacket>& scratch);
+
+}  // namespace ts
@@ -1,3 +1,13 @@
 #include "drawable.h"
 
-namespace ts {}
+namespace ts {
+
+bool Drawable::Prepare(const DrawContext& context) {
+  return true;
+}
+
+bool Drawable::ReloadShaders(const Context& ctx) {
+  return true;
+}
+
+}  // namespace ts
@@ -2,6 +2,8 @@
 
 #include <fml/macros.h>
 #include <glm/glm.hpp>
+#include "camera.h"
+#include "context.h"
 #include "sdl_types.h"
 
 namespace ts {
@@ -10,6 +12,10 @@ struct DrawContext {
   glm::ivec2 viewport = {};
   SDL_GPUCommandBuffer* command_buffer = nullptr;
   SDL_GPURenderPass* pass = nullptr;
+  Camera camera = {};
+  // Seconds since the first frame. Advances by a fixed step each headless
+  // frame so that captures are reproducible.
+  float time = 0.0f;
 
   float GetAspectRatio() const {
     const auto vp = glm::max(glm::vec2{viewport}, glm::vec2{1.0});
@@ -23,8 +29,20 @@ class Drawable {
 
   virtual ~Drawable() = default;
 
+  // Called once a frame before any drawable is drawn. CPU work like culling
+  // and packing uniforms belongs here. The context has no command buffer or
+  // pass. Drawables may be prepared concurrently on job system workers so
+  // ImGui may not be used.
+  virtual bool Prepare(const DrawContext& context);
+
+  // Encodes the commands prepared for the frame into the render pass. Always
+  // called on the render thread.
   virtual bool Draw(const DrawContext& context) = 0;
 
+  // Called between frames when the shader library has new blobs. Pipelines
+  // should be rebuilt but the previous ones kept if that fails.
+  virtual bool ReloadShaders(const Context& ctx);
+
  private:
   FML_DISALLOW_COPY_ASSIGN_AND_MOVE(Drawable);
 };
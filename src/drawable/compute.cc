@@ -1,8 +1,11 @@
 #include "compute.h"
 
-#include "compute.slang.h"
+#include "compute.slang.reflection.h"
+#include "frame_counters.h"
+#include "gpu_memory.h"
 #include "graphics_pipeline.h"
-#include "sampling.slang.h"
+#include "profiler.h"
+#include "sampling.slang.reflection.h"
 #include "shader.h"
 
 namespace ts {
@@ -12,46 +15,36 @@ struct ComputeVertex {
   glm::vec2 uv;
 };
 
-static UniqueGPUGraphicsPipeline CreateRenderPipeline(const Context& ctx) {
-  auto code = fml::NonOwnedMapping{xxd_sampling_data, xxd_sampling_length};
+static_assert(shaders::sampling::kSamplingVertexMain.vertex_pitch ==
+              sizeof(ComputeVertex));
+static_assert(shaders::sampling::kSamplingVertexMain.vertex_attributes[0]
+                  .offset == offsetof(ComputeVertex, position));
+static_assert(shaders::sampling::kSamplingVertexMain.vertex_attributes[1]
+                  .offset == offsetof(ComputeVertex, uv));
+
+static SharedGPUGraphicsPipeline CreateRenderPipeline(const Context& ctx) {
+  auto code = ctx.GetShaderLibrary().GetBlob("sampling");
+  if (!code) {
+    return nullptr;
+  }
+  auto& cache = ctx.GetPipelineCache();
   auto vs = ShaderBuilder{}
-                .SetCode(&code, SDL_GPU_SHADERFORMAT_MSL)
-                .SetEntrypoint("SamplingVertexMain")
-                .SetStage(SDL_GPU_SHADERSTAGE_VERTEX)
-                .Build(ctx.GetDevice());
+                .SetCode(code.get())
+                .SetReflection(shaders::sampling::kSamplingVertexMain)
+                .Build(ctx.GetDevice(), cache);
 
   auto fs = ShaderBuilder{}
-                .SetCode(&code, SDL_GPU_SHADERFORMAT_MSL)
-                .SetEntrypoint("SamplingFragmentMain")
-                .SetStage(SDL_GPU_SHADERSTAGE_FRAGMENT)
-                .SetResourceCounts(1, 0, 0, 0)
-                .Build(ctx.GetDevice());
+                .SetCode(code.get())
+                .SetReflection(shaders::sampling::kSamplingFragmentMain)
+                .Build(ctx.GetDevice(), cache);
+  if (!vs || !fs) {
+    return nullptr;
+  }
 
   return GraphicsPipelineBuilder{}
-      .SetVertexShader(&vs)
-      .SetFragmentShader(&fs)
-      .SetVertexAttribs({
-          // Position
-          SDL_GPUVertexAttribute{
-              .buffer_slot = 0,
-              .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4,
-              .location = 0,
-              .offset = offsetof(ComputeVertex, position),
-          },
-          // UV
-          SDL_GPUVertexAttribute{
-              .buffer_slot = 0,
-              .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
-              .location = 1,
-              .offset = offsetof(ComputeVertex, uv),
-          },
-      })
-      .SetVertexBuffers({
-          SDL_GPUVertexBufferDescription{
-              .slot = 0,
-              .pitch = sizeof(ComputeVertex),
-          },
-      })
+      .SetVertexShader(vs.get())
+      .SetFragmentShader(fs.get())
+      .SetVertexLayout(shaders::sampling::kSamplingVertexMain)
       .SetColorTargets({
           SDL_GPUColorTargetDescription{
               .format = ctx.GetColorFormat(),
@@ -60,22 +53,30 @@ static UniqueGPUGraphicsPipeline CreateRenderPipeline(const Context& ctx) {
       .SetPrimitiveType(SDL_GPU_PRIMITIVETYPE_TRIANGLESTRIP)
       .SetSampleCount(ctx.GetColorSamples())
       .SetDepthStencilFormat(ctx.GetDepthFormat())
+      .Build(ctx.GetDevice(), cache);
+}
+
+static ComputePipeline CreateComputePipeline(const Context& ctx) {
+  auto code = ctx.GetShaderLibrary().GetBlob("compute");
+  if (!code) {
+    return {};
+  }
+  return ComputePipelineBuilder{}
+      .SetShader(code.get())
+      .SetReflection(shaders::compute::kComputeAdder)
       .Build(ctx.GetDevice());
 }
-Compute::Compute(const Context& ctx) {
-  auto code = fml::NonOwnedMapping{xxd_compute_data, xxd_compute_length};
-  compute_pipeline_ = ComputePipelineBuilder{}
-                          .SetDimensions({32, 32, 1})
-                          .SetShader(&code, SDL_GPU_SHADERFORMAT_MSL)
-                          .SetEntrypoint("ComputeAdder")
-                          .SetResourceCounts(0, 0, 0, 1, 0, 0)
-                          .Build(ctx.GetDevice());
+
+Compute::Compute(const Context& ctx)
+    : output_("Compute", SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM) {
+  TS_GPU_MEMORY_OWNER("Compute");
+  compute_pipeline_ = CreateComputePipeline(ctx);
   if (!compute_pipeline_.IsValid()) {
     return;
   }
 
   render_pipeline_ = CreateRenderPipeline(ctx);
-  if (!render_pipeline_.is_valid()) {
+  if (!render_pipeline_) {
     return;
   }
 
@@ -121,70 +122,93 @@ Compute::Compute(const Context& ctx) {
     return;
   }
 
-  rw_texture_ = CreateGPUTexture(ctx.GetDevice().get(), {1200, 800, 1},
-                                 SDL_GPU_TEXTURETYPE_2D,
-                                 SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM,
-                                 SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_WRITE |
-                                     SDL_GPU_TEXTUREUSAGE_SAMPLER);
-  if (!rw_texture_.IsValid()) {
-    return;
-  }
-
   is_valid_ = true;
 }
 Compute::~Compute() {}
-void Compute::DispatchCompute() {
-  if (!is_valid_) {
-    return;
-  }
-  auto command_buffer =
-      SDL_AcquireGPUCommandBuffer(rw_texture_.texture.get().device);
-  if (!command_buffer) {
-    FML_LOG(ERROR) << "Could not create command buffer: " << SDL_GetError();
-    return;
+
+bool Compute::ReloadShaders(const Context& ctx) {
+  auto compute_pipeline = CreateComputePipeline(ctx);
+  auto render_pipeline = CreateRenderPipeline(ctx);
+  if (!compute_pipeline.IsValid() || !render_pipeline) {
+    return false;
   }
-  FML_DEFER(SDL_SubmitGPUCommandBuffer(command_buffer));
+  compute_pipeline_ = std::move(compute_pipeline);
+  render_pipeline_ = std::move(render_pipeline);
+  output_.Invalidate();
+  return true;
+}
 
+void Compute::Invalidate() {
+  output_.Invalidate();
+}
+
+bool Compute::DispatchCompute(SDL_GPUCommandBuffer* command_buffer,
+                              const GPUTexture& texture) const {
   SDL_GPUStorageTextureReadWriteBinding binding = {
-      .texture = rw_texture_.texture.get().value};
+      .texture = texture.texture.get().value};
   auto compute_pass =
       SDL_BeginGPUComputePass(command_buffer, &binding, 1u, nullptr, 0u);
   if (!compute_pass) {
     FML_LOG(ERROR) << "Could not create compute pass: " << SDL_GetError();
-    return;
+    return false;
   }
   FML_DEFER(SDL_EndGPUComputePass(compute_pass));
 
   SDL_BindGPUComputePipeline(compute_pass,
                              compute_pipeline_.pipeline.get().value);
-  const auto image_size =
-      glm::ivec2(rw_texture_.info.width, rw_texture_.info.height);
+  CountPipelineBind();
+  const auto image_size = glm::ivec2(texture.info.width, texture.info.height);
   const auto group_count =
       MakeGroupCount(image_size, glm::ivec2{compute_pipeline_.thread_count.x,
                                             compute_pipeline_.thread_count.y});
   SDL_DispatchGPUCompute(compute_pass, group_count.x, group_count.y, 1);
+  CountDispatch();
+  return true;
 }
-bool Compute::Draw(const DrawContext& context) {
+
+bool Compute::Prepare(const DrawContext& context) {
+  TS_PROFILE_SCOPE("Compute::Prepare");
   if (!is_valid_) {
     return false;
   }
+  // The dispatch is recorded into its own command buffer which is submitted
+  // before the one the frame is drawn with. Nothing is recorded if the
+  // previous output is still current.
+  return output_.Update(
+      render_vtx_buffer_.get().device, context.viewport,
+      [&](SDL_GPUCommandBuffer* command_buffer, const GPUTexture& texture) {
+        return DispatchCompute(command_buffer, texture);
+      });
+}
 
-  DispatchCompute();
+bool Compute::Draw(const DrawContext& context) {
+  TS_PROFILE_SCOPE("Compute::Draw");
+  if (!is_valid_) {
+    return false;
+  }
+  const auto& output = output_.GetTexture();
+  if (!output.IsValid()) {
+    return true;
+  }
 
   SDL_PushGPUDebugGroup(context.command_buffer, "ComputeDraw");
   FML_DEFER(SDL_PopGPUDebugGroup(context.command_buffer));
 
-  SDL_BindGPUGraphicsPipeline(context.pass, render_pipeline_.get().value);
+  SDL_BindGPUGraphicsPipeline(context.pass, render_pipeline_->get().value);
+  CountPipelineBind();
   SDL_GPUBufferBinding vtx_binding = {
       .buffer = render_vtx_buffer_.get().value,
   };
   SDL_BindGPUVertexBuffers(context.pass, 0, &vtx_binding, 1u);
+  CountBufferBind();
   SDL_GPUTextureSamplerBinding frag_sampler_bindings = {
       .sampler = render_sampler_.get().value,
-      .texture = rw_texture_.texture.get().value,
+      .texture = output.texture.get().value,
   };
   SDL_BindGPUFragmentSamplers(context.pass, 0, &frag_sampler_bindings, 1u);
+  CountSamplerBind();
   SDL_DrawGPUPrimitives(context.pass, 4, 1, 0, 0);
+  CountDraw();
 
   return true;
 }
@@ -3,6 +3,7 @@
 #include <fml/closure.h>
 #include <fml/mapping.h>
 #include "buffer.h"
+#include "cached_compute_product.h"
 #include "compute_pipeline.h"
 #include "context.h"
 #include "drawable.h"
@@ -16,17 +17,26 @@ class Compute final : public Drawable {
 
   ~Compute();
 
+  bool Prepare(const DrawContext& context) override;
+
   bool Draw(const DrawContext& context) override;
 
+  bool ReloadShaders(const Context& ctx) override;
+
+  // Forces the next Prepare to dispatch the compute shader again.
+  void Invalidate();
+
  private:
   ComputePipeline compute_pipeline_;
-  UniqueGPUGraphicsPipeline render_pipeline_;
-  GPUTexture rw_texture_;
+  SharedGPUGraphicsPipeline render_pipeline_;
+  // Sized to the viewport and only recomputed when it or the shader changes.
+  CachedComputeProduct output_;
   UniqueGPUBuffer render_vtx_buffer_;
   UniqueGPUSampler render_sampler_;
   bool is_valid_ = false;
 
-  void DispatchCompute();
+  bool DispatchCompute(SDL_GPUCommandBuffer* command_buffer,
+                       const GPUTexture& texture) const;
 
   FML_DISALLOW_COPY_ASSIGN_AND_MOVE(Compute);
 };
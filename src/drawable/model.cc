@@ -2,92 +2,37 @@
 
 #include <tiny_gltf.h>
 #include <algorithm>
+#include <cmath>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
 #include "buffer.h"
+#include "frame_counters.h"
+#include "gpu_memory.h"
 #include "graphics_pipeline.h"
-#include "imgui.h"
 #include "macros.h"
-#include "model.slang.h"
+#include "model_loader.h"
+#include "model.slang.reflection.h"
+#include "profiler.h"
 #include "shader.h"
 
 namespace ts {
 
-struct Vertex {
-  glm::vec3 position;
-  glm::vec3 normal;
-  glm::vec2 textureCoords;
-};
-
-template <class From>
-static void ReadIndexBuffer(std::vector<uint32_t>& indices,
-                            const uint8_t* buffer,
-                            size_t item_count) {
-  const auto initial_count = indices.size();
-  indices.resize(initial_count + item_count);
-  const auto from_buffer = reinterpret_cast<const From*>(buffer);
-  for (size_t i = 0; i < item_count; i++) {
-    indices[i + initial_count] = static_cast<uint32_t>(from_buffer[i]);
-  }
-}
-
-static void ReadIndexBuffer(std::vector<uint32_t>& indices,
-                            const uint8_t* buffer,
-                            size_t item_count,
-                            int item_component_type) {
-  switch (item_component_type) {
-    case TINYGLTF_COMPONENT_TYPE_BYTE:
-      ReadIndexBuffer<int8_t>(indices, buffer, item_count);
-      break;
-    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-      ReadIndexBuffer<uint8_t>(indices, buffer, item_count);
-      break;
-    case TINYGLTF_COMPONENT_TYPE_SHORT:
-      ReadIndexBuffer<int16_t>(indices, buffer, item_count);
-      break;
-    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-      ReadIndexBuffer<uint16_t>(indices, buffer, item_count);
-      break;
-    case TINYGLTF_COMPONENT_TYPE_INT:
-      ReadIndexBuffer<int32_t>(indices, buffer, item_count);
-      break;
-    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-      ReadIndexBuffer<uint32_t>(indices, buffer, item_count);
-      break;
-  }
-}
-
-static std::unique_ptr<tinygltf::Model> ParseModel(
-    const fml::Mapping& mapping) {
-  tinygltf::TinyGLTF context;
-  std::string error;
-  std::string warning;
-  auto model = std::make_unique<tinygltf::Model>();
-  if (!context.LoadBinaryFromMemory(model.get(), &error, &warning,
-                                    mapping.GetMapping(), mapping.GetSize())) {
-    FML_LOG(ERROR) << "Could not load model";
-    if (!error.empty()) {
-      FML_LOG(ERROR) << "Error: " << error;
-    }
-    if (!warning.empty()) {
-      FML_LOG(ERROR) << "Warning: " << warning;
-    }
-    return nullptr;
-  }
-  return model;
-}
-
-static std::optional<SDL_GPUTextureFormat> PickFormat(int component_count,
-                                                      int component_type,
-                                                      int bits_per_pixel) {
-  if (component_count == 4u &&
-      component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
-      bits_per_pixel == 8) {
-    return SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
-  }
-  return std::nullopt;
-}
+static_assert(shaders::model::kVertexMain.vertex_pitch == sizeof(ModelVertex));
+static_assert(shaders::model::kVertexMain.vertex_attributes[0].offset ==
+              offsetof(ModelVertex, position));
+static_assert(shaders::model::kVertexMain.vertex_attributes[1].offset ==
+              offsetof(ModelVertex, normal));
+static_assert(shaders::model::kVertexMain.vertex_attributes[2].offset ==
+              offsetof(ModelVertex, textureCoords));
+static_assert(shaders::model::kVertexMain.vertex_attributes[3].offset ==
+              offsetof(ModelVertex, color));
+static_assert(shaders::model::kVertexMain.vertex_attributes[4].offset ==
+              offsetof(ModelVertex, tangent));
+
+// Samplers clamp to level zero unless told otherwise. Streamed textures have
+// their resident levels sampled.
+static constexpr float kMaxLod = 1000.0f;
 
 static SDL_GPUSamplerAddressMode AddressModeTinyGLTFToSDLGPU(int val) {
   switch (val) {
@@ -129,37 +74,27 @@ static SDL_GPUSamplerMipmapMode MipmapModeGLTFToSDLGPU(int val) {
   return SDL_GPU_SAMPLERMIPMAPMODE_NEAREST;
 }
 
-bool ReadVertexAttribute(std::vector<Vertex>& vertices,
-                         const tinygltf::Model& model,
-                         int attribute,
-                         size_t field_offset,
-                         size_t field_size,
-                         int check_type,
-                         int check_component_type) {
-  const tinygltf::Accessor& accessor = model.accessors[attribute];
-  const tinygltf::BufferView& buffer_view =
-      model.bufferViews[accessor.bufferView];
-  const tinygltf::Buffer& buffer = model.buffers[buffer_view.buffer];
-  if (accessor.type != check_type &&
-      accessor.componentType != check_component_type) {
+// Whether the first count slots already hold the bindings.
+static bool AreSamplersBound(
+    const std::array<SDL_GPUTextureSamplerBinding, 2u>& bound,
+    Uint32 bound_count,
+    const std::array<SDL_GPUTextureSamplerBinding, 2u>& bindings,
+    Uint32 count) {
+  if (count > bound_count) {
     return false;
   }
-  const auto stride = accessor.ByteStride(buffer_view);
-  vertices.resize(std::max(vertices.size(), accessor.count));
-  const auto* data_ptr =
-      buffer.data.data() + accessor.byteOffset + buffer_view.byteOffset;
-  for (size_t i = 0; i < accessor.count; i++) {
-    std::memcpy(reinterpret_cast<uint8_t*>(&vertices[i]) + field_offset,
-                data_ptr + stride * i, field_size);
+  for (Uint32 i = 0; i < count; i++) {
+    if (bound[i].texture != bindings[i].texture ||
+        bound[i].sampler != bindings[i].sampler) {
+      return false;
+    }
   }
   return true;
 }
 
 Model::Model(const Context& ctx, const fml::Mapping& mapping) {
-  if (!BuildPipeline(ctx)) {
-    return;
-  }
-
+  TS_PROFILE_SCOPE("Model::Model");
+  TS_GPU_MEMORY_OWNER("Model");
   auto model = ParseModel(mapping);
   if (!model) {
     return;
@@ -173,34 +108,43 @@ Model::Model(const Context& ctx, const fml::Mapping& mapping) {
           .min_filter = SDL_GPU_FILTER_LINEAR,
           .mag_filter = SDL_GPU_FILTER_LINEAR,
           .mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_LINEAR,
+          .max_lod = kMaxLod,
       });
   if (!default_sampler_.is_valid()) {
     FML_LOG(ERROR) << "Could not create default sampler.";
     return;
   }
 
-  // Handle images.
+  {
+    const uint8_t white[] = {255, 255, 255, 255};
+    default_texture_ = PerformHostToDeviceTransferTexture2D(
+        ctx.GetDevice().get(), SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM, {1, 1},
+        white, sizeof(white));
+    if (!default_texture_.IsValid()) {
+      FML_LOG(ERROR) << "Could not create default texture.";
+      return;
+    }
+  }
+
+  // Handle images. Only their coarse levels are uploaded at first.
+  textures_ = std::make_unique<TextureStreamer>(ctx.GetDevice().get(),
+                                                TextureStreamer::Budgets{});
   for (size_t i = 0, count = model->images.size(); i < count; i++) {
     const auto& image = model->images[i];
-    auto format = PickFormat(image.component, image.pixel_type, image.bits);
+    auto format =
+        PickImageFormat(image.component, image.pixel_type, image.bits);
     if (!format.has_value()) {
       FML_LOG(ERROR) << "Could not find format for image.";
       continue;
     }
-    const auto data_size = SDL_CalculateGPUTextureFormatSize(
-        format.value(), image.width, image.height, 1u);
-    if (data_size > image.image.size()) {
-      FML_LOG(ERROR) << "Prevented OOB access for image data.";
-      continue;
+    auto texture = textures_->AddTexture(format.value(),               //
+                                         {image.width, image.height},  //
+                                         image.image.data(),           //
+                                         image.image.size()            //
+    );
+    if (texture.has_value()) {
+      image_textures_[i] = texture.value();
     }
-    auto texture =
-        PerformHostToDeviceTransferTexture2D(ctx.GetDevice().get(),        //
-                                             format.value(),               //
-                                             {image.width, image.height},  //
-                                             image.image.data(),           //
-                                             data_size                     //
-        );
-    textures_[i] = std::move(texture);
   }
 
   // Handle samplers.
@@ -214,158 +158,110 @@ Model::Model(const Context& ctx, const fml::Mapping& mapping) {
             .min_filter = FilterModeTinyGLTFToSDLGPU(sampler.minFilter),
             .mag_filter = FilterModeTinyGLTFToSDLGPU(sampler.magFilter),
             .mipmap_mode = MipmapModeGLTFToSDLGPU(sampler.minFilter),
+            .max_lod = kMaxLod,
         });
   }
 
-  std::vector<uint32_t> indices;
-  std::vector<Vertex> vertices;
-
-  for (const auto& mesh : model->meshes) {
-    for (const auto& primitive : mesh.primitives) {
-      auto current_draw = DrawCall{
-          .first_vertex = static_cast<Uint32>(vertices.size()),
-          .first_index = static_cast<Uint32>(indices.size()),
-      };
-
-      std::vector<Vertex> current_vertices;
-
-      if (auto position = primitive.attributes.find("POSITION");
-          position != primitive.attributes.end()) {
-        ReadVertexAttribute(current_vertices,              //
-                            *model,                        //
-                            position->second,              //
-                            offsetof(Vertex, position),    //
-                            sizeof(Vertex::position),      //
-                            TINYGLTF_TYPE_VEC3,            //
-                            TINYGLTF_COMPONENT_TYPE_FLOAT  //
-        );
-      }
-
-      if (auto normal = primitive.attributes.find("NORMAL");
-          normal != primitive.attributes.end()) {
-        ReadVertexAttribute(current_vertices,              //
-                            *model,                        //
-                            normal->second,                //
-                            offsetof(Vertex, normal),      //
-                            sizeof(Vertex::normal),        //
-                            TINYGLTF_TYPE_VEC3,            //
-                            TINYGLTF_COMPONENT_TYPE_FLOAT  //
-        );
-      }
-
-      if (auto texcoord = primitive.attributes.find("TEXCOORD_0");
-          texcoord != primitive.attributes.end()) {
-        ReadVertexAttribute(current_vertices,                 //
-                            *model,                           //
-                            texcoord->second,                 //
-                            offsetof(Vertex, textureCoords),  //
-                            sizeof(Vertex::textureCoords),    //
-                            TINYGLTF_TYPE_VEC2,               //
-                            TINYGLTF_COMPONENT_TYPE_FLOAT     //
-        );
-      }
-
-      {
-        if (primitive.indices >= 0) {
-          const auto& index_acessor = model->accessors.at(primitive.indices);
-          const auto& index_buffer_view =
-              model->bufferViews.at(index_acessor.bufferView);
-          const auto& index_buffer =
-              model->buffers.at(index_buffer_view.buffer);
-          ReadIndexBuffer(indices,
-                          index_buffer.data.data() + index_acessor.byteOffset +
-                              index_buffer_view.byteOffset,  //
-                          index_acessor.count,               //
-                          index_acessor.componentType        //
-          );
-        } else {
-          indices.reserve(indices.size() + current_vertices.size());
-          for (size_t i = 0; i < current_vertices.size(); i++) {
-            indices.push_back(i);
-          }
-        }
-        current_draw.last_index = indices.size();
+  auto geometry = ReadModelGeometry(*model);
+  for (const auto& primitive : geometry.primitives) {
+    auto current_draw = DrawCall{
+        .first_index = primitive.first_index,
+        .last_index = primitive.last_index,
+        .first_vertex = primitive.first_vertex,
+        .center = (primitive.bounds_min + primitive.bounds_max) * 0.5f,
+        .radius = glm::distance(primitive.bounds_min, primitive.bounds_max) *
+                  0.5f,
+        .uv_density = primitive.uv_density,
+    };
+    if (primitive.material >= 0) {
+      current_draw.material = static_cast<uint16_t>(
+          std::min(primitive.material + 1, int{UINT16_MAX}));
+      const auto& material = model->materials[primitive.material];
+      const auto& pbr = material.pbrMetallicRoughness;
+      current_draw.base_color_texture =
+          ResolveTexture(*model, pbr.baseColorTexture.index);
+      current_draw.normal_texture =
+          ResolveTexture(*model, material.normalTexture.index);
+      if (pbr.baseColorFactor.size() == 4u) {
+        current_draw.base_color_factor =
+            glm::vec4{pbr.baseColorFactor[0], pbr.baseColorFactor[1],
+                      pbr.baseColorFactor[2], pbr.baseColorFactor[3]};
       }
-
-      {
-        if (primitive.material >= 0) {
-          const auto& material = model->materials[primitive.material];
-          if (auto index = material.pbrMetallicRoughness.baseColorTexture.index;
-              index >= 0) {
-            const auto& texture = model->textures[index];
-            size_t texture_index =
-                glm::clamp<int>(texture.source, 0u, textures_.size());
-            size_t sampler_index =
-                glm::clamp<int>(texture.sampler, 0u, samplers_.size());
-            if (textures_.contains(texture_index)) {
-              current_draw.base_color_texture = TextureBinding{
-                  .texture = texture_index,
-
-              };
-              // The sampler is optional. A default will be picked if none is
-              // specified.
-              if (samplers_.contains(sampler_index)) {
-                current_draw.base_color_texture->sampler = sampler_index;
-              }
-            }
-          }
-        }
+      if (material.alphaMode == "MASK") {
+        current_draw.shader_key |= kModelShaderFeatureAlphaTest;
+        current_draw.alpha_cutoff = material.alphaCutoff;
+        current_draw.pass = DrawPass::kAlphaTest;
+      } else if (material.alphaMode == "BLEND") {
+        current_draw.pass = DrawPass::kTransparent;
       }
-
-      std::ranges::move(current_vertices, std::back_inserter(vertices));
-      draws_.push_back(current_draw);
     }
+    if (current_draw.base_color_texture.has_value()) {
+      current_draw.shader_key |= kModelShaderFeatureBaseColorTexture;
+    }
+    if (primitive.has_vertex_color) {
+      current_draw.shader_key |= kModelShaderFeatureVertexColor;
+    }
+    // Normal maps are useless without tangents.
+    if (current_draw.normal_texture.has_value() && primitive.has_tangent) {
+      current_draw.shader_key |= kModelShaderFeatureNormalMap;
+    }
+    draws_.push_back(current_draw);
   }
 
   index_buffer_ = PerformHostToDeviceTransfer(ctx.GetDevice(),           //
-                                              indices,                   //
+                                              geometry.indices,          //
                                               SDL_GPU_BUFFERUSAGE_INDEX  //
   );
-  index_count_ = indices.size();
-  vertex_buffer_ = PerformHostToDeviceTransfer(ctx.GetDevice(),            //
-                                               vertices,                   //
-                                               SDL_GPU_BUFFERUSAGE_VERTEX  //
-  );
-
-  // Handle images.
-  for (size_t i = 0, count = model->images.size(); i < count; i++) {
-    const auto& image = model->images[i];
-    auto format = PickFormat(image.component, image.pixel_type, image.bits);
-    if (!format.has_value()) {
-      FML_LOG(ERROR) << "Could not find format for image.";
-      continue;
+  index_count_ = geometry.indices.size();
+  buffer_size_ = geometry.indices.size() * sizeof(geometry.indices[0]);
+  if (!geometry.skinned_vertices.empty()) {
+    rig_ = ReadModelRig(*model);
+    jobs_ = &ctx.GetJobSystem();
+    skinner_ = std::make_unique<ModelSkinner>(ctx,                        //
+                                              geometry.vertices,          //
+                                              geometry.skinned_vertices,  //
+                                              rig_.joint_count            //
+    );
+    if (!skinner_->IsValid()) {
+      FML_LOG(ERROR) << "Could not create model skinner.";
+      return;
     }
-    const auto data_size = SDL_CalculateGPUTextureFormatSize(
-        format.value(), image.width, image.height, 1u);
-    if (data_size > image.image.size()) {
-      FML_LOG(ERROR) << "Prevented OOB access for image data.";
-      continue;
+  } else {
+    vertex_buffer_ = PerformHostToDeviceTransfer(ctx.GetDevice(),            //
+                                                 geometry.vertices,          //
+                                                 SDL_GPU_BUFFERUSAGE_VERTEX  //
+    );
+    if (!vertex_buffer_.is_valid()) {
+      return;
+    }
+    buffer_size_ += geometry.vertices.size() * sizeof(ModelVertex);
+
+    std::vector<ModelCuller::Range> ranges;
+    ranges.reserve(draws_.size());
+    for (const auto& draw : draws_) {
+      ranges.push_back(ModelCuller::Range{
+          .first_index = draw.first_index,
+          .last_index = draw.last_index,
+          .first_vertex = draw.first_vertex,
+          .is_occluder = draw.pass == DrawPass::kOpaque,
+      });
+    }
+    culler_ = std::make_unique<ModelCuller>(ctx,                //
+                                            geometry.vertices,  //
+                                            geometry.indices,   //
+                                            ranges              //
+    );
+    if (!culler_->IsValid()) {
+      FML_LOG(ERROR) << "Could not create model culler.";
+      return;
     }
-    auto texture =
-        PerformHostToDeviceTransferTexture2D(ctx.GetDevice().get(),        //
-                                             format.value(),               //
-                                             {image.width, image.height},  //
-                                             image.image.data(),           //
-                                             data_size                     //
-        );
-    textures_[i] = std::move(texture);
   }
 
-  // Handle samplers.
-  for (size_t i = 0, count = model->samplers.size(); i < count; i++) {
-    const auto& sampler = model->samplers[i];
-    samplers_[i] = CreateSampler(
-        ctx.GetDevice().get(),
-        SDL_GPUSamplerCreateInfo{
-            .address_mode_u = AddressModeTinyGLTFToSDLGPU(sampler.wrapS),
-            .address_mode_v = AddressModeTinyGLTFToSDLGPU(sampler.wrapT),
-            .min_filter = FilterModeTinyGLTFToSDLGPU(sampler.minFilter),
-            .mag_filter = FilterModeTinyGLTFToSDLGPU(sampler.magFilter),
-            .mipmap_mode = MipmapModeGLTFToSDLGPU(sampler.minFilter),
-        });
+  if (!index_buffer_.is_valid()) {
+    return;
   }
 
-  if (!index_buffer_.is_valid() || !vertex_buffer_.is_valid()) {
+  if (!BuildPipelines(ctx)) {
     return;
   }
 
@@ -378,76 +274,248 @@ bool Model::IsValid() const {
   return is_valid_;
 }
 
-bool Model::BuildPipeline(const Context& ctx) {
-  auto code = fml::NonOwnedMapping{xxd_model_data, xxd_model_length};
+size_t Model::GetGPUMemorySize() const {
+  auto size = buffer_size_ + default_texture_.GetSize() +
+              textures_->GetStats().resident_bytes;
+  if (culler_) {
+    size += culler_->GetGPUMemorySize();
+  }
+  return skinner_ ? size + skinner_->GetGPUMemorySize() : size;
+}
+
+const TextureStreamer::Stats& Model::GetTextureStreamingStats() const {
+  return textures_->GetStats();
+}
+
+std::optional<ModelCuller::Stats> Model::GetCullingStats() const {
+  if (!culler_) {
+    return std::nullopt;
+  }
+  return culler_->GetStats();
+}
+
+SharedGPUGraphicsPipeline Model::BuildPipeline(const Context& ctx,
+                                               ModelShaderKey key,
+                                               bool blend) {
+  auto code = ctx.GetShaderLibrary().GetBlob("model");
+  if (!code) {
+    return nullptr;
+  }
+  auto& cache = ctx.GetPipelineCache();
 
   auto vs = ShaderBuilder{}
-                .SetCode(&code, SDL_GPU_SHADERFORMAT_MSL)
-                .SetStage(SDL_GPU_SHADERSTAGE_VERTEX)
-                .SetEntrypoint("VertexMain")
-                .SetResourceCounts(0, 0, 0, 1u)
-                .Build(ctx.GetDevice());
+                .SetCode(code.get())
+                .SetReflection(shaders::model::kVertexMain)
+                .Build(ctx.GetDevice(), cache);
   auto fs = ShaderBuilder{}
-                .SetCode(&code, SDL_GPU_SHADERFORMAT_MSL)
-                .SetStage(SDL_GPU_SHADERSTAGE_FRAGMENT)
-                .SetEntrypoint("FragmentMain")
-                .SetResourceCounts(1u, 0, 0, 0)
-                .Build(ctx.GetDevice());
-
-  pipeline_ = GraphicsPipelineBuilder{}
-                  .SetColorTargets({
-                      SDL_GPUColorTargetDescription{
-                          .format = ctx.GetColorFormat(),
-                      },
-                  })
-                  .SetVertexShader(&vs)
-                  .SetFragmentShader(&fs)
-                  .SetPrimitiveType(SDL_GPU_PRIMITIVETYPE_TRIANGLELIST)
-                  .SetVertexAttribs({
-                      // Position
-                      SDL_GPUVertexAttribute{
-                          .buffer_slot = 0,
-                          .location = 0,
-                          .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                          .offset = offsetof(Vertex, position),
-                      },
-                      // Normal
-                      SDL_GPUVertexAttribute{
-                          .buffer_slot = 0,
-                          .location = 1,
-                          .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                          .offset = offsetof(Vertex, normal),
-                      },
-                      // Texture Coords
-                      SDL_GPUVertexAttribute{
-                          .buffer_slot = 0,
-                          .location = 2,
-                          .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
-                          .offset = offsetof(Vertex, textureCoords),
-                      },
-                  })
-                  .SetVertexBuffers({
-                      SDL_GPUVertexBufferDescription{
-                          .slot = 0u,
-                          .pitch = sizeof(Vertex),
-                      },
-                  })
-                  .SetSampleCount(ctx.GetColorSamples())
-                  .SetCullMode(SDL_GPU_CULLMODE_BACK)
-                  .SetDepthStencilFormat(ctx.GetDepthFormat())
-                  .SetDepthStencilState(SDL_GPUDepthStencilState{
-                      .compare_op = SDL_GPU_COMPAREOP_GREATER,
-                      .enable_depth_test = true,
-                      .enable_depth_write = true,
-                  })
-                  .Build(ctx.GetDevice());
-  if (!pipeline_.is_valid()) {
+                .SetCode(code.get())
+                .SetReflection(GetModelFragmentPermutation(key))
+                .Build(ctx.GetDevice(), cache);
+  if (!vs || !fs) {
+    return nullptr;
+  }
+  auto blend_state = SDL_GPUColorTargetBlendState{};
+  if (blend) {
+    blend_state = SDL_GPUColorTargetBlendState{
+        .src_color_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
+        .dst_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+        .color_blend_op = SDL_GPU_BLENDOP_ADD,
+        .src_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE,
+        .dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+        .alpha_blend_op = SDL_GPU_BLENDOP_ADD,
+        .enable_blend = true,
+    };
+  }
+  return GraphicsPipelineBuilder{}
+      .SetColorTargets({
+          SDL_GPUColorTargetDescription{
+              .format = ctx.GetColorFormat(),
+              .blend_state = blend_state,
+          },
+      })
+      .SetVertexShader(vs.get())
+      .SetFragmentShader(fs.get())
+      .SetPrimitiveType(SDL_GPU_PRIMITIVETYPE_TRIANGLELIST)
+      .SetVertexLayout(shaders::model::kVertexMain)
+      .SetSampleCount(ctx.GetColorSamples())
+      .SetCullMode(SDL_GPU_CULLMODE_BACK)
+      .SetDepthStencilFormat(ctx.GetDepthFormat())
+      .SetDepthStencilState(SDL_GPUDepthStencilState{
+          .compare_op = SDL_GPU_COMPAREOP_GREATER,
+          .enable_depth_test = true,
+          // Transparent draws are sorted back-to-front instead.
+          .enable_depth_write = !blend,
+      })
+      .Build(ctx.GetDevice(), cache);
+}
+
+bool Model::WarmUpPipelines(const Context& ctx) {
+  for (ModelShaderKey key = 0; key < kModelShaderPermutationCount; key++) {
+    for (const auto blend : {false, true}) {
+      if (!BuildPipeline(ctx, key, blend)) {
+        FML_LOG(ERROR) << "Could not build model pipeline " << key << ".";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool Model::BuildPipelines(const Context& ctx) {
+  // Built aside so that the previous pipelines are kept on failure.
+  PipelineSet pipelines;
+  PipelineSet blend_pipelines;
+  for (const auto& draw : draws_) {
+    const auto blend = draw.pass == DrawPass::kTransparent;
+    auto& pipeline = (blend ? blend_pipelines : pipelines)[draw.shader_key];
+    if (pipeline) {
+      continue;
+    }
+    pipeline = BuildPipeline(ctx, draw.shader_key, blend);
+    if (!pipeline) {
+      return false;
+    }
+  }
+  pipelines_ = std::move(pipelines);
+  blend_pipelines_ = std::move(blend_pipelines);
+  return true;
+}
+
+bool Model::ReloadShaders(const Context& ctx) {
+  const auto skinning = !skinner_ || skinner_->ReloadShaders(ctx);
+  const auto culling = !culler_ || culler_->ReloadShaders(ctx);
+  return BuildPipelines(ctx) && skinning && culling;
+}
+
+bool Model::Animate(float time) {
+  TS_PROFILE_SCOPE("Model::Animate");
+  // Without animations the rest pose is skinned once.
+  if (rig_.animations.empty()) {
+    pose_ = rig_.rest_pose;
+  } else {
+    SampleAnimation(rig_, rig_.animations.front(), time, pose_, *jobs_);
+  }
+  ComputeJointMatrices(rig_, pose_, node_matrices_, joint_matrices_);
+  return skinner_->Update(joint_matrices_);
+}
+
+void Model::RequestTextureLevels(const DrawContext& context) {
+  TS_PROFILE_SCOPE("Model::RequestTextureLevels");
+  // The pixels covered by a unit of model space a unit away from the camera.
+  const auto pixels_per_unit =
+      context.viewport.y /
+      (2.0f * std::tan(glm::radians(context.camera.fov) * 0.5f));
+  if (!(pixels_per_unit > 0.0f)) {
+    return;
+  }
+  for (const auto& draw : draws_) {
+    if (draw.uv_density <= 0.0f) {
+      continue;
+    }
+    // The nearest point of the bounds is as close as the draw gets.
+    const auto distance = std::max(
+        glm::distance(context.camera.eye, draw.center) - draw.radius, 0.1f);
+    for (const auto& binding : {draw.base_color_texture, draw.normal_texture}) {
+      if (!binding.has_value()) {
+        continue;
+      }
+      const auto size = textures_->GetSize(binding->texture);
+      const auto texels_per_pixel = draw.uv_density *
+                                    std::max(size.x, size.y) * distance /
+                                    pixels_per_unit;
+      const auto level =
+          texels_per_pixel > 1.0f ? std::log2(texels_per_pixel) : 0.0f;
+      textures_->Request(binding->texture, static_cast<Uint32>(level));
+    }
+  }
+}
+
+bool Model::Prepare(const DrawContext& context) {
+  TS_PROFILE_SCOPE("Model::Prepare");
+  if (!IsValid()) {
+    return false;
+  }
+  if (skinner_ && !Animate(context.time)) {
+    return false;
+  }
+  RequestTextureLevels(context);
+  if (!textures_->Update()) {
+    return false;
+  }
+
+  glm::mat4 mvp = {};
+  {
+    glm::mat4 proj = glm::perspective(glm::radians(context.camera.fov),  //
+                                      context.GetAspectRatio(),          //
+                                      0.1f,                              //
+                                      1000.0f                            //
+    );
+    glm::mat4 view = glm::lookAt(context.camera.eye,       // eye
+                                 glm::vec3{0},             // center
+                                 glm::vec3{0.0, 1.0, 0.0}  // up
+    );
+    glm::mat4 model = glm::mat4{1.0};
+    mvp = proj * view * model;
+  }
+
+  if (culler_ && !culler_->Update(mvp, context.viewport,
+                                  vertex_buffer_.get().value,
+                                  index_buffer_.get().value)) {
     return false;
   }
+
+  // Sorting groups draws by state so that Draw can skip redundant binds.
+  packets_.clear();
+  packets_.reserve(draws_.size());
+  for (uint32_t i = 0; i < draws_.size(); i++) {
+    const auto& draw = draws_[i];
+    const auto depth = glm::distance(context.camera.eye, draw.center);
+    packets_.push_back(DrawPacket{
+        .key = MakeDrawSortKey(draw.pass,        //
+                               draw.shader_key,  //
+                               draw.material,    //
+                               depth             //
+                               ),
+        .draw = i,
+    });
+  }
+  SortDrawPackets(packets_, packets_scratch_);
+
+  prepared_draws_.clear();
+  prepared_draws_.reserve(packets_.size());
+  for (const auto& packet : packets_) {
+    const auto& draw = draws_[packet.draw];
+    const auto& pipelines =
+        draw.pass == DrawPass::kTransparent ? blend_pipelines_ : pipelines_;
+    // Samplers are bound by slot. A permutation may sample the normal map in
+    // slot one without sampling a base color in slot zero.
+    const auto sampler_count =
+        GetModelFragmentPermutation(draw.shader_key).resources.num_samplers;
+    prepared_draws_.push_back(PreparedDraw{
+        .pipeline = pipelines[draw.shader_key]->get().value,
+        .uniforms =
+            Uniforms{
+                .mvp = mvp,
+                .base_color_factor = draw.base_color_factor,
+                .alpha_cutoff = draw.alpha_cutoff,
+            },
+        .bindings =
+            {
+                PickTextureBinding(draw.base_color_texture),
+                PickTextureBinding(draw.normal_texture),
+            },
+        .sampler_count = std::min<Uint32>(sampler_count, 2u),
+        .first_index = draw.first_index,
+        .index_count = draw.last_index - draw.first_index,
+        .first_vertex = draw.first_vertex,
+        .draw = packet.draw,
+    });
+  }
   return true;
 }
 
 bool Model::Draw(const DrawContext& context) {
+  TS_PROFILE_SCOPE("Model::Draw");
   if (!IsValid()) {
     return false;
   }
@@ -455,18 +523,18 @@ bool Model::Draw(const DrawContext& context) {
   SDL_PushGPUDebugGroup(context.command_buffer, "Model");
   FML_DEFER(SDL_PopGPUDebugGroup(context.command_buffer));
 
-  if (index_count_ == 0) {
+  if (index_count_ == 0 || prepared_draws_.empty()) {
     return true;
   }
 
-  SDL_BindGPUGraphicsPipeline(context.pass, pipeline_.get().value);
-
   {
     const auto binding = SDL_GPUBufferBinding{
-        .buffer = vertex_buffer_.get().value,
+        .buffer = skinner_ ? skinner_->GetVertexBuffer()
+                           : vertex_buffer_.get().value,
         .offset = 0u,
     };
     SDL_BindGPUVertexBuffers(context.pass, 0, &binding, 1);
+    CountBufferBind();
   }
 
   {
@@ -476,52 +544,44 @@ bool Model::Draw(const DrawContext& context) {
     };
     SDL_BindGPUIndexBuffer(context.pass, &binding,
                            SDL_GPU_INDEXELEMENTSIZE_32BIT);
+    CountBufferBind();
   }
 
-  static float fov = 60;
-  static glm::vec3 eye = glm::vec3{0.0, 0, -5.0};
-  {
-    ImGui::Begin("Viewport");
-    ImGui::SliderFloat("FOV", &fov, 10, 180);
-    ImGui::SliderFloat3("Eye", reinterpret_cast<float*>(&eye), -10, 10);
-    ImGui::End();
-  }
-
-  {
-    glm::mat4 proj = glm::perspective(glm::radians(fov),         //
-                                      context.GetAspectRatio(),  //
-                                      0.1f,                      //
-                                      1000.0f                    //
-    );
-    glm::mat4 view = glm::lookAt(eye,                      // eye
-                                 glm::vec3{0},             // center
-                                 glm::vec3{0.0, 1.0, 0.0}  // up
-    );
-    glm::mat4 model = glm::mat4{1.0};
-    auto mvp = proj * view * model;
-    SDL_PushGPUVertexUniformData(context.command_buffer, 0, &mvp, sizeof(mvp));
-  }
-
-  for (const auto& draw : draws_) {
-    if (!draw.base_color_texture.has_value()) {
-      FML_LOG(ERROR) << "No base color.";
+  // The draws are sorted by state. Only bind what changed since the last one.
+  SDL_GPUGraphicsPipeline* bound_pipeline = nullptr;
+  std::array<SDL_GPUTextureSamplerBinding, 2u> bound_samplers = {};
+  Uint32 bound_sampler_count = 0u;
+  for (const auto& draw : prepared_draws_) {
+    if (bound_pipeline != draw.pipeline) {
+      SDL_BindGPUGraphicsPipeline(context.pass, draw.pipeline);
+      CountPipelineBind();
+      bound_pipeline = draw.pipeline;
+    }
+    SDL_PushGPUVertexUniformData(context.command_buffer, 0, &draw.uniforms,
+                                 sizeof(draw.uniforms));
+    if (draw.sampler_count > 0 &&
+        !AreSamplersBound(bound_samplers, bound_sampler_count, draw.bindings,
+                          draw.sampler_count)) {
+      SDL_BindGPUFragmentSamplers(context.pass, 0u, draw.bindings.data(),
+                                  draw.sampler_count);
+      CountSamplerBind();
+      // Slots past the sampler count keep what was bound before.
+      std::copy_n(draw.bindings.begin(), draw.sampler_count,
+                  bound_samplers.begin());
+      bound_sampler_count = std::max(bound_sampler_count, draw.sampler_count);
+    }
+    if (culler_) {
+      culler_->Draw(context.pass, draw.draw);
       continue;
     }
-
-    const auto binding = SDL_GPUTextureSamplerBinding{
-        .texture =
-            textures_.at(draw.base_color_texture->texture).texture.get().value,
-        .sampler = PickSampler(draw.base_color_texture->sampler),
-    };
-    SDL_BindGPUFragmentSamplers(context.pass, 0u, &binding, 1u);
-
-    SDL_DrawGPUIndexedPrimitives(context.pass,                        //
-                                 draw.last_index - draw.first_index,  //
-                                 1u,                                  //
-                                 draw.first_index,                    //
-                                 draw.first_vertex,                   //
-                                 0u                                   //
+    SDL_DrawGPUIndexedPrimitives(context.pass,       //
+                                 draw.index_count,   //
+                                 1u,                 //
+                                 draw.first_index,   //
+                                 draw.first_vertex,  //
+                                 0u                  //
     );
+    CountDraw();
   }
 
   return true;
@@ -534,4 +594,41 @@ SDL_GPUSampler* Model::PickSampler(std::optional<size_t> index) const {
   return samplers_.at(index.value()).get().value;
 }
 
+std::optional<Model::TextureBinding> Model::ResolveTexture(
+    const tinygltf::Model& model,
+    int texture_index) const {
+  if (texture_index < 0 ||
+      static_cast<size_t>(texture_index) >= model.textures.size()) {
+    return std::nullopt;
+  }
+  const auto& texture = model.textures[texture_index];
+  size_t sampler_index = glm::clamp<int>(texture.sampler, 0u, samplers_.size());
+  const auto image_texture = image_textures_.find(texture.source);
+  if (texture.source < 0 || image_texture == image_textures_.end()) {
+    return std::nullopt;
+  }
+  auto binding = TextureBinding{
+      .texture = image_texture->second,
+  };
+  // The sampler is optional. A default will be picked if none is specified.
+  if (samplers_.contains(sampler_index)) {
+    binding.sampler = sampler_index;
+  }
+  return binding;
+}
+
+SDL_GPUTextureSamplerBinding Model::PickTextureBinding(
+    const std::optional<TextureBinding>& binding) const {
+  if (!binding.has_value()) {
+    return SDL_GPUTextureSamplerBinding{
+        .texture = default_texture_.texture.get().value,
+        .sampler = default_sampler_.get().value,
+    };
+  }
+  return SDL_GPUTextureSamplerBinding{
+      .texture = textures_->GetTexture(binding->texture),
+      .sampler = PickSampler(binding->sampler),
+  };
+}
+
 }  // namespace ts
@@ -2,11 +2,23 @@
 
 #include <fml/macros.h>
 #include <fml/mapping.h>
+#include <array>
+#include <memory>
 #include <unordered_map>
 #include "buffer.h"
 #include "context.h"
+#include "draw_queue.h"
 #include "drawable.h"
+#include "model_animation.h"
+#include "model_culler.h"
+#include "model_shader.h"
+#include "model_skinner.h"
 #include "sdl_types.h"
+#include "texture_streamer.h"
+
+namespace tinygltf {
+class Model;
+}  // namespace tinygltf
 
 namespace ts {
 
@@ -18,33 +30,128 @@ class Model final : public Drawable {
 
   bool IsValid() const;
 
+  // An estimate of the device memory held by the buffers and textures of the
+  // model. Pipelines are shared with other models and not included.
+  size_t GetGPUMemorySize() const;
+
+  const TextureStreamer::Stats& GetTextureStreamingStats() const;
+
+  // None if the model isn't culled.
+  std::optional<ModelCuller::Stats> GetCullingStats() const;
+
+  bool Prepare(const DrawContext& context) override;
+
   bool Draw(const DrawContext& context) override;
 
+  bool ReloadShaders(const Context& ctx) override;
+
+  // Builds every model shader permutation into the pipeline cache of the
+  // context so that loading models later doesn't hitch.
+  static bool WarmUpPipelines(const Context& ctx);
+
  private:
   struct TextureBinding {
+    // A texture of the streamer.
     size_t texture = {};
     std::optional<size_t> sampler = {};
   };
+  struct Uniforms {
+    glm::mat4 mvp;
+    glm::vec4 base_color_factor;
+    float alpha_cutoff;
+    float padding[3];
+  };
+  // Everything needed to encode a draw call. Resolved off the render thread.
+  struct PreparedDraw {
+    SDL_GPUGraphicsPipeline* pipeline = nullptr;
+    Uniforms uniforms = {};
+    std::array<SDL_GPUTextureSamplerBinding, 2u> bindings = {};
+    Uint32 sampler_count = 0u;
+    Uint32 first_index = 0u;
+    Uint32 index_count = 0u;
+    Uint32 first_vertex = 0u;
+    // The index of the draw call. Culled draws are drawn by range.
+    Uint32 draw = 0u;
+  };
   struct DrawCall {
     Uint32 first_index = {};
     Uint32 last_index = {};
     Uint32 first_vertex = {};
+    ModelShaderKey shader_key = {};
+    DrawPass pass = DrawPass::kOpaque;
+    // The glTF material index plus one. Zero if the primitive has none.
+    uint16_t material = 0u;
+    // The center of the bounds of the primitive. Used to sort by depth.
+    glm::vec3 center = glm::vec3{0.0f};
+    // Half the diagonal of the bounds.
+    float radius = 0.0f;
+    // See ModelPrimitive::uv_density.
+    float uv_density = 0.0f;
+    glm::vec4 base_color_factor = glm::vec4{1.0f};
+    float alpha_cutoff = 0.5f;
     std::optional<TextureBinding> base_color_texture;
+    std::optional<TextureBinding> normal_texture;
   };
   UniqueGPUSampler default_sampler_;
-  UniqueGPUGraphicsPipeline pipeline_;
+  // Bound in place of textures a permutation samples but a draw doesn't have.
+  GPUTexture default_texture_;
+  using PipelineSet =
+      std::array<SharedGPUGraphicsPipeline, kModelShaderPermutationCount>;
+  // Indexed by the shader key. Only the permutations used by the draws are
+  // fetched from the pipeline cache.
+  PipelineSet pipelines_;
+  // The same permutations with blending enabled for transparent draws.
+  PipelineSet blend_pipelines_;
   UniqueGPUBuffer vertex_buffer_;
   UniqueGPUBuffer index_buffer_;
   Uint32 index_count_;
-  std::unordered_map<size_t, GPUTexture> textures_;
+  // Excluding the skinner.
+  size_t buffer_size_ = 0u;
+  // Texture bindings refer to streamed textures.
+  std::unique_ptr<TextureStreamer> textures_;
+  // The streamed texture of each glTF image that could be loaded.
+  std::unordered_map<size_t, size_t> image_textures_;
   std::unordered_map<size_t, UniqueGPUSampler> samplers_;
   std::vector<DrawCall> draws_;
+  std::vector<PreparedDraw> prepared_draws_;
+  std::vector<DrawPacket> packets_;
+  std::vector<DrawPacket> packets_scratch_;
+  ModelRig rig_;
+  // Animations are sampled on the jobs.
+  JobSystem* jobs_ = nullptr;
+  // Only created if a mesh is skinned. Its vertices are drawn in place of the
+  // vertex buffer.
+  std::unique_ptr<ModelSkinner> skinner_;
+  std::vector<ModelNodeTransform> pose_;
+  std::vector<glm::mat4> node_matrices_;
+  std::vector<glm::mat4> joint_matrices_;
+  // Only created if no mesh is skinned. Each draw call is a range of meshlets
+  // drawn indirectly.
+  std::unique_ptr<ModelCuller> culler_;
   bool is_valid_ = false;
 
-  bool BuildPipeline(const Context& ctx);
+  static SharedGPUGraphicsPipeline BuildPipeline(const Context& ctx,
+                                                 ModelShaderKey key,
+                                                 bool blend);
+
+  bool BuildPipelines(const Context& ctx);
+
+  // Poses the skeleton with the first animation at the time and skins the
+  // vertices with it.
+  bool Animate(float time);
+
+  // Asks for the mip level of each texture that samples about one texel per
+  // pixel at the distance of the nearest draw using it.
+  void RequestTextureLevels(const DrawContext& context);
+
+  std::optional<TextureBinding> ResolveTexture(const tinygltf::Model& model,
+                                               int texture_index) const;
 
   SDL_GPUSampler* PickSampler(std::optional<size_t> index) const;
 
+  SDL_GPUTextureSamplerBinding PickTextureBinding(
+      const std::optional<TextureBinding>& binding) const;
+
   FML_DISALLOW_COPY_ASSIGN_AND_MOVE(Model);
 };
 
@@ -0,0 +1,494 @@
+#include "model_animation.h"
+
+#include <fml/logging.h>
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <glm/ext/matrix_transform.hpp>
+#include <limits>
+#include <set>
+#include "job_system.h"
+#include "profiler.h"
+
+namespace ts {
+
+glm::mat4 ModelNodeTransform::ToMatrix() const {
+  if (matrix.has_value()) {
+    return matrix.value();
+  }
+  return glm::translate(glm::mat4{1.0f}, translation) *
+         glm::mat4_cast(rotation) * glm::scale(glm::mat4{1.0f}, scale);
+}
+
+// Reads an accessor of floats with the given number of components per
+// element. Empty if the accessor has another layout.
+static std::vector<float> ReadFloatAccessor(const tinygltf::Model& model,
+                                            int accessor_index,
+                                            int component_count) {
+  if (accessor_index < 0 ||
+      static_cast<size_t>(accessor_index) >= model.accessors.size()) {
+    return {};
+  }
+  const auto& accessor = model.accessors[accessor_index];
+  if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ||
+      tinygltf::GetNumComponentsInType(accessor.type) != component_count ||
+      accessor.bufferView < 0) {
+    return {};
+  }
+  const auto& buffer_view = model.bufferViews[accessor.bufferView];
+  const auto& buffer = model.buffers[buffer_view.buffer];
+  const auto stride = accessor.ByteStride(buffer_view);
+  const auto* data_ptr =
+      buffer.data.data() + accessor.byteOffset + buffer_view.byteOffset;
+  std::vector<float> values(accessor.count * component_count);
+  for (size_t i = 0; i < accessor.count; i++) {
+    std::memcpy(values.data() + i * component_count, data_ptr + stride * i,
+                component_count * sizeof(float));
+  }
+  return values;
+}
+
+static std::optional<AnimationChannel> ReadAnimationChannel(
+    const tinygltf::Model& model,
+    const tinygltf::Animation& animation,
+    const tinygltf::AnimationChannel& gltf_channel) {
+  if (gltf_channel.target_node < 0 ||
+      static_cast<size_t>(gltf_channel.target_node) >= model.nodes.size() ||
+      gltf_channel.sampler < 0 ||
+      static_cast<size_t>(gltf_channel.sampler) >= animation.samplers.size()) {
+    return std::nullopt;
+  }
+  AnimationChannel channel;
+  channel.node = gltf_channel.target_node;
+  int component_count = 3;
+  if (gltf_channel.target_path == "translation") {
+    channel.path = AnimationPath::kTranslation;
+  } else if (gltf_channel.target_path == "rotation") {
+    channel.path = AnimationPath::kRotation;
+    component_count = 4;
+  } else if (gltf_channel.target_path == "scale") {
+    channel.path = AnimationPath::kScale;
+  } else {
+    // Morph target weights are not supported.
+    return std::nullopt;
+  }
+  const auto& sampler = animation.samplers[gltf_channel.sampler];
+  if (sampler.interpolation == "STEP") {
+    channel.interpolation = AnimationInterpolation::kStep;
+  } else if (sampler.interpolation == "CUBICSPLINE") {
+    channel.interpolation = AnimationInterpolation::kCubicSpline;
+  }
+  channel.times = ReadFloatAccessor(model, sampler.input, 1);
+  const auto values =
+      ReadFloatAccessor(model, sampler.output, component_count);
+  const size_t values_per_key =
+      channel.interpolation == AnimationInterpolation::kCubicSpline ? 3u : 1u;
+  if (channel.times.empty() ||
+      values.size() !=
+          channel.times.size() * values_per_key * component_count) {
+    FML_LOG(ERROR) << "Could not read animation channel of "
+                   << animation.name << ".";
+    return std::nullopt;
+  }
+  channel.values.resize(values.size() / component_count);
+  for (size_t i = 0; i < channel.values.size(); i++) {
+    std::memcpy(&channel.values[i], values.data() + i * component_count,
+                component_count * sizeof(float));
+  }
+  return channel;
+}
+
+ModelRig ReadModelRig(const tinygltf::Model& model) {
+  TS_PROFILE_SCOPE("ReadModelRig");
+  ModelRig rig;
+  const auto node_count = model.nodes.size();
+  rig.parents.assign(node_count, -1);
+  rig.rest_pose.resize(node_count);
+  for (size_t i = 0; i < node_count; i++) {
+    const auto& node = model.nodes[i];
+    for (const auto child : node.children) {
+      if (child >= 0 && static_cast<size_t>(child) < node_count) {
+        rig.parents[child] = static_cast<int>(i);
+      }
+    }
+    auto& transform = rig.rest_pose[i];
+    if (node.matrix.size() == 16u) {
+      glm::mat4 matrix;
+      for (int j = 0; j < 16; j++) {
+        matrix[j / 4][j % 4] = static_cast<float>(node.matrix[j]);
+      }
+      transform.matrix = matrix;
+      continue;
+    }
+    if (node.translation.size() == 3u) {
+      transform.translation = glm::vec3{
+          node.translation[0], node.translation[1], node.translation[2]};
+    }
+    if (node.rotation.size() == 4u) {
+      transform.rotation = glm::quat{
+          static_cast<float>(node.rotation[3]),
+          static_cast<float>(node.rotation[0]),
+          static_cast<float>(node.rotation[1]),
+          static_cast<float>(node.rotation[2]),
+      };
+    }
+    if (node.scale.size() == 3u) {
+      transform.scale =
+          glm::vec3{node.scale[0], node.scale[1], node.scale[2]};
+    }
+  }
+
+  // Walk down from the roots so that parents come first.
+  rig.order.reserve(node_count);
+  for (size_t i = 0; i < node_count; i++) {
+    if (rig.parents[i] < 0) {
+      rig.order.push_back(i);
+    }
+  }
+  for (size_t i = 0; i < rig.order.size(); i++) {
+    for (const auto child : model.nodes[rig.order[i]].children) {
+      if (child >= 0 && static_cast<size_t>(child) < node_count &&
+          rig.parents[child] == static_cast<int>(rig.order[i])) {
+        rig.order.push_back(child);
+      }
+    }
+  }
+
+  for (const auto& gltf_skin : model.skins) {
+    ModelSkin skin;
+    skin.first_joint = rig.joint_count;
+    for (const auto joint : gltf_skin.joints) {
+      skin.joints.push_back(
+          std::clamp<size_t>(joint, 0u, std::max<size_t>(node_count, 1u) - 1u));
+    }
+    skin.inverse_bind_matrices.assign(skin.joints.size(), glm::mat4{1.0f});
+    const auto matrices =
+        ReadFloatAccessor(model, gltf_skin.inverseBindMatrices, 16);
+    if (matrices.size() >= skin.joints.size() * 16u) {
+      std::memcpy(skin.inverse_bind_matrices.data(), matrices.data(),
+                  skin.joints.size() * sizeof(glm::mat4));
+    }
+    rig.joint_count += skin.joints.size();
+    rig.skins.push_back(std::move(skin));
+  }
+
+  for (const auto& gltf_animation : model.animations) {
+    std::vector<AnimationChannel> channels;
+    for (const auto& gltf_channel : gltf_animation.channels) {
+      auto channel = ReadAnimationChannel(model, gltf_animation, gltf_channel);
+      if (channel.has_value()) {
+        channels.push_back(std::move(channel.value()));
+      }
+    }
+    rig.animations.push_back(
+        MakeModelAnimation(gltf_animation.name, channels));
+  }
+  return rig;
+}
+
+// Channels of the same kind share blocks.
+static int GetChannelKind(const AnimationChannel& channel) {
+  return static_cast<int>(channel.interpolation) * 2 +
+         (channel.path == AnimationPath::kRotation ? 1 : 0);
+}
+
+static bool IsChannelValid(const AnimationChannel& channel) {
+  const size_t values_per_key =
+      channel.interpolation == AnimationInterpolation::kCubicSpline ? 3u : 1u;
+  return !channel.times.empty() &&
+         channel.values.size() == channel.times.size() * values_per_key &&
+         channel.node < ModelAnimation::kNoNode;
+}
+
+ModelAnimation MakeModelAnimation(
+    std::string name,
+    const std::vector<AnimationChannel>& channels) {
+  TS_PROFILE_SCOPE("MakeModelAnimation");
+  constexpr auto kLanes = ModelAnimation::kLanes;
+  ModelAnimation animation;
+  animation.name = std::move(name);
+
+  // Lanes write their results concurrently so no two may share a target.
+  std::vector<const AnimationChannel*> sorted;
+  std::set<std::pair<size_t, AnimationPath>> targets;
+  for (const auto& channel : channels) {
+    if (IsChannelValid(channel) &&
+        targets.emplace(channel.node, channel.path).second) {
+      sorted.push_back(&channel);
+    }
+  }
+  std::ranges::stable_sort(sorted, {}, [](const AnimationChannel* channel) {
+    return GetChannelKind(*channel);
+  });
+  animation.channel_count = sorted.size();
+
+  const auto append_lane = [&](const AnimationChannel& channel, Uint32 node) {
+    animation.nodes.push_back(node);
+    animation.paths.push_back(channel.path);
+    animation.first_keys.push_back(animation.times.size());
+    animation.key_counts.push_back(channel.times.size());
+    animation.first_values.push_back(animation.values[0].size());
+    animation.times.insert(animation.times.end(), channel.times.begin(),
+                           channel.times.end());
+    for (const auto& value : channel.values) {
+      for (int component = 0; component < 4; component++) {
+        animation.values[component].push_back(value[component]);
+      }
+    }
+  };
+  for (size_t i = 0; i < sorted.size();) {
+    const auto& first = *sorted[i];
+    const auto kind = GetChannelKind(first);
+    const auto first_lane = animation.nodes.size();
+    Uint32 longest = 1u;
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      if (i < sorted.size() && GetChannelKind(*sorted[i]) == kind) {
+        const auto& channel = *sorted[i++];
+        append_lane(channel, static_cast<Uint32>(channel.node));
+        longest = std::max<Uint32>(longest, channel.times.size());
+        animation.duration =
+            std::max(animation.duration, channel.times.back());
+        animation.animated_nodes.push_back(channel.node);
+        continue;
+      }
+      // Padding repeats the first lane of the block without a target.
+      animation.nodes.push_back(ModelAnimation::kNoNode);
+      animation.paths.push_back(first.path);
+      animation.first_keys.push_back(animation.first_keys[first_lane]);
+      animation.key_counts.push_back(animation.key_counts[first_lane]);
+      animation.first_values.push_back(animation.first_values[first_lane]);
+    }
+    Uint32 search_steps = 0u;
+    while ((Uint32{1u} << search_steps) < longest) {
+      search_steps++;
+    }
+    animation.blocks.push_back(ModelAnimation::Block{
+        .interpolation = first.interpolation,
+        .rotation = first.path == AnimationPath::kRotation,
+        .search_steps = search_steps,
+    });
+  }
+
+  std::ranges::sort(animation.animated_nodes);
+  const auto duplicates = std::ranges::unique(animation.animated_nodes);
+  animation.animated_nodes.erase(duplicates.begin(), duplicates.end());
+  return animation;
+}
+
+using Lanes = std::array<float, ModelAnimation::kLanes>;
+
+// Samples the channels of a block and writes the results into the pose. Every
+// step loops over all lanes of the block so that the loops vectorize.
+static void SampleBlock(const ModelAnimation& animation,
+                        size_t block_index,
+                        float time,
+                        std::vector<ModelNodeTransform>& pose) {
+  constexpr auto kLanes = ModelAnimation::kLanes;
+  const auto& block = animation.blocks[block_index];
+  const auto first_lane = block_index * kLanes;
+  const auto* first_keys = animation.first_keys.data() + first_lane;
+  const auto* key_counts = animation.key_counts.data() + first_lane;
+  const auto* first_values = animation.first_values.data() + first_lane;
+  const auto* times = animation.times.data();
+
+  // A branchless binary search for the last keyframe at or before the time.
+  // It stays at the first keyframe if the time is before it.
+  std::array<Uint32, kLanes> previous;
+  std::array<Uint32, kLanes> remaining;
+  for (size_t lane = 0; lane < kLanes; lane++) {
+    previous[lane] = first_keys[lane];
+    remaining[lane] = key_counts[lane];
+  }
+  for (Uint32 step = 0; step < block.search_steps; step++) {
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      const auto half = remaining[lane] / 2u;
+      const auto middle = previous[lane] + half;
+      previous[lane] = times[middle] <= time ? middle : previous[lane];
+      remaining[lane] -= half;
+    }
+  }
+
+  const auto cubic =
+      block.interpolation == AnimationInterpolation::kCubicSpline;
+  const Uint32 stride = cubic ? 3u : 1u;
+  const Uint32 offset = cubic ? 1u : 0u;
+  std::array<Uint32, kLanes> previous_values;
+  std::array<Uint32, kLanes> next_values;
+  Lanes spans;
+  Lanes t;
+  for (size_t lane = 0; lane < kLanes; lane++) {
+    const auto last = first_keys[lane] + key_counts[lane] - 1u;
+    const auto next = std::min(previous[lane] + 1u, last);
+    const auto span = times[next] - times[previous[lane]];
+    spans[lane] = span;
+    t[lane] = span > 0.0f
+                  ? std::clamp((time - times[previous[lane]]) / span, 0.0f,
+                               1.0f)
+                  : 0.0f;
+    previous_values[lane] =
+        first_values[lane] + (previous[lane] - first_keys[lane]) * stride +
+        offset;
+    next_values[lane] =
+        first_values[lane] + (next - first_keys[lane]) * stride + offset;
+  }
+
+  const auto component_count = block.rotation ? 4 : 3;
+  std::array<Lanes, 4> result = {};
+  for (int component = 0; component < component_count; component++) {
+    const auto* values = animation.values[component].data();
+    auto& out = result[component];
+    switch (block.interpolation) {
+      case AnimationInterpolation::kStep:
+        for (size_t lane = 0; lane < kLanes; lane++) {
+          out[lane] = values[previous_values[lane]];
+        }
+        break;
+      case AnimationInterpolation::kLinear:
+        // Rotations are interpolated below.
+        for (size_t lane = 0; lane < kLanes; lane++) {
+          const auto a = values[previous_values[lane]];
+          const auto b = values[next_values[lane]];
+          out[lane] = a + (b - a) * t[lane];
+        }
+        break;
+      case AnimationInterpolation::kCubicSpline:
+        for (size_t lane = 0; lane < kLanes; lane++) {
+          const auto s = t[lane];
+          const auto s2 = s * s;
+          const auto s3 = s2 * s;
+          // The out-tangent of the previous keyframe follows its value and
+          // the in-tangent of the next one precedes it.
+          const auto out_tangent = values[previous_values[lane] + 1u];
+          const auto in_tangent = values[next_values[lane] - 1u];
+          out[lane] = (2.0f * s3 - 3.0f * s2 + 1.0f) *
+                          values[previous_values[lane]] +
+                      (s3 - 2.0f * s2 + s) * out_tangent * spans[lane] +
+                      (-2.0f * s3 + 3.0f * s2) * values[next_values[lane]] +
+                      (s3 - s2) * in_tangent * spans[lane];
+        }
+        break;
+    }
+  }
+
+  if (block.rotation &&
+      block.interpolation == AnimationInterpolation::kLinear) {
+    // Spherical interpolation along the shortest path like glm::slerp.
+    Lanes weights_a;
+    Lanes weights_b;
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      float cosine = 0.0f;
+      for (int component = 0; component < 4; component++) {
+        cosine += animation.values[component][previous_values[lane]] *
+                  animation.values[component][next_values[lane]];
+      }
+      const auto sign = cosine < 0.0f ? -1.0f : 1.0f;
+      cosine *= sign;
+      const auto angle = std::acos(std::min(cosine, 1.0f));
+      const auto sine = std::sin(angle);
+      // Nearly equal rotations are interpolated linearly.
+      const auto nearly_equal =
+          cosine > 1.0f - std::numeric_limits<float>::epsilon();
+      weights_a[lane] = nearly_equal
+                            ? 1.0f - t[lane]
+                            : std::sin((1.0f - t[lane]) * angle) / sine;
+      weights_b[lane] =
+          sign * (nearly_equal ? t[lane] : std::sin(t[lane] * angle) / sine);
+    }
+    for (int component = 0; component < 4; component++) {
+      const auto* values = animation.values[component].data();
+      for (size_t lane = 0; lane < kLanes; lane++) {
+        result[component][lane] =
+            values[previous_values[lane]] * weights_a[lane] +
+            values[next_values[lane]] * weights_b[lane];
+      }
+    }
+  }
+
+  if (block.rotation) {
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      float length_squared = 0.0f;
+      for (int component = 0; component < 4; component++) {
+        length_squared += result[component][lane] * result[component][lane];
+      }
+      const auto scale =
+          length_squared > 0.0f ? 1.0f / std::sqrt(length_squared) : 0.0f;
+      for (int component = 0; component < 4; component++) {
+        result[component][lane] *= scale;
+      }
+    }
+  }
+
+  for (size_t lane = 0; lane < kLanes; lane++) {
+    const auto node = animation.nodes[first_lane + lane];
+    if (node == ModelAnimation::kNoNode) {
+      continue;
+    }
+    auto& transform = pose[node];
+    const auto value = glm::vec3{result[0][lane], result[1][lane],
+                                 result[2][lane]};
+    switch (animation.paths[first_lane + lane]) {
+      case AnimationPath::kTranslation:
+        transform.translation = value;
+        break;
+      case AnimationPath::kRotation:
+        transform.rotation = glm::quat{result[3][lane], value.x, value.y,
+                                       value.z};
+        break;
+      case AnimationPath::kScale:
+        transform.scale = value;
+        break;
+    }
+  }
+}
+
+void SampleAnimation(const ModelRig& rig,
+                     const ModelAnimation& animation,
+                     float time,
+                     std::vector<ModelNodeTransform>& pose,
+                     JobSystem& jobs) {
+  TS_PROFILE_SCOPE("SampleAnimation");
+  // Enough work per job to amortize scheduling. Smaller animations are
+  // sampled on the calling thread.
+  constexpr size_t kBlocksPerJob = 64u;
+  pose = rig.rest_pose;
+  if (animation.duration > 0.0f) {
+    time = std::fmod(time, animation.duration);
+    if (time < 0.0f) {
+      time += animation.duration;
+    }
+  }
+  for (const auto node : animation.animated_nodes) {
+    pose[node].matrix.reset();
+  }
+  jobs.ParallelFor(animation.blocks.size(), kBlocksPerJob,
+                   [&](size_t begin, size_t end) {
+                     for (size_t block = begin; block < end; block++) {
+                       SampleBlock(animation, block, time, pose);
+                     }
+                   });
+}
+
+void ComputeJointMatrices(const ModelRig& rig,
+                          const std::vector<ModelNodeTransform>& pose,
+                          std::vector<glm::mat4>& node_matrices,
+                          std::vector<glm::mat4>& joints) {
+  TS_PROFILE_SCOPE("ComputeJointMatrices");
+  node_matrices.resize(pose.size());
+  for (const auto node : rig.order) {
+    const auto local = pose[node].ToMatrix();
+    const auto parent = rig.parents[node];
+    node_matrices[node] =
+        parent >= 0 ? node_matrices[parent] * local : local;
+  }
+  joints.resize(rig.joint_count);
+  for (const auto& skin : rig.skins) {
+    for (size_t i = 0; i < skin.joints.size(); i++) {
+      joints[skin.first_joint + i] =
+          node_matrices[skin.joints[i]] * skin.inverse_bind_matrices[i];
+    }
+  }
+}
+
+}  // namespace ts
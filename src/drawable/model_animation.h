@@ -0,0 +1,136 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+#include "sdl_types.h"
+
+namespace tinygltf {
+class Model;
+}  // namespace tinygltf
+
+namespace ts {
+
+class JobSystem;
+
+// The local transform of a glTF node.
+struct ModelNodeTransform {
+  glm::vec3 translation = glm::vec3{0.0f};
+  glm::quat rotation = glm::quat{1.0f, 0.0f, 0.0f, 0.0f};
+  glm::vec3 scale = glm::vec3{1.0f};
+  // Used instead of the above if the node specifies a matrix. Animated nodes
+  // never do.
+  std::optional<glm::mat4> matrix;
+
+  glm::mat4 ToMatrix() const;
+};
+
+enum class AnimationPath {
+  kTranslation,
+  kRotation,
+  kScale,
+};
+
+enum class AnimationInterpolation {
+  kStep,
+  kLinear,
+  kCubicSpline,
+};
+
+// The keyframes of one property of one node as read from glTF.
+struct AnimationChannel {
+  size_t node = 0u;
+  AnimationPath path = AnimationPath::kTranslation;
+  AnimationInterpolation interpolation = AnimationInterpolation::kLinear;
+  // In seconds and ascending.
+  std::vector<float> times;
+  // One value per keyframe or, for cubic splines, the in-tangent, value and
+  // out-tangent of each. Vectors are in xyz and rotations are quaternions in
+  // xyzw.
+  std::vector<glm::vec4> values;
+};
+
+// The channels of an animation converted into structure-of-arrays keyframe
+// tables. Channels are grouped into blocks of kLanes with the same
+// interpolation and kind of value so that every lane of a block runs the same
+// code. Blocks are padded with lanes that target no node.
+struct ModelAnimation {
+  // The number of channels sampled together. Each lane of a block samples one
+  // channel.
+  static constexpr size_t kLanes = 8u;
+  static constexpr Uint32 kNoNode = ~Uint32{0u};
+
+  struct Block {
+    AnimationInterpolation interpolation = AnimationInterpolation::kLinear;
+    bool rotation = false;
+    // Enough binary search steps for the longest channel of the block.
+    Uint32 search_steps = 0u;
+  };
+
+  std::string name;
+  // The time of the last keyframe of any channel.
+  float duration = 0.0f;
+  std::vector<Block> blocks;
+  // Per lane.
+  std::vector<Uint32> nodes;
+  std::vector<AnimationPath> paths;
+  std::vector<Uint32> first_keys;
+  std::vector<Uint32> key_counts;
+  std::vector<Uint32> first_values;
+  // Per keyframe. In seconds and ascending for each channel.
+  std::vector<float> times;
+  // Per value and component. Laid out like AnimationChannel::values.
+  std::vector<float> values[4];
+  // Every node with a channel.
+  std::vector<Uint32> animated_nodes;
+  // Excluding padding.
+  size_t channel_count = 0u;
+};
+
+struct ModelSkin {
+  // Node indices.
+  std::vector<size_t> joints;
+  std::vector<glm::mat4> inverse_bind_matrices;
+  // Where the joints of the skin start in the joint palette.
+  Uint32 first_joint = 0u;
+};
+
+// The node hierarchy of a model along with its skins and animations. The
+// joint palette holds the joints of every skin in order.
+struct ModelRig {
+  // The parent of each node or -1 for roots.
+  std::vector<int> parents;
+  // Every node index with parents before their children.
+  std::vector<size_t> order;
+  std::vector<ModelNodeTransform> rest_pose;
+  std::vector<ModelSkin> skins;
+  std::vector<ModelAnimation> animations;
+  Uint32 joint_count = 0u;
+};
+
+ModelRig ReadModelRig(const tinygltf::Model& model);
+
+// Converts the channels into keyframe tables. Only the first channel of each
+// node and path is kept.
+ModelAnimation MakeModelAnimation(
+    std::string name,
+    const std::vector<AnimationChannel>& channels);
+
+// Writes the rest pose with the animation applied at the time into pose. The
+// animation loops. Large animations are sampled concurrently on the jobs.
+void SampleAnimation(const ModelRig& rig,
+                     const ModelAnimation& animation,
+                     float time,
+                     std::vector<ModelNodeTransform>& pose,
+                     JobSystem& jobs);
+
+// Writes the joint palette of the pose into joints. node_matrices is scratch
+// space for the model space transform of each node.
+void ComputeJointMatrices(const ModelRig& rig,
+                          const std::vector<ModelNodeTransform>& pose,
+                          std::vector<glm::mat4>& node_matrices,
+                          std::vector<glm::mat4>& joints);
+
+}  // namespace ts
@@ -0,0 +1,79 @@
+#include "model_cache.h"
+
+#include "profiler.h"
+
+namespace ts {
+
+ModelCache::ModelCache(size_t budget) : budget_(budget) {}
+
+ModelCache::~ModelCache() = default;
+
+Model* ModelCache::Get(const std::string& name,
+                       const std::function<std::unique_ptr<Model>()>& load) {
+  TS_PROFILE_SCOPE("ModelCache::Get");
+  if (auto found = index_.find(name); found != index_.end()) {
+    stats_.hits++;
+    entries_.splice(entries_.begin(), entries_, found->second);
+    // The textures of models grow as they stream.
+    Evict();
+    return entries_.front().model.get();
+  }
+  stats_.misses++;
+  auto model = load();
+  if (!model || !model->IsValid()) {
+    return nullptr;
+  }
+  entries_.push_front(Entry{
+      .name = name,
+      .model = std::move(model),
+  });
+  index_[name] = entries_.begin();
+  Evict();
+  return entries_.front().model.get();
+}
+
+bool ModelCache::ReloadShaders(const Context& ctx) {
+  auto reloaded = true;
+  for (const auto& entry : entries_) {
+    reloaded = entry.model->ReloadShaders(ctx) && reloaded;
+  }
+  return reloaded;
+}
+
+void ModelCache::SetBudget(size_t budget) {
+  budget_ = budget;
+  Evict();
+}
+
+size_t ModelCache::GetBudget() const {
+  return budget_;
+}
+
+size_t ModelCache::GetSize() const {
+  size_t size = 0u;
+  for (const auto& entry : entries_) {
+    size += entry.model->GetGPUMemorySize();
+  }
+  return size;
+}
+
+size_t ModelCache::GetCount() const {
+  return entries_.size();
+}
+
+const ModelCache::Stats& ModelCache::GetStats() const {
+  return stats_;
+}
+
+void ModelCache::Evict() {
+  auto size = GetSize();
+  while (size > budget_ && entries_.size() > 1u) {
+    const auto& entry = entries_.back();
+    size -= entry.model->GetGPUMemorySize();
+    index_.erase(entry.name);
+    entries_.pop_back();
+    stats_.evictions++;
+  }
+}
+
+}  // namespace ts
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "model.h"
+
+namespace ts {
+
+// Keeps recently used models loaded so that switching back to one doesn't
+// parse and upload it again. Least recently used models are evicted once the
+// GPU memory of the cached models exceeds the budget. The most recently used
+// model is always kept even if it alone exceeds the budget.
+class ModelCache {
+ public:
+  static constexpr size_t kDefaultBudget = 512u << 20u;
+
+  struct Stats {
+    size_t hits = 0u;
+    size_t misses = 0u;
+    size_t evictions = 0u;
+  };
+
+  explicit ModelCache(size_t budget = kDefaultBudget);
+
+  ~ModelCache();
+
+  // Returns the cached model with the name or loads it. Models that fail to
+  // load are not cached and nullptr is returned. The model stays valid till
+  // another is fetched.
+  Model* Get(const std::string& name,
+             const std::function<std::unique_ptr<Model>()>& load);
+
+  // Reloads the shaders of every cached model so that switching back to one
+  // picks up edits.
+  bool ReloadShaders(const Context& ctx);
+
+  // Evicts models as necessary to fit the new budget.
+  void SetBudget(size_t budget);
+
+  size_t GetBudget() const;
+
+  // The GPU memory of the cached models. Changes as their textures stream.
+  size_t GetSize() const;
+
+  size_t GetCount() const;
+
+  const Stats& GetStats() const;
+
+ private:
+  struct Entry {
+    std::string name;
+    std::unique_ptr<Model> model;
+  };
+  // Most recently used first.
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  size_t budget_ = 0u;
+  Stats stats_;
+
+  void Evict();
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(ModelCache);
+};
+
+}  // namespace ts
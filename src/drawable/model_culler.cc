@@ -0,0 +1,365 @@
+#include "model_culler.h"
+
+#include <fml/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "frame_counters.h"
+#include "gpu_memory.h"
+#include "graphics_pipeline.h"
+#include "macros.h"
+#include "occlusion_culling.slang.reflection.h"
+#include "occlusion_depth.slang.reflection.h"
+#include "profiler.h"
+#include "shader.h"
+
+namespace ts {
+
+static_assert(sizeof(SDL_GPUIndexedIndirectDrawCommand) == 5u * sizeof(Uint32));
+
+// Small enough for the bounds to be tight and large enough for the draws to
+// stay cheap.
+static constexpr Uint32 kMeshletTriangleCount = 128u;
+static constexpr Uint32 kMeshletIndexCount = 3u * kMeshletTriangleCount;
+
+// The occluders are drawn to the depth buffer and it is reduced into the
+// pyramid.
+static constexpr SDL_GPUTextureUsageFlags kDepthUsage =
+    SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET | SDL_GPU_TEXTUREUSAGE_SAMPLER;
+
+static SharedGPUGraphicsPipeline CreateDepthPipeline(const Context& ctx) {
+  auto code = ctx.GetShaderLibrary().GetBlob("occlusion_depth");
+  if (!code) {
+    return nullptr;
+  }
+  auto& cache = ctx.GetPipelineCache();
+  auto vs = ShaderBuilder{}
+                .SetCode(code.get())
+                .SetReflection(shaders::occlusion_depth::kDepthVertexMain)
+                .Build(ctx.GetDevice(), cache);
+  auto fs = ShaderBuilder{}
+                .SetCode(code.get())
+                .SetReflection(shaders::occlusion_depth::kDepthFragmentMain)
+                .Build(ctx.GetDevice(), cache);
+  if (!vs || !fs) {
+    return nullptr;
+  }
+  // The position is read from the model vertices as they are.
+  return GraphicsPipelineBuilder{}
+      .SetVertexShader(vs.get())
+      .SetFragmentShader(fs.get())
+      .SetPrimitiveType(SDL_GPU_PRIMITIVETYPE_TRIANGLELIST)
+      .SetVertexBuffers({
+          SDL_GPUVertexBufferDescription{
+              .slot = 0u,
+              .pitch = sizeof(ModelVertex),
+              .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
+          },
+      })
+      .SetVertexAttribs({
+          SDL_GPUVertexAttribute{
+              .location = 0u,
+              .buffer_slot = 0u,
+              .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+              .offset = offsetof(ModelVertex, position),
+          },
+      })
+      .SetCullMode(SDL_GPU_CULLMODE_BACK)
+      .SetDepthStencilFormat(ctx.GetDepthFormat())
+      .SetDepthStencilState(SDL_GPUDepthStencilState{
+          .compare_op = SDL_GPU_COMPAREOP_GREATER,
+          .enable_depth_test = true,
+          .enable_depth_write = true,
+      })
+      .Build(ctx.GetDevice(), cache);
+}
+
+static ComputePipeline CreateCullingPipeline(const Context& ctx) {
+  auto code = ctx.GetShaderLibrary().GetBlob("occlusion_culling");
+  if (!code) {
+    return {};
+  }
+  return ComputePipelineBuilder{}
+      .SetShader(code.get())
+      .SetReflection(shaders::occlusion_culling::kCullMeshlets)
+      .Build(ctx.GetDevice());
+}
+
+ModelCuller::ModelCuller(const Context& ctx,
+                         const std::vector<ModelVertex>& vertices,
+                         const std::vector<uint32_t>& indices,
+                         const std::vector<Range>& ranges)
+    : device_(ctx.GetDevice().get()),
+      pool_(&ctx.GetRenderTargetPool()),
+      depth_format_(ctx.GetDepthFormat()),
+      pyramid_(ctx) {
+  TS_GPU_MEMORY_OWNER("ModelCuller");
+  static_assert(sizeof(Meshlet) == 48u);
+  if (!pyramid_.IsValid() || !BuildPipelines(ctx)) {
+    return;
+  }
+
+  std::vector<Meshlet> meshlets;
+  for (const auto& range : ranges) {
+    ranges_.push_back(MeshletRange{
+        .first_meshlet = static_cast<Uint32>(meshlets.size()),
+        .is_occluder = range.is_occluder,
+    });
+    for (auto first = range.first_index; first < range.last_index;
+         first += kMeshletIndexCount) {
+      const auto last = std::min(first + kMeshletIndexCount, range.last_index);
+      auto meshlet = Meshlet{
+          .bounds_min = glm::vec3{std::numeric_limits<float>::max()},
+          .first_index = first,
+          .bounds_max = glm::vec3{std::numeric_limits<float>::lowest()},
+          .index_count = last - first,
+          .vertex_offset = static_cast<Sint32>(range.first_vertex),
+      };
+      for (auto i = first; i < last; i++) {
+        const auto& position =
+            vertices[range.first_vertex + indices[i]].position;
+        meshlet.bounds_min = glm::min(meshlet.bounds_min, position);
+        meshlet.bounds_max = glm::max(meshlet.bounds_max, position);
+      }
+      meshlets.push_back(meshlet);
+    }
+    ranges_.back().meshlet_count =
+        meshlets.size() - ranges_.back().first_meshlet;
+  }
+  meshlet_count_ = meshlets.size();
+  stats_.meshlet_count = meshlet_count_;
+  if (meshlet_count_ == 0u) {
+    is_valid_ = true;
+    return;
+  }
+  if (MakeGroupCount<Uint32>(meshlet_count_,
+                             culling_pipeline_.thread_count.x) > 65535u) {
+    FML_LOG(ERROR) << "Too many meshlets to cull.";
+    return;
+  }
+
+  // Everything is drawn till the first frame is culled.
+  std::vector<SDL_GPUIndexedIndirectDrawCommand> draw_args;
+  draw_args.reserve(meshlets.size());
+  for (const auto& meshlet : meshlets) {
+    draw_args.push_back(SDL_GPUIndexedIndirectDrawCommand{
+        .num_indices = meshlet.index_count,
+        .num_instances = 1u,
+        .first_index = meshlet.first_index,
+        .vertex_offset = meshlet.vertex_offset,
+    });
+  }
+  meshlets_ = PerformHostToDeviceTransfer(
+      ctx.GetDevice(), meshlets, SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ);
+  draw_args_ = PerformHostToDeviceTransfer(
+      ctx.GetDevice(), draw_args,
+      SDL_GPU_BUFFERUSAGE_INDIRECT | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE);
+  if (!meshlets_.is_valid() || !draw_args_.is_valid()) {
+    FML_LOG(ERROR) << "Could not create culling buffers.";
+    return;
+  }
+
+  is_valid_ = true;
+}
+
+ModelCuller::~ModelCuller() = default;
+
+bool ModelCuller::IsValid() const {
+  return is_valid_;
+}
+
+const ModelCuller::Stats& ModelCuller::GetStats() const {
+  return stats_;
+}
+
+size_t ModelCuller::GetGPUMemorySize() const {
+  return meshlet_count_ *
+             (sizeof(Meshlet) + sizeof(SDL_GPUIndexedIndirectDrawCommand)) +
+         depth_.GetSize() + pyramid_.GetGPUMemorySize();
+}
+
+bool ModelCuller::BuildPipelines(const Context& ctx) {
+  auto depth = CreateDepthPipeline(ctx);
+  auto culling = CreateCullingPipeline(ctx);
+  // Built aside so that the previous pipelines are kept on failure.
+  if (!depth || !culling.IsValid()) {
+    FML_LOG(ERROR) << "Could not build culling pipelines.";
+    return false;
+  }
+  depth_pipeline_ = std::move(depth);
+  culling_pipeline_ = std::move(culling);
+  return true;
+}
+
+bool ModelCuller::ReloadShaders(const Context& ctx) {
+  const auto pyramid = pyramid_.ReloadShaders(ctx);
+  return BuildPipelines(ctx) && pyramid;
+}
+
+bool ModelCuller::RecordOccluders(SDL_GPUCommandBuffer* command_buffer,
+                                  const glm::mat4& mvp,
+                                  SDL_GPUBuffer* vertex_buffer,
+                                  SDL_GPUBuffer* index_buffer) const {
+  const auto depth_stencil_info = SDL_GPUDepthStencilTargetInfo{
+      .texture = depth_.Get(),
+      .clear_depth = 0.0f,
+      .load_op = SDL_GPU_LOADOP_CLEAR,
+      .store_op = SDL_GPU_STOREOP_STORE,
+  };
+  auto pass = SDL_BeginGPURenderPass(command_buffer, nullptr, 0u,
+                                     &depth_stencil_info);
+  if (!pass) {
+    FML_LOG(ERROR) << "Could not create render pass: " << SDL_GetError();
+    return false;
+  }
+  FML_DEFER(SDL_EndGPURenderPass(pass));
+  SDL_BindGPUGraphicsPipeline(pass, depth_pipeline_->get().value);
+  CountPipelineBind();
+  const auto vertex_binding = SDL_GPUBufferBinding{
+      .buffer = vertex_buffer,
+  };
+  SDL_BindGPUVertexBuffers(pass, 0u, &vertex_binding, 1u);
+  CountBufferBind();
+  const auto index_binding = SDL_GPUBufferBinding{
+      .buffer = index_buffer,
+  };
+  SDL_BindGPUIndexBuffer(pass, &index_binding, SDL_GPU_INDEXELEMENTSIZE_32BIT);
+  CountBufferBind();
+  const auto uniforms = DepthUniforms{
+      .mvp = mvp,
+  };
+  SDL_PushGPUVertexUniformData(command_buffer, 0u, &uniforms,
+                               sizeof(uniforms));
+  // The draws still hold what survived culling last frame.
+  for (size_t i = 0; i < ranges_.size(); i++) {
+    if (ranges_[i].is_occluder) {
+      Draw(pass, i);
+    }
+  }
+  return true;
+}
+
+bool ModelCuller::RecordCulling(SDL_GPUCommandBuffer* command_buffer,
+                                const glm::mat4& mvp) const {
+  // Not cycled since the draws of the previous frame may still be read.
+  const auto output = SDL_GPUStorageBufferReadWriteBinding{
+      .buffer = draw_args_.get().value,
+  };
+  auto pass = SDL_BeginGPUComputePass(command_buffer, nullptr, 0u, &output, 1u);
+  if (!pass) {
+    FML_LOG(ERROR) << "Could not create compute pass: " << SDL_GetError();
+    return false;
+  }
+  FML_DEFER(SDL_EndGPUComputePass(pass));
+  SDL_BindGPUComputePipeline(pass, culling_pipeline_.pipeline.get().value);
+  CountPipelineBind();
+  const auto pyramid = SDL_GPUTextureSamplerBinding{
+      .texture = pyramid_.GetTexture(),
+      .sampler = pyramid_.GetSampler(),
+  };
+  SDL_BindGPUComputeSamplers(pass, 0u, &pyramid, 1u);
+  CountSamplerBind();
+  const auto meshlets = meshlets_.get().value;
+  SDL_BindGPUComputeStorageBuffers(pass, 0u, &meshlets, 1u);
+  CountStorageBufferBind();
+  const auto uniforms = CullingUniforms{
+      .mvp = mvp,
+      .pyramid_size = pyramid_.GetSize(),
+      .level_count = pyramid_.GetLevelCount(),
+      .meshlet_count = meshlet_count_,
+  };
+  SDL_PushGPUComputeUniformData(command_buffer, 0u, &uniforms,
+                                sizeof(uniforms));
+  SDL_DispatchGPUCompute(
+      pass,
+      MakeGroupCount<Uint32>(meshlet_count_, culling_pipeline_.thread_count.x),
+      1u, 1u);
+  CountDispatch();
+  return true;
+}
+
+bool ModelCuller::Update(const glm::mat4& mvp,
+                         glm::ivec2 viewport,
+                         SDL_GPUBuffer* vertex_buffer,
+                         SDL_GPUBuffer* index_buffer) {
+  TS_PROFILE_SCOPE("ModelCuller::Update");
+  if (!is_valid_) {
+    return false;
+  }
+  // The draws of the last frame are kept while there is nothing to draw to.
+  if (meshlet_count_ == 0u ||
+      glm::any(glm::lessThan(viewport, glm::ivec2{1}))) {
+    return true;
+  }
+  if (!depth_.IsValid() || depth_.GetDescriptor().size != viewport) {
+    depth_ = pool_->Acquire(RenderTargetDescriptor{
+        .size = viewport,
+        .format = depth_format_,
+        .usage = kDepthUsage,
+    });
+    if (!depth_.IsValid()) {
+      return false;
+    }
+  }
+
+  auto command_buffer = SDL_AcquireGPUCommandBuffer(device_);
+  if (!command_buffer) {
+    FML_LOG(ERROR) << "Could not create command buffer: " << SDL_GetError();
+    return false;
+  }
+  SDL_PushGPUDebugGroup(command_buffer, "Occlusion Culling");
+  const auto recorded =
+      RecordOccluders(command_buffer, mvp, vertex_buffer, index_buffer) &&
+      pyramid_.Record(command_buffer, depth_.Get(), viewport) &&
+      RecordCulling(command_buffer, mvp);
+  SDL_PopGPUDebugGroup(command_buffer);
+  if (!recorded) {
+    SDL_CancelGPUCommandBuffer(command_buffer);
+    return false;
+  }
+  if (!SDL_SubmitGPUCommandBuffer(command_buffer)) {
+    FML_LOG(ERROR) << "Could not submit command buffer: " << SDL_GetError();
+    return false;
+  }
+  CountSubmission();
+
+  PollStats();
+  return true;
+}
+
+void ModelCuller::Draw(SDL_GPURenderPass* pass, size_t range) const {
+  const auto& meshlets = ranges_[range];
+  if (meshlets.meshlet_count == 0u) {
+    return;
+  }
+  SDL_DrawGPUIndexedPrimitivesIndirect(
+      pass, draw_args_.get().value,
+      meshlets.first_meshlet * sizeof(SDL_GPUIndexedIndirectDrawCommand),
+      meshlets.meshlet_count);
+  CountDraw();
+}
+
+void ModelCuller::PollStats() {
+  if (draw_args_readback_.IsValid() && !draw_args_readback_.IsReady()) {
+    return;
+  }
+  if (draw_args_readback_.IsValid()) {
+    if (auto bytes = draw_args_readback_.Take(); bytes.has_value()) {
+      const auto count = std::min<size_t>(
+          meshlet_count_,
+          bytes->size() / sizeof(SDL_GPUIndexedIndirectDrawCommand));
+      size_t visible = 0u;
+      for (size_t i = 0; i < count; i++) {
+        SDL_GPUIndexedIndirectDrawCommand draw = {};
+        std::memcpy(&draw, bytes->data() + i * sizeof(draw), sizeof(draw));
+        visible += draw.num_instances;
+      }
+      stats_.visible_meshlet_count = visible;
+    }
+  }
+  draw_args_readback_ = PerformDeviceToHostTransfer(
+      draw_args_, 0u,
+      meshlet_count_ * sizeof(SDL_GPUIndexedIndirectDrawCommand));
+}
+
+}  // namespace ts
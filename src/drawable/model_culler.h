@@ -0,0 +1,128 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "buffer.h"
+#include "compute_pipeline.h"
+#include "context.h"
+#include "hiz_pyramid.h"
+#include "model_loader.h"
+#include "render_target_pool.h"
+#include "sdl_types.h"
+
+namespace ts {
+
+// Culls the meshlets of a model against the view frustum and the depth of
+// what was visible the frame before. Each primitive is split into meshlets
+// of consecutive triangles with bounds of their own.
+//
+// Culling runs in two phases each frame. The occluders that survived the
+// last frame are drawn into a depth buffer of the culler's own and reduced
+// into a Hi-Z pyramid. The bounds of every meshlet are then tested against
+// the pyramid and an indirect draw with or without an instance is written
+// for each. Those draws are both what the frame is drawn with and the
+// occluders the next frame starts from.
+//
+// Meshlets don't move. Skinned models must not be culled.
+class ModelCuller {
+ public:
+  // A range of the index buffer drawn with one draw call.
+  struct Range {
+    Uint32 first_index = 0u;
+    Uint32 last_index = 0u;
+    Uint32 first_vertex = 0u;
+    // Only opaque draws hide what is behind them.
+    bool is_occluder = false;
+  };
+
+  struct Stats {
+    size_t meshlet_count = 0u;
+    // As of the last readback.
+    size_t visible_meshlet_count = 0u;
+  };
+
+  ModelCuller(const Context& ctx,
+              const std::vector<ModelVertex>& vertices,
+              const std::vector<uint32_t>& indices,
+              const std::vector<Range>& ranges);
+
+  ~ModelCuller();
+
+  bool IsValid() const;
+
+  // Draws the occluders, builds the pyramid and culls the meshlets. Recorded
+  // into a command buffer of its own that is submitted before the one the
+  // frame is drawn with.
+  bool Update(const glm::mat4& mvp,
+              glm::ivec2 viewport,
+              SDL_GPUBuffer* vertex_buffer,
+              SDL_GPUBuffer* index_buffer);
+
+  // Encodes the draws of the meshlets of a range. Culled meshlets have no
+  // instances. The pipeline and buffers must be bound.
+  void Draw(SDL_GPURenderPass* pass, size_t range) const;
+
+  const Stats& GetStats() const;
+
+  // The bytes of the buffers and textures the culler owns.
+  size_t GetGPUMemorySize() const;
+
+  bool ReloadShaders(const Context& ctx);
+
+ private:
+  // Must match Meshlet in occlusion_culling.slang.
+  struct Meshlet {
+    glm::vec3 bounds_min = {};
+    Uint32 first_index = 0u;
+    glm::vec3 bounds_max = {};
+    Uint32 index_count = 0u;
+    Sint32 vertex_offset = 0;
+    Uint32 padding[3] = {};
+  };
+  struct MeshletRange {
+    Uint32 first_meshlet = 0u;
+    Uint32 meshlet_count = 0u;
+    bool is_occluder = false;
+  };
+  struct DepthUniforms {
+    glm::mat4 mvp;
+  };
+  struct CullingUniforms {
+    glm::mat4 mvp;
+    glm::ivec2 pyramid_size;
+    Uint32 level_count;
+    Uint32 meshlet_count;
+  };
+  SDL_GPUDevice* device_ = nullptr;
+  RenderTargetPool* pool_ = nullptr;
+  SDL_GPUTextureFormat depth_format_ = SDL_GPU_TEXTUREFORMAT_INVALID;
+  SharedGPUGraphicsPipeline depth_pipeline_;
+  ComputePipeline culling_pipeline_;
+  HiZPyramid pyramid_;
+  // Pooled since it is resized along with the viewport.
+  PooledTexture depth_;
+  std::vector<MeshletRange> ranges_;
+  UniqueGPUBuffer meshlets_;
+  UniqueGPUBuffer draw_args_;
+  BufferReadback draw_args_readback_;
+  Uint32 meshlet_count_ = 0u;
+  Stats stats_;
+  bool is_valid_ = false;
+
+  bool BuildPipelines(const Context& ctx);
+
+  bool RecordOccluders(SDL_GPUCommandBuffer* command_buffer,
+                       const glm::mat4& mvp,
+                       SDL_GPUBuffer* vertex_buffer,
+                       SDL_GPUBuffer* index_buffer) const;
+
+  bool RecordCulling(SDL_GPUCommandBuffer* command_buffer,
+                     const glm::mat4& mvp) const;
+
+  void PollStats();
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(ModelCuller);
+};
+
+}  // namespace ts
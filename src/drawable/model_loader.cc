@@ -0,0 +1,369 @@
+#include "model_loader.h"
+
+#include <fml/logging.h>
+#include <tiny_gltf.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <span>
+#include "profiler.h"
+
+namespace ts {
+
+template <class From>
+static void ReadIndexBuffer(std::vector<uint32_t>& indices,
+                            const uint8_t* buffer,
+                            size_t item_count) {
+  const auto initial_count = indices.size();
+  indices.resize(initial_count + item_count);
+  const auto from_buffer = reinterpret_cast<const From*>(buffer);
+  for (size_t i = 0; i < item_count; i++) {
+    indices[i + initial_count] = static_cast<uint32_t>(from_buffer[i]);
+  }
+}
+
+static void ReadIndexBuffer(std::vector<uint32_t>& indices,
+                            const uint8_t* buffer,
+                            size_t item_count,
+                            int item_component_type) {
+  switch (item_component_type) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+      ReadIndexBuffer<int8_t>(indices, buffer, item_count);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      ReadIndexBuffer<uint8_t>(indices, buffer, item_count);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+      ReadIndexBuffer<int16_t>(indices, buffer, item_count);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      ReadIndexBuffer<uint16_t>(indices, buffer, item_count);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_INT:
+      ReadIndexBuffer<int32_t>(indices, buffer, item_count);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      ReadIndexBuffer<uint32_t>(indices, buffer, item_count);
+      break;
+  }
+}
+
+static bool ReadVertexAttribute(std::vector<ModelVertex>& vertices,
+                                const tinygltf::Model& model,
+                                int attribute,
+                                size_t field_offset,
+                                size_t field_size,
+                                int check_type,
+                                int check_component_type) {
+  const tinygltf::Accessor& accessor = model.accessors[attribute];
+  const tinygltf::BufferView& buffer_view =
+      model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer& buffer = model.buffers[buffer_view.buffer];
+  if (accessor.type != check_type &&
+      accessor.componentType != check_component_type) {
+    return false;
+  }
+  const auto stride = accessor.ByteStride(buffer_view);
+  vertices.resize(std::max(vertices.size(), accessor.count));
+  const auto* data_ptr =
+      buffer.data.data() + accessor.byteOffset + buffer_view.byteOffset;
+  for (size_t i = 0; i < accessor.count; i++) {
+    std::memcpy(reinterpret_cast<uint8_t*>(&vertices[i]) + field_offset,
+                data_ptr + stride * i, field_size);
+  }
+  return true;
+}
+
+// Reads a VEC4 accessor of floats or unsigned integers. Normalized integers
+// are mapped to [0, 1].
+static std::vector<glm::vec4> ReadVec4Accessor(const tinygltf::Model& model,
+                                               int accessor_index) {
+  const auto& accessor = model.accessors[accessor_index];
+  if (accessor.type != TINYGLTF_TYPE_VEC4 || accessor.bufferView < 0) {
+    return {};
+  }
+  const auto& buffer_view = model.bufferViews[accessor.bufferView];
+  const auto& buffer = model.buffers[buffer_view.buffer];
+  const auto stride = accessor.ByteStride(buffer_view);
+  const auto component_size =
+      tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  const auto* data_ptr =
+      buffer.data.data() + accessor.byteOffset + buffer_view.byteOffset;
+  std::vector<glm::vec4> values(accessor.count);
+  for (size_t i = 0; i < accessor.count; i++) {
+    for (int c = 0; c < 4; c++) {
+      const auto* component = data_ptr + stride * i + component_size * c;
+      switch (accessor.componentType) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+          uint8_t value = 0;
+          std::memcpy(&value, component, sizeof(value));
+          values[i][c] = accessor.normalized ? value / 255.0f : value;
+        } break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+          uint16_t value = 0;
+          std::memcpy(&value, component, sizeof(value));
+          values[i][c] = accessor.normalized ? value / 65535.0f : value;
+        } break;
+        case TINYGLTF_COMPONENT_TYPE_FLOAT:
+          std::memcpy(&values[i][c], component, sizeof(float));
+          break;
+        default:
+          return {};
+      }
+    }
+  }
+  return values;
+}
+
+// Reads the influences of a primitive of a mesh bound to a skin whose joints
+// start at first_joint in the joint palette.
+static void ReadSkinnedVertices(std::vector<ModelSkinnedVertex>& skinned,
+                                const tinygltf::Model& model,
+                                const tinygltf::Primitive& primitive,
+                                const tinygltf::Skin& skin,
+                                Uint32 first_joint,
+                                Uint32 first_vertex,
+                                size_t vertex_count) {
+  auto joints_attribute = primitive.attributes.find("JOINTS_0");
+  auto weights_attribute = primitive.attributes.find("WEIGHTS_0");
+  if (joints_attribute == primitive.attributes.end() ||
+      weights_attribute == primitive.attributes.end() || skin.joints.empty()) {
+    return;
+  }
+  const auto joints = ReadVec4Accessor(model, joints_attribute->second);
+  const auto weights = ReadVec4Accessor(model, weights_attribute->second);
+  if (joints.size() < vertex_count || weights.size() < vertex_count) {
+    FML_LOG(ERROR) << "Could not read the joints and weights of a primitive.";
+    return;
+  }
+  const auto max_joint = static_cast<float>(skin.joints.size() - 1u);
+  for (size_t i = 0; i < vertex_count; i++) {
+    const auto weight_sum = weights[i].x + weights[i].y + weights[i].z +
+                            weights[i].w;
+    // Vertices without influences keep their bind pose.
+    if (weight_sum <= 0.0f) {
+      continue;
+    }
+    skinned.push_back(ModelSkinnedVertex{
+        .joints = glm::uvec4{glm::clamp(joints[i], 0.0f, max_joint)} +
+                  first_joint,
+        .weights = weights[i] / weight_sum,
+        .vertex = static_cast<Uint32>(first_vertex + i),
+    });
+  }
+}
+
+std::unique_ptr<tinygltf::Model> ParseModel(const fml::Mapping& mapping) {
+  TS_PROFILE_SCOPE("ParseModel");
+  tinygltf::TinyGLTF context;
+  std::string error;
+  std::string warning;
+  auto model = std::make_unique<tinygltf::Model>();
+  if (!context.LoadBinaryFromMemory(model.get(), &error, &warning,
+                                    mapping.GetMapping(), mapping.GetSize())) {
+    FML_LOG(ERROR) << "Could not load model";
+    if (!error.empty()) {
+      FML_LOG(ERROR) << "Error: " << error;
+    }
+    if (!warning.empty()) {
+      FML_LOG(ERROR) << "Warning: " << warning;
+    }
+    return nullptr;
+  }
+  return model;
+}
+
+std::optional<SDL_GPUTextureFormat> PickImageFormat(int component_count,
+                                                    int component_type,
+                                                    int bits_per_pixel) {
+  if (component_count == 4u &&
+      component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
+      bits_per_pixel == 8) {
+    return SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+  }
+  return std::nullopt;
+}
+
+static float MeasureUVDensity(const std::vector<ModelVertex>& vertices,
+                              std::span<const uint32_t> indices) {
+  double area = 0.0;
+  double uv_area = 0.0;
+  for (size_t i = 0; i + 2u < indices.size(); i += 3u) {
+    if (indices[i] >= vertices.size() || indices[i + 1u] >= vertices.size() ||
+        indices[i + 2u] >= vertices.size()) {
+      continue;
+    }
+    const auto& a = vertices[indices[i]];
+    const auto& b = vertices[indices[i + 1u]];
+    const auto& c = vertices[indices[i + 2u]];
+    area += glm::length(
+        glm::cross(b.position - a.position, c.position - a.position));
+    const auto uv_ab = b.textureCoords - a.textureCoords;
+    const auto uv_ac = c.textureCoords - a.textureCoords;
+    uv_area += std::abs(uv_ab.x * uv_ac.y - uv_ab.y * uv_ac.x);
+  }
+  return area > 0.0 ? static_cast<float>(std::sqrt(uv_area / area)) : 0.0f;
+}
+
+ModelGeometry ReadModelGeometry(const tinygltf::Model& model) {
+  TS_PROFILE_SCOPE("ReadModelGeometry");
+  ModelGeometry geometry;
+  // Meshes are bound to skins by the nodes that reference them.
+  std::vector<int> mesh_skins(model.meshes.size(), -1);
+  for (const auto& node : model.nodes) {
+    if (node.mesh >= 0 && static_cast<size_t>(node.mesh) < mesh_skins.size() &&
+        node.skin >= 0 && static_cast<size_t>(node.skin) < model.skins.size()) {
+      mesh_skins[node.mesh] = node.skin;
+    }
+  }
+  std::vector<Uint32> first_joints(model.skins.size(), 0u);
+  for (size_t i = 1; i < model.skins.size(); i++) {
+    first_joints[i] = first_joints[i - 1] + model.skins[i - 1].joints.size();
+  }
+  for (size_t mesh_index = 0; mesh_index < model.meshes.size(); mesh_index++) {
+    const auto& mesh = model.meshes[mesh_index];
+    for (const auto& primitive : mesh.primitives) {
+      auto current_primitive = ModelPrimitive{
+          .first_index = static_cast<Uint32>(geometry.indices.size()),
+          .first_vertex = static_cast<Uint32>(geometry.vertices.size()),
+      };
+
+      std::vector<ModelVertex> current_vertices;
+      bool has_vertex_color = false;
+      bool has_tangent = false;
+      bool has_texture_coords = false;
+
+      if (auto position = primitive.attributes.find("POSITION");
+          position != primitive.attributes.end()) {
+        ReadVertexAttribute(current_vertices,                 //
+                            model,                            //
+                            position->second,                 //
+                            offsetof(ModelVertex, position),  //
+                            sizeof(ModelVertex::position),    //
+                            TINYGLTF_TYPE_VEC3,               //
+                            TINYGLTF_COMPONENT_TYPE_FLOAT     //
+        );
+      }
+
+      if (auto normal = primitive.attributes.find("NORMAL");
+          normal != primitive.attributes.end()) {
+        ReadVertexAttribute(current_vertices,               //
+                            model,                          //
+                            normal->second,                 //
+                            offsetof(ModelVertex, normal),  //
+                            sizeof(ModelVertex::normal),    //
+                            TINYGLTF_TYPE_VEC3,             //
+                            TINYGLTF_COMPONENT_TYPE_FLOAT   //
+        );
+      }
+
+      if (auto texcoord = primitive.attributes.find("TEXCOORD_0");
+          texcoord != primitive.attributes.end()) {
+        has_texture_coords =
+            ReadVertexAttribute(current_vertices,                      //
+                                model,                                 //
+                                texcoord->second,                      //
+                                offsetof(ModelVertex, textureCoords),  //
+                                sizeof(ModelVertex::textureCoords),    //
+                                TINYGLTF_TYPE_VEC2,                    //
+                                TINYGLTF_COMPONENT_TYPE_FLOAT          //
+            );
+      }
+
+      if (auto color = primitive.attributes.find("COLOR_0");
+          color != primitive.attributes.end()) {
+        const auto& accessor = model.accessors[color->second];
+        if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT &&
+            (accessor.type == TINYGLTF_TYPE_VEC3 ||
+             accessor.type == TINYGLTF_TYPE_VEC4)) {
+          const auto color_size = accessor.type == TINYGLTF_TYPE_VEC4
+                                      ? sizeof(glm::vec4)
+                                      : sizeof(glm::vec3);
+          has_vertex_color =
+              ReadVertexAttribute(current_vertices,              //
+                                  model,                         //
+                                  color->second,                 //
+                                  offsetof(ModelVertex, color),  //
+                                  color_size,                    //
+                                  accessor.type,                 //
+                                  TINYGLTF_COMPONENT_TYPE_FLOAT  //
+              );
+        }
+      }
+
+      if (auto tangent = primitive.attributes.find("TANGENT");
+          tangent != primitive.attributes.end()) {
+        has_tangent = ReadVertexAttribute(current_vertices,                //
+                                          model,                           //
+                                          tangent->second,                 //
+                                          offsetof(ModelVertex, tangent),  //
+                                          sizeof(ModelVertex::tangent),    //
+                                          TINYGLTF_TYPE_VEC4,              //
+                                          TINYGLTF_COMPONENT_TYPE_FLOAT    //
+        );
+      }
+
+      {
+        if (primitive.indices >= 0) {
+          const auto& index_acessor = model.accessors.at(primitive.indices);
+          const auto& index_buffer_view =
+              model.bufferViews.at(index_acessor.bufferView);
+          const auto& index_buffer = model.buffers.at(index_buffer_view.buffer);
+          ReadIndexBuffer(geometry.indices,
+                          index_buffer.data.data() + index_acessor.byteOffset +
+                              index_buffer_view.byteOffset,  //
+                          index_acessor.count,               //
+                          index_acessor.componentType        //
+          );
+        } else {
+          geometry.indices.reserve(geometry.indices.size() +
+                                   current_vertices.size());
+          for (size_t i = 0; i < current_vertices.size(); i++) {
+            geometry.indices.push_back(i);
+          }
+        }
+        current_primitive.last_index = geometry.indices.size();
+      }
+
+      current_primitive.material = primitive.material;
+      current_primitive.has_vertex_color = has_vertex_color;
+      current_primitive.has_tangent = has_tangent;
+      if (!current_vertices.empty()) {
+        current_primitive.bounds_min = current_vertices.front().position;
+        current_primitive.bounds_max = current_vertices.front().position;
+        for (const auto& vertex : current_vertices) {
+          current_primitive.bounds_min =
+              glm::min(current_primitive.bounds_min, vertex.position);
+          current_primitive.bounds_max =
+              glm::max(current_primitive.bounds_max, vertex.position);
+        }
+      }
+      if (has_texture_coords) {
+        current_primitive.uv_density = MeasureUVDensity(
+            current_vertices,
+            std::span(geometry.indices)
+                .subspan(current_primitive.first_index,
+                         current_primitive.last_index -
+                             current_primitive.first_index));
+      }
+
+      if (const auto skin = mesh_skins[mesh_index]; skin >= 0) {
+        ReadSkinnedVertices(geometry.skinned_vertices,       //
+                            model,                           //
+                            primitive,                       //
+                            model.skins[skin],               //
+                            first_joints[skin],              //
+                            current_primitive.first_vertex,  //
+                            current_vertices.size()          //
+        );
+      }
+
+      std::ranges::move(current_vertices,
+                        std::back_inserter(geometry.vertices));
+      geometry.primitives.push_back(current_primitive);
+    }
+  }
+  return geometry;
+}
+
+}  // namespace ts
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <fml/mapping.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "sdl_types.h"
+
+namespace tinygltf {
+class Model;
+}  // namespace tinygltf
+
+namespace ts {
+
+struct ModelVertex {
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec2 textureCoords;
+  glm::vec4 color = glm::vec4{1.0f};
+  glm::vec4 tangent;
+};
+
+// The joint influences of a vertex of a skinned primitive. Laid out like the
+// SkinnedVertex of skinning.slang.
+struct ModelSkinnedVertex {
+  // Indices into the joint palette of the model. The joints of each skin
+  // follow those of the skins before it.
+  glm::uvec4 joints = glm::uvec4{0u};
+  // Sum to one.
+  glm::vec4 weights = glm::vec4{0.0f};
+  // The index of the vertex in ModelGeometry::vertices.
+  Uint32 vertex = 0u;
+  Uint32 padding[3] = {};
+};
+
+// A range of the packed geometry drawn with a single material.
+struct ModelPrimitive {
+  Uint32 first_index = {};
+  Uint32 last_index = {};
+  Uint32 first_vertex = {};
+  int material = -1;
+  bool has_vertex_color = false;
+  bool has_tangent = false;
+  // The bounding box of the vertex positions in model space.
+  glm::vec3 bounds_min = glm::vec3{0.0f};
+  glm::vec3 bounds_max = glm::vec3{0.0f};
+  // Texture coordinate units per unit of model space averaged over the area
+  // of the triangles. Zero if the primitive has no texture coordinates.
+  float uv_density = 0.0f;
+};
+
+// The vertices and indices of every primitive in a model repacked into a
+// single vertex and index buffer.
+struct ModelGeometry {
+  std::vector<ModelVertex> vertices;
+  std::vector<uint32_t> indices;
+  std::vector<ModelPrimitive> primitives;
+  // The influences of the vertices of skinned primitives. Empty if no mesh
+  // is skinned.
+  std::vector<ModelSkinnedVertex> skinned_vertices;
+};
+
+// Parses a binary glTF. Images are decoded too.
+std::unique_ptr<tinygltf::Model> ParseModel(const fml::Mapping& mapping);
+
+ModelGeometry ReadModelGeometry(const tinygltf::Model& model);
+
+// Returns the texture format decoded images with the given layout may be
+// uploaded as.
+std::optional<SDL_GPUTextureFormat> PickImageFormat(int component_count,
+                                                    int component_type,
+                                                    int bits_per_pixel);
+
+}  // namespace ts
@@ -1,6 +1,9 @@
 #include "model_renderer.h"
 
+#include <algorithm>
+#include <iterator>
 #include "imgui.h"
+#include "profiler.h"
 
 namespace ts {
 
@@ -11,52 +14,129 @@ static const char* kModelCatalog[] = {"DamagedHelmet",
                                       "BarramundiFish",
                                       "Avocado",
                                       "CommercialRefrigerator",
-                                      "DragonAttenuation"};
+                                      "DragonAttenuation",
+                                      "CesiumMan"};
 
-ModelRenderer::ModelRenderer(std::shared_ptr<Context> ctx)
-    : context_(std::move(ctx)) {
-  LoadModel(kModelCatalog[0]);
+std::span<const char* const> GetModelCatalog() {
+  return kModelCatalog;
+}
+
+static int FindModelIndex(const std::string& model_name) {
+  const auto found = std::find(std::begin(kModelCatalog),
+                               std::end(kModelCatalog), model_name);
+  return found == std::end(kModelCatalog)
+             ? 0
+             : static_cast<int>(found - std::begin(kModelCatalog));
+}
+
+ModelRenderer::ModelRenderer(std::shared_ptr<Context> ctx, int model_index)
+    : context_(std::move(ctx)), model_index_(model_index) {
+  LoadModel(kModelCatalog[model_index_]);
 }
 
 ModelRenderer::~ModelRenderer() {}
 
+bool ModelRenderer::IsValid() const {
+  return model_ != nullptr;
+}
+
+bool ModelRenderer::Prepare(const DrawContext& context) {
+  return model_ ? model_->Prepare(context) : true;
+}
+
 bool ModelRenderer::Draw(const DrawContext& context) {
-  if (!is_valid_) {
-    return false;
+  // Loads are only attempted when the selection changes so that a model that
+  // fails to load isn't retried every frame.
+  if (ImGui::ListBox("Model", &model_index_, kModelCatalog,
+                     IM_ARRAYSIZE(kModelCatalog))) {
+    const auto previous_model = model_;
+    if (!LoadModel(kModelCatalog[model_index_])) {
+      // Keep drawing the model that was loaded last.
+      if (model_) {
+        model_index_ = FindModelIndex(model_name_);
+      }
+    } else if (model_ != previous_model && !model_->Prepare(context)) {
+      // A newly selected model missed the prepare phase of this frame.
+      return false;
+    }
   }
   if (!model_) {
     return true;
   }
 
-  static int current_model_index = 0;
-  ImGui::ListBox("Model", &current_model_index, kModelCatalog,
-                 IM_ARRAYSIZE(kModelCatalog));
-  LoadModel(kModelCatalog[current_model_index]);
-
+  DrawCacheUI();
+  DrawTextureStreamingUI();
+  DrawCullingUI();
   return model_->Draw(context);
 }
 
-void ModelRenderer::LoadModel(const std::string& model_name) {
-  if (is_valid_ && model_name_ == model_name) {
-    return;
+bool ModelRenderer::ReloadShaders(const Context& ctx) {
+  return cache_.ReloadShaders(ctx);
+}
+
+bool ModelRenderer::LoadModel(const std::string& model_name) {
+  TS_PROFILE_SCOPE("ModelRenderer::LoadModel");
+  if (model_ && model_name_ == model_name) {
+    return true;
   }
-  is_valid_ = false;
-  auto model_data = fml::FileMapping::CreateReadOnly(fml::paths::JoinPaths(
-      {MODELS_LOCATION, model_name, "glTF-Binary", model_name + ".glb"}));
-  if (!model_data) {
-    FML_LOG(ERROR) << "Could not load model data.";
-    return;
+  // A failed load leaves the previous model in place.
+  auto cached = cache_.Get(model_name, [&]() -> std::unique_ptr<Model> {
+    auto model_data = fml::FileMapping::CreateReadOnly(fml::paths::JoinPaths(
+        {MODELS_LOCATION, model_name, "glTF-Binary", model_name + ".glb"}));
+    if (!model_data) {
+      FML_LOG(ERROR) << "Could not load model data.";
+      return nullptr;
+    }
+    auto model = std::make_unique<Model>(*context_, *model_data);
+    if (!model->IsValid()) {
+      FML_LOG(ERROR) << "Could not load model.";
+      return nullptr;
+    }
+    return model;
+  });
+  if (!cached) {
+    FML_LOG(ERROR) << "Could not load model '" << model_name << "'.";
+    return false;
   }
-  auto model = std::make_unique<Model>(*context_, *model_data);
 
-  if (!model->IsValid()) {
-    FML_LOG(ERROR) << "Could not load model.";
-    return;
+  model_ = cached;
+  model_name_ = model_name;
+  return true;
+}
+
+void ModelRenderer::DrawCacheUI() {
+  constexpr size_t kMiB = 1u << 20u;
+  const auto& stats = cache_.GetStats();
+  ImGui::Text("Cached %zu models in %.1f MiB", cache_.GetCount(),
+              static_cast<float>(cache_.GetSize()) / kMiB);
+  ImGui::Text("Hits %zu, misses %zu, evictions %zu", stats.hits,
+              stats.misses, stats.evictions);
+  int budget = static_cast<int>(cache_.GetBudget() / kMiB);
+  if (ImGui::SliderInt("Cache Budget (MiB)", &budget, 0, 4096)) {
+    cache_.SetBudget(static_cast<size_t>(budget) * kMiB);
   }
+}
 
-  model_ = std::move(model);
-  model_name_ = model_name;
-  is_valid_ = true;
+void ModelRenderer::DrawTextureStreamingUI() {
+  constexpr size_t kMiB = 1u << 20u;
+  const auto& stats = model_->GetTextureStreamingStats();
+  ImGui::Text("Textures %zu, resident %.1f MiB, pending %zu levels",
+              stats.texture_count,
+              static_cast<float>(stats.resident_bytes) / kMiB,
+              stats.pending_levels);
+  ImGui::Text("Uploaded %.2f MiB, streamed %zu, evicted %zu levels",
+              static_cast<float>(stats.uploaded_bytes) / kMiB,
+              stats.streamed_levels, stats.evicted_levels);
+}
+
+void ModelRenderer::DrawCullingUI() {
+  const auto stats = model_->GetCullingStats();
+  if (!stats.has_value()) {
+    ImGui::Text("Skinned models aren't culled");
+    return;
+  }
+  ImGui::Text("Meshlets visible %zu / %zu", stats->visible_meshlet_count,
+              stats->meshlet_count);
 }
 
 }  // namespace ts
@@ -2,27 +2,51 @@
 
 #include <fml/mapping.h>
 #include <fml/paths.h>
+#include <span>
 #include "drawable.h"
 #include "model.h"
+#include "model_cache.h"
 #include "models_location.h"
 
 namespace ts {
 
+// The names of the glTF sample assets that may be loaded. Each is expected at
+// MODELS_LOCATION/<name>/glTF-Binary/<name>.glb.
+std::span<const char* const> GetModelCatalog();
+
 class ModelRenderer final : public Drawable {
  public:
-  ModelRenderer(std::shared_ptr<Context> ctx);
+  // Starts out with the model at the given index of the catalog.
+  ModelRenderer(std::shared_ptr<Context> ctx, int model_index = 0);
 
   ~ModelRenderer();
 
+  // If a model was loaded.
+  bool IsValid() const;
+
+  bool Prepare(const DrawContext& context) override;
+
   bool Draw(const DrawContext& context) override;
 
+  bool ReloadShaders(const Context& ctx) override;
+
  private:
   std::shared_ptr<Context> context_;
-  std::unique_ptr<Model> model_;
-  bool is_valid_ = false;
+  // Models stay loaded after another is selected.
+  ModelCache cache_;
+  // The model drawn. Owned by the cache. Null if none has loaded yet.
+  Model* model_ = nullptr;
   std::string model_name_;
+  int model_index_ = 0;
+
+  // Keeps the previous model if the named one fails to load.
+  bool LoadModel(const std::string& model_name);
+
+  void DrawCacheUI();
+
+  void DrawTextureStreamingUI();
 
-  void LoadModel(const std::string& model_name);
+  void DrawCullingUI();
 
   FML_DISALLOW_COPY_ASSIGN_AND_MOVE(ModelRenderer);
 };
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include "model.slang.reflection.h"
+
+namespace ts {
+
+// Material features that select a permutation of the model fragment shader.
+// These must match the constants in model.slang.
+enum ModelShaderFeature : uint32_t {
+  kModelShaderFeatureBaseColorTexture = 1u << 0u,
+  kModelShaderFeatureVertexColor = 1u << 1u,
+  kModelShaderFeatureAlphaTest = 1u << 2u,
+  kModelShaderFeatureNormalMap = 1u << 3u,
+};
+
+// A bitfield of ModelShaderFeature values.
+using ModelShaderKey = uint32_t;
+
+constexpr size_t kModelShaderPermutationCount = 16u;
+
+constexpr std::array<const EntryPointReflection*, kModelShaderPermutationCount>
+    kModelFragmentPermutations = {
+        &shaders::model::kFragmentMain_0,  &shaders::model::kFragmentMain_1,
+        &shaders::model::kFragmentMain_2,  &shaders::model::kFragmentMain_3,
+        &shaders::model::kFragmentMain_4,  &shaders::model::kFragmentMain_5,
+        &shaders::model::kFragmentMain_6,  &shaders::model::kFragmentMain_7,
+        &shaders::model::kFragmentMain_8,  &shaders::model::kFragmentMain_9,
+        &shaders::model::kFragmentMain_10, &shaders::model::kFragmentMain_11,
+        &shaders::model::kFragmentMain_12, &shaders::model::kFragmentMain_13,
+        &shaders::model::kFragmentMain_14, &shaders::model::kFragmentMain_15,
+};
+
+constexpr const EntryPointReflection& GetModelFragmentPermutation(
+    ModelShaderKey key) {
+  return *kModelFragmentPermutations[key % kModelShaderPermutationCount];
+}
+
+}  // namespace ts
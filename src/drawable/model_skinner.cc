@@ -0,0 +1,203 @@
+#include "model_skinner.h"
+
+#include <fml/logging.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include "frame_counters.h"
+#include "gpu_memory.h"
+#include "macros.h"
+#include "profiler.h"
+#include "skinning.slang.reflection.h"
+
+namespace ts {
+
+static_assert(sizeof(ModelVertex) == 16u * sizeof(float));
+static_assert(offsetof(ModelVertex, normal) == 3u * sizeof(float));
+static_assert(offsetof(ModelVertex, tangent) == 12u * sizeof(float));
+static_assert(sizeof(ModelSkinnedVertex) == 48u);
+
+static ComputePipeline CreateSkinningPipeline(const Context& ctx) {
+  auto code = ctx.GetShaderLibrary().GetBlob("skinning");
+  if (!code) {
+    return {};
+  }
+  return ComputePipelineBuilder{}
+      .SetShader(code.get())
+      .SetReflection(shaders::skinning::kSkinVertices)
+      .Build(ctx.GetDevice());
+}
+
+ModelSkinner::ModelSkinner(
+    const Context& ctx,
+    const std::vector<ModelVertex>& vertices,
+    const std::vector<ModelSkinnedVertex>& skinned_vertices,
+    Uint32 joint_count)
+    : device_(ctx.GetDevice().get()),
+      skinned_vertex_count_(skinned_vertices.size()),
+      joint_count_(joint_count) {
+  TS_GPU_MEMORY_OWNER("ModelSkinner");
+  if (skinned_vertices.empty() || joint_count == 0u) {
+    return;
+  }
+  pipeline_ = CreateSkinningPipeline(ctx);
+  if (!pipeline_.IsValid()) {
+    return;
+  }
+  const auto group_count =
+      MakeGroupCount<Uint32>(skinned_vertex_count_, pipeline_.thread_count.x);
+  if (group_count > 65535u) {
+    FML_LOG(ERROR) << "Too many skinned vertices.";
+    return;
+  }
+
+  bind_pose_ = PerformHostToDeviceTransfer(
+      ctx.GetDevice(), vertices, SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ);
+  // Vertices that aren't skinned keep the bind pose.
+  vertices_ = PerformHostToDeviceTransfer(
+      ctx.GetDevice(), vertices,
+      SDL_GPU_BUFFERUSAGE_VERTEX | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE);
+  skinned_vertices_ =
+      PerformHostToDeviceTransfer(ctx.GetDevice(), skinned_vertices,
+                                  SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ);
+  const auto joints_size = joint_count_ * sizeof(glm::mat4);
+  joints_ = CreateGPUBuffer(device_, joints_size,
+                            SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ);
+  joints_transfer_ = CreateGPUTransferBuffer(
+      device_, joints_size, SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD);
+  if (!bind_pose_.is_valid() || !vertices_.is_valid() ||
+      !skinned_vertices_.is_valid() || !joints_.is_valid() ||
+      !joints_transfer_.is_valid()) {
+    FML_LOG(ERROR) << "Could not create skinning buffers.";
+    return;
+  }
+  // The bind pose and the skinned vertices, the influences and the palette
+  // along with its transfer buffer.
+  gpu_memory_size_ = 2u * vertices.size() * sizeof(ModelVertex) +
+                     skinned_vertices.size() * sizeof(ModelSkinnedVertex) +
+                     2u * joints_size;
+
+  is_valid_ = true;
+}
+
+ModelSkinner::~ModelSkinner() = default;
+
+bool ModelSkinner::IsValid() const {
+  return is_valid_;
+}
+
+SDL_GPUBuffer* ModelSkinner::GetVertexBuffer() const {
+  return vertices_.get().value;
+}
+
+size_t ModelSkinner::GetGPUMemorySize() const {
+  return gpu_memory_size_;
+}
+
+bool ModelSkinner::ReloadShaders(const Context& ctx) {
+  auto pipeline = CreateSkinningPipeline(ctx);
+  if (!pipeline.IsValid()) {
+    return false;
+  }
+  pipeline_ = std::move(pipeline);
+  return true;
+}
+
+bool ModelSkinner::RecordSkinning(SDL_GPUCommandBuffer* command_buffer) const {
+  {
+    auto copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+    if (!copy_pass) {
+      FML_LOG(ERROR) << "Could not create copy pass: " << SDL_GetError();
+      return false;
+    }
+    FML_DEFER(SDL_EndGPUCopyPass(copy_pass));
+    const auto src = SDL_GPUTransferBufferLocation{
+        .transfer_buffer = joints_transfer_.get().value,
+        .offset = 0u,
+    };
+    const auto dst = SDL_GPUBufferRegion{
+        .buffer = joints_.get().value,
+        .offset = 0u,
+        .size = static_cast<Uint32>(joint_count_ * sizeof(glm::mat4)),
+    };
+    // The palette of the previous frame may still be read.
+    SDL_UploadToGPUBuffer(copy_pass, &src, &dst, true);
+  }
+
+  // Not cycled since the vertices that aren't skinned must be kept.
+  const auto output = SDL_GPUStorageBufferReadWriteBinding{
+      .buffer = vertices_.get().value,
+  };
+  auto compute_pass =
+      SDL_BeginGPUComputePass(command_buffer, nullptr, 0u, &output, 1u);
+  if (!compute_pass) {
+    FML_LOG(ERROR) << "Could not create compute pass: " << SDL_GetError();
+    return false;
+  }
+  FML_DEFER(SDL_EndGPUComputePass(compute_pass));
+  SDL_BindGPUComputePipeline(compute_pass, pipeline_.pipeline.get().value);
+  CountPipelineBind();
+  const auto inputs = std::array<SDL_GPUBuffer*, 3u>{
+      bind_pose_.get().value,
+      skinned_vertices_.get().value,
+      joints_.get().value,
+  };
+  SDL_BindGPUComputeStorageBuffers(compute_pass, 0u, inputs.data(),
+                                   inputs.size());
+  CountStorageBufferBind();
+  const auto uniforms = Uniforms{
+      .skinned_vertex_count = skinned_vertex_count_,
+  };
+  SDL_PushGPUComputeUniformData(command_buffer, 0u, &uniforms,
+                                sizeof(uniforms));
+  SDL_DispatchGPUCompute(
+      compute_pass,
+      MakeGroupCount<Uint32>(skinned_vertex_count_, pipeline_.thread_count.x),
+      1u, 1u);
+  CountDispatch();
+  return true;
+}
+
+bool ModelSkinner::Update(std::span<const glm::mat4> joints) {
+  TS_PROFILE_SCOPE("ModelSkinner::Update");
+  if (!is_valid_ || joints.size() != joint_count_) {
+    return false;
+  }
+  if (std::ranges::equal(joints, skinned_joints_)) {
+    return true;
+  }
+
+  {
+    // Cycled so that uploads still in flight keep their palette.
+    auto memory =
+        SDL_MapGPUTransferBuffer(device_, joints_transfer_.get().value, true);
+    if (!memory) {
+      FML_LOG(ERROR) << "Could not map buffer: " << SDL_GetError();
+      return false;
+    }
+    std::memcpy(memory, joints.data(), joints.size_bytes());
+    SDL_UnmapGPUTransferBuffer(device_, joints_transfer_.get().value);
+  }
+
+  auto command_buffer = SDL_AcquireGPUCommandBuffer(device_);
+  if (!command_buffer) {
+    FML_LOG(ERROR) << "Could not create command buffer: " << SDL_GetError();
+    return false;
+  }
+  SDL_PushGPUDebugGroup(command_buffer, "Skinning");
+  const auto recorded = RecordSkinning(command_buffer);
+  SDL_PopGPUDebugGroup(command_buffer);
+  if (!recorded) {
+    SDL_CancelGPUCommandBuffer(command_buffer);
+    return false;
+  }
+  if (!SDL_SubmitGPUCommandBuffer(command_buffer)) {
+    FML_LOG(ERROR) << "Could not submit command buffer: " << SDL_GetError();
+    return false;
+  }
+  CountSubmission();
+  skinned_joints_.assign(joints.begin(), joints.end());
+  return true;
+}
+
+}  // namespace ts
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <span>
+#include <vector>
+#include "buffer.h"
+#include "compute_pipeline.h"
+#include "context.h"
+#include "model_loader.h"
+#include "sdl_types.h"
+
+namespace ts {
+
+// Skins the vertices of a model on the GPU into a vertex buffer with the
+// layout of the bind pose so that the model pipelines consume it unchanged.
+// Each pose is skinned once however many passes draw the result. A pose that
+// didn't change since the last update isn't skinned again.
+class ModelSkinner {
+ public:
+  ModelSkinner(const Context& ctx,
+               const std::vector<ModelVertex>& vertices,
+               const std::vector<ModelSkinnedVertex>& skinned_vertices,
+               Uint32 joint_count);
+
+  ~ModelSkinner();
+
+  bool IsValid() const;
+
+  // Uploads the joint palette and skins the vertices with it. Recorded into
+  // a command buffer of its own that is submitted before the one the frame is
+  // drawn with.
+  bool Update(std::span<const glm::mat4> joints);
+
+  // Bound in place of the bind pose vertex buffer.
+  SDL_GPUBuffer* GetVertexBuffer() const;
+
+  // The bytes of the buffers the skinner owns.
+  size_t GetGPUMemorySize() const;
+
+  bool ReloadShaders(const Context& ctx);
+
+ private:
+  struct Uniforms {
+    Uint32 skinned_vertex_count = 0u;
+    Uint32 padding[3] = {};
+  };
+  SDL_GPUDevice* device_ = nullptr;
+  ComputePipeline pipeline_;
+  UniqueGPUBuffer bind_pose_;
+  UniqueGPUBuffer skinned_vertices_;
+  UniqueGPUBuffer joints_;
+  UniqueGPUTransferBuffer joints_transfer_;
+  UniqueGPUBuffer vertices_;
+  Uint32 skinned_vertex_count_ = 0u;
+  Uint32 joint_count_ = 0u;
+  size_t gpu_memory_size_ = 0u;
+  // The palette the vertices were last skinned with.
+  std::vector<glm::mat4> skinned_joints_;
+  bool is_valid_ = false;
+
+  bool RecordSkinning(SDL_GPUCommandBuffer* command_buffer) const;
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(ModelSkinner);
+};
+
+}  // namespace ts
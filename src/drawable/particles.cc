@@ -0,0 +1,360 @@
+#include "particles.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include "frame_counters.h"
+#include "gpu_memory.h"
+#include "graphics_pipeline.h"
+#include "imgui.h"
+#include "macros.h"
+#include "particle_simulation.slang.reflection.h"
+#include "particles.slang.reflection.h"
+#include "profiler.h"
+#include "shader.h"
+
+namespace ts {
+
+// Must match THREADS_PER_GROUP in particle_simulation.slang.
+static constexpr Uint32 kThreadsPerGroup = 256u;
+
+// Group counts are limited to 65535 in each dimension.
+static constexpr Uint32 kMaxCapacity = 65535u * kThreadsPerGroup;
+
+// Must match the counter offsets in particle_simulation.slang.
+static constexpr size_t kAliveCount = 1u;
+static constexpr size_t kEmitCount = 2u;
+static constexpr size_t kCounterCount = 3u;
+
+static constexpr Uint32 kEmitDispatchOffset = 0u;
+static constexpr Uint32 kSimulateDispatchOffset =
+    sizeof(SDL_GPUIndirectDispatchCommand);
+
+// Particles live between two and four seconds. Emitting the capacity every
+// average lifetime keeps the buffers about full.
+static constexpr float kMeanLifetime = 3.0f;
+
+// Long stalls are simulated as a single short step instead of a jump.
+static constexpr float kMaxDeltaTime = 0.1f;
+
+static constexpr float kBillboardSize = 0.01f;
+
+struct GPUParticle {
+  glm::vec3 position;
+  float age;
+  glm::vec3 velocity;
+  float lifetime;
+};
+
+static_assert(sizeof(GPUParticle) == 32u);
+
+static ComputePipeline CreateSimulationPipeline(
+    const Context& ctx,
+    const EntryPointReflection& reflection) {
+  auto code = ctx.GetShaderLibrary().GetBlob("particle_simulation");
+  if (!code) {
+    return {};
+  }
+  return ComputePipelineBuilder{}
+      .SetShader(code.get())
+      .SetReflection(reflection)
+      .Build(ctx.GetDevice());
+}
+
+static SharedGPUGraphicsPipeline CreateRenderPipeline(const Context& ctx) {
+  auto code = ctx.GetShaderLibrary().GetBlob("particles");
+  if (!code) {
+    return nullptr;
+  }
+  auto& cache = ctx.GetPipelineCache();
+  auto vs = ShaderBuilder{}
+                .SetCode(code.get())
+                .SetReflection(shaders::particles::kParticleVertexMain)
+                .Build(ctx.GetDevice(), cache);
+  auto fs = ShaderBuilder{}
+                .SetCode(code.get())
+                .SetReflection(shaders::particles::kParticleFragmentMain)
+                .Build(ctx.GetDevice(), cache);
+  if (!vs || !fs) {
+    return nullptr;
+  }
+  // Blended additively so that the draw order of particles doesn't matter.
+  return GraphicsPipelineBuilder{}
+      .SetColorTargets({
+          SDL_GPUColorTargetDescription{
+              .format = ctx.GetColorFormat(),
+              .blend_state =
+                  SDL_GPUColorTargetBlendState{
+                      .src_color_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
+                      .dst_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE,
+                      .color_blend_op = SDL_GPU_BLENDOP_ADD,
+                      .src_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ZERO,
+                      .dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE,
+                      .alpha_blend_op = SDL_GPU_BLENDOP_ADD,
+                      .enable_blend = true,
+                  },
+          },
+      })
+      .SetVertexShader(vs.get())
+      .SetFragmentShader(fs.get())
+      .SetPrimitiveType(SDL_GPU_PRIMITIVETYPE_TRIANGLELIST)
+      .SetSampleCount(ctx.GetColorSamples())
+      .SetDepthStencilFormat(ctx.GetDepthFormat())
+      .SetDepthStencilState(SDL_GPUDepthStencilState{
+          .compare_op = SDL_GPU_COMPAREOP_GREATER,
+          .enable_depth_test = true,
+          .enable_depth_write = false,
+      })
+      .Build(ctx.GetDevice(), cache);
+}
+
+Particles::Particles(const Context& ctx, Uint32 capacity)
+    : device_(ctx.GetDevice().get()),
+      capacity_(std::clamp(capacity, 1u, kMaxCapacity)) {
+  TS_GPU_MEMORY_OWNER("Particles");
+  if (!BuildPipelines(ctx)) {
+    return;
+  }
+
+  const auto storage_usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ |
+                             SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE;
+  const auto drawn_usage =
+      storage_usage | SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ;
+  const auto indirect_usage = storage_usage | SDL_GPU_BUFFERUSAGE_INDIRECT;
+  particles_ =
+      CreateGPUBuffer(device_, capacity_ * sizeof(GPUParticle), drawn_usage);
+  dead_list_ =
+      CreateGPUBuffer(device_, capacity_ * sizeof(Uint32), storage_usage);
+  for (auto& alive_list : alive_lists_) {
+    alive_list =
+        CreateGPUBuffer(device_, capacity_ * sizeof(Uint32), drawn_usage);
+    if (!alive_list.is_valid()) {
+      return;
+    }
+  }
+  counters_ =
+      CreateGPUBuffer(device_, kCounterCount * sizeof(Uint32), storage_usage);
+  draw_args_ = CreateGPUBuffer(device_, sizeof(SDL_GPUIndirectDrawCommand),
+                               indirect_usage);
+  dispatch_args_ = CreateGPUBuffer(
+      device_, 2u * sizeof(SDL_GPUIndirectDispatchCommand), indirect_usage);
+  if (!particles_.is_valid() || !dead_list_.is_valid() ||
+      !counters_.is_valid() || !draw_args_.is_valid() ||
+      !dispatch_args_.is_valid()) {
+    FML_LOG(ERROR) << "Could not create particle buffers.";
+    return;
+  }
+
+  is_valid_ = true;
+}
+
+Particles::~Particles() = default;
+
+bool Particles::BuildPipelines(const Context& ctx) {
+  namespace simulation = shaders::particle_simulation;
+  auto initialize = CreateSimulationPipeline(ctx, simulation::kInitialize);
+  auto kickoff = CreateSimulationPipeline(ctx, simulation::kKickoff);
+  auto emit = CreateSimulationPipeline(ctx, simulation::kEmit);
+  auto simulate = CreateSimulationPipeline(ctx, simulation::kSimulate);
+  auto render = CreateRenderPipeline(ctx);
+  // Built aside so that the previous pipelines are kept on failure.
+  if (!initialize.IsValid() || !kickoff.IsValid() || !emit.IsValid() ||
+      !simulate.IsValid() || !render) {
+    FML_LOG(ERROR) << "Could not build particle pipelines.";
+    return false;
+  }
+  initialize_pipeline_ = std::move(initialize);
+  kickoff_pipeline_ = std::move(kickoff);
+  emit_pipeline_ = std::move(emit);
+  simulate_pipeline_ = std::move(simulate);
+  render_pipeline_ = std::move(render);
+  return true;
+}
+
+bool Particles::ReloadShaders(const Context& ctx) {
+  return BuildPipelines(ctx);
+}
+
+bool Particles::DispatchStep(
+    SDL_GPUCommandBuffer* command_buffer,
+    const ComputePipeline& pipeline,
+    const SimulationUniforms& uniforms,
+    Uint32 group_count,
+    std::optional<Uint32> dispatch_args_offset) const {
+  std::array<SDL_GPUStorageBufferReadWriteBinding, 7u> bindings = {};
+  bindings[0].buffer = particles_.get().value;
+  bindings[1].buffer = dead_list_.get().value;
+  bindings[2].buffer = alive_lists_[frame_ % 2u].get().value;
+  bindings[3].buffer = alive_lists_[(frame_ + 1u) % 2u].get().value;
+  bindings[4].buffer = counters_.get().value;
+  bindings[5].buffer = draw_args_.get().value;
+  bindings[6].buffer = dispatch_args_.get().value;
+  // Dispatches sized by the arguments buffer can't also write it.
+  const auto binding_count = dispatch_args_offset.has_value()
+                                 ? bindings.size() - 1u
+                                 : bindings.size();
+  // Each step gets its own pass so that it sees the writes of the previous
+  // one.
+  auto pass = SDL_BeginGPUComputePass(command_buffer, nullptr, 0u,
+                                      bindings.data(), binding_count);
+  if (!pass) {
+    FML_LOG(ERROR) << "Could not create compute pass: " << SDL_GetError();
+    return false;
+  }
+  FML_DEFER(SDL_EndGPUComputePass(pass));
+  SDL_BindGPUComputePipeline(pass, pipeline.pipeline.get().value);
+  CountPipelineBind();
+  SDL_PushGPUComputeUniformData(command_buffer, 0u, &uniforms,
+                                sizeof(uniforms));
+  if (dispatch_args_offset.has_value()) {
+    SDL_DispatchGPUComputeIndirect(pass, dispatch_args_.get().value,
+                                   dispatch_args_offset.value());
+  } else {
+    SDL_DispatchGPUCompute(pass, group_count, 1u, 1u);
+  }
+  CountDispatch();
+  return true;
+}
+
+bool Particles::RecordSimulation(SDL_GPUCommandBuffer* command_buffer,
+                                 const SimulationUniforms& uniforms) const {
+  SDL_PushGPUDebugGroup(command_buffer, "Particles");
+  FML_DEFER(SDL_PopGPUDebugGroup(command_buffer));
+  if (!is_initialized_ &&
+      !DispatchStep(command_buffer, initialize_pipeline_, uniforms,
+                    MakeGroupCount(capacity_, kThreadsPerGroup),
+                    std::nullopt)) {
+    return false;
+  }
+  return DispatchStep(command_buffer, kickoff_pipeline_, uniforms, 1u,
+                      std::nullopt) &&
+         DispatchStep(command_buffer, emit_pipeline_, uniforms, 0u,
+                      kEmitDispatchOffset) &&
+         DispatchStep(command_buffer, simulate_pipeline_, uniforms, 0u,
+                      kSimulateDispatchOffset);
+}
+
+bool Particles::Prepare(const DrawContext& context) {
+  TS_PROFILE_SCOPE("Particles::Prepare");
+  if (!is_valid_) {
+    return false;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  auto delta_time = 0.0f;
+  if (last_time_.has_value()) {
+    delta_time =
+        std::clamp(context.time - last_time_.value(), 0.0f, kMaxDeltaTime);
+  }
+  last_time_ = context.time;
+
+  const auto emit = emit_remainder_ + delta_time * capacity_ / kMeanLifetime;
+  const auto uniforms = SimulationUniforms{
+      .delta_time = delta_time,
+      .emit_count = static_cast<Uint32>(emit),
+      .capacity = capacity_,
+      .frame = frame_,
+  };
+  emit_remainder_ = emit - static_cast<float>(uniforms.emit_count);
+
+  {
+    const auto proj = glm::perspective(glm::radians(context.camera.fov),  //
+                                       context.GetAspectRatio(),          //
+                                       0.1f,                              //
+                                       1000.0f                            //
+    );
+    const auto view = glm::lookAt(context.camera.eye,       // eye
+                                  glm::vec3{0},             // center
+                                  glm::vec3{0.0, 1.0, 0.0}  // up
+    );
+    draw_uniforms_ = DrawUniforms{
+        .view_projection = proj * view,
+        .camera_right = {view[0][0], view[1][0], view[2][0], kBillboardSize},
+        .camera_up = {view[0][1], view[1][1], view[2][1], 0.0f},
+    };
+  }
+
+  // Recorded into a command buffer of its own that is submitted before the
+  // one the frame is drawn with.
+  auto command_buffer = SDL_AcquireGPUCommandBuffer(device_);
+  if (!command_buffer) {
+    FML_LOG(ERROR) << "Could not create command buffer: " << SDL_GetError();
+    return false;
+  }
+  if (!RecordSimulation(command_buffer, uniforms)) {
+    SDL_CancelGPUCommandBuffer(command_buffer);
+    return false;
+  }
+  if (!SDL_SubmitGPUCommandBuffer(command_buffer)) {
+    FML_LOG(ERROR) << "Could not submit command buffer: " << SDL_GetError();
+    return false;
+  }
+  CountSubmission();
+  is_initialized_ = true;
+  // The survivors are now in what becomes the current alive list.
+  frame_++;
+  simulation_record_ms_ = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+
+  PollCounters();
+  return true;
+}
+
+void Particles::PollCounters() {
+  if (counters_readback_.IsValid() && !counters_readback_.IsReady()) {
+    return;
+  }
+  if (counters_readback_.IsValid()) {
+    if (auto bytes = counters_readback_.Take(); bytes.has_value()) {
+      std::array<Uint32, kCounterCount> counters = {};
+      std::memcpy(counters.data(), bytes->data(),
+                  std::min(bytes->size(), sizeof(counters)));
+      alive_count_ = counters[kAliveCount];
+      emitted_count_ = counters[kEmitCount];
+    }
+  }
+  counters_readback_ = PerformDeviceToHostTransfer(
+      counters_, 0u, kCounterCount * sizeof(Uint32));
+}
+
+void Particles::DrawStatsUI() const {
+  ImGui::Begin("Particles");
+  ImGui::Text("Alive: %u / %u", alive_count_, capacity_);
+  ImGui::Text("Emitted: %u per frame", emitted_count_);
+  ImGui::Text("Simulation recorded in %.3f ms", simulation_record_ms_);
+  ImGui::End();
+}
+
+bool Particles::Draw(const DrawContext& context) {
+  TS_PROFILE_SCOPE("Particles::Draw");
+  if (!is_valid_) {
+    return false;
+  }
+  DrawStatsUI();
+  if (!is_initialized_) {
+    return true;
+  }
+
+  SDL_PushGPUDebugGroup(context.command_buffer, "Particles");
+  FML_DEFER(SDL_PopGPUDebugGroup(context.command_buffer));
+
+  SDL_BindGPUGraphicsPipeline(context.pass, render_pipeline_->get().value);
+  CountPipelineBind();
+  const auto buffers = std::array<SDL_GPUBuffer*, 2u>{
+      particles_.get().value,
+      alive_lists_[frame_ % 2u].get().value,
+  };
+  SDL_BindGPUVertexStorageBuffers(context.pass, 0u, buffers.data(),
+                                  buffers.size());
+  CountStorageBufferBind();
+  SDL_PushGPUVertexUniformData(context.command_buffer, 0u, &draw_uniforms_,
+                               sizeof(draw_uniforms_));
+  // The instance count was written by the simulation.
+  SDL_DrawGPUPrimitivesIndirect(context.pass, draw_args_.get().value, 0u, 1u);
+  CountDraw();
+  return true;
+}
+
+}  // namespace ts
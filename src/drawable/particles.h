@@ -0,0 +1,93 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <array>
+#include <optional>
+#include "buffer.h"
+#include "compute_pipeline.h"
+#include "context.h"
+#include "drawable.h"
+#include "sdl_types.h"
+
+namespace ts {
+
+// Simulates and draws particles entirely on the GPU. Each frame a kickoff
+// kernel sizes the emission and simulation dispatches from counters in GPU
+// memory. Expired particles are pushed back on a dead list and survivors are
+// compacted into an alive list that is drawn as instanced billboards with an
+// indirect draw. The CPU records the same few commands every frame however
+// many particles are alive.
+class Particles final : public Drawable {
+ public:
+  static constexpr Uint32 kDefaultCapacity = 1u << 20u;
+
+  Particles(const Context& ctx, Uint32 capacity = kDefaultCapacity);
+
+  ~Particles();
+
+  bool Prepare(const DrawContext& context) override;
+
+  bool Draw(const DrawContext& context) override;
+
+  bool ReloadShaders(const Context& ctx) override;
+
+ private:
+  struct SimulationUniforms {
+    float delta_time = 0.0f;
+    Uint32 emit_count = 0u;
+    Uint32 capacity = 0u;
+    Uint32 frame = 0u;
+  };
+  struct DrawUniforms {
+    glm::mat4 view_projection;
+    // The billboard size is in w.
+    glm::vec4 camera_right;
+    glm::vec4 camera_up;
+  };
+  SDL_GPUDevice* device_ = nullptr;
+  Uint32 capacity_ = 0u;
+  ComputePipeline initialize_pipeline_;
+  ComputePipeline kickoff_pipeline_;
+  ComputePipeline emit_pipeline_;
+  ComputePipeline simulate_pipeline_;
+  SharedGPUGraphicsPipeline render_pipeline_;
+  UniqueGPUBuffer particles_;
+  UniqueGPUBuffer dead_list_;
+  // Swapped every frame. The survivors of one frame are simulated the next.
+  std::array<UniqueGPUBuffer, 2u> alive_lists_;
+  UniqueGPUBuffer counters_;
+  UniqueGPUBuffer draw_args_;
+  UniqueGPUBuffer dispatch_args_;
+  bool is_initialized_ = false;
+  Uint32 frame_ = 0u;
+  // The time of the last frame simulated.
+  std::optional<float> last_time_;
+  // The fraction of a particle left over from the emission of the last frame.
+  float emit_remainder_ = 0.0f;
+  DrawUniforms draw_uniforms_ = {};
+  // The counters are read back a few frames late for display.
+  BufferReadback counters_readback_;
+  Uint32 alive_count_ = 0u;
+  Uint32 emitted_count_ = 0u;
+  double simulation_record_ms_ = 0.0;
+  bool is_valid_ = false;
+
+  bool BuildPipelines(const Context& ctx);
+
+  bool RecordSimulation(SDL_GPUCommandBuffer* command_buffer,
+                        const SimulationUniforms& uniforms) const;
+
+  bool DispatchStep(SDL_GPUCommandBuffer* command_buffer,
+                    const ComputePipeline& pipeline,
+                    const SimulationUniforms& uniforms,
+                    Uint32 group_count,
+                    std::optional<Uint32> dispatch_args_offset) const;
+
+  void PollCounters();
+
+  void DrawStatsUI() const;
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(Particles);
+};
+
+}  // namespace ts
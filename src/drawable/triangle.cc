@@ -2,65 +2,30 @@
 
 #include <glm/glm.hpp>
 #include "buffer.h"
+#include "frame_counters.h"
+#include "gpu_memory.h"
 #include "graphics_pipeline.h"
 #include "macros.h"
+#include "profiler.h"
 #include "shader.h"
-#include "triangle.slang.h"
+#include "triangle.slang.reflection.h"
 
 namespace ts {
 
 Triangle::Triangle(const Context& ctx) {
-  auto code = fml::NonOwnedMapping(xxd_triangle_data, xxd_triangle_length);
-
-  auto vs = ShaderBuilder{}
-                .SetStage(SDL_GPU_SHADERSTAGE_VERTEX)
-                .SetCode(&code, SDL_GPU_SHADERFORMAT_MSL)
-                .SetEntrypoint("VertexMain")
-                .Build(ctx.GetDevice());
-  auto fs = ShaderBuilder{}
-                .SetStage(SDL_GPU_SHADERSTAGE_FRAGMENT)
-                .SetCode(&code, SDL_GPU_SHADERFORMAT_MSL)
-                .SetEntrypoint("FragmentMain")
-                .Build(ctx.GetDevice());
+  TS_GPU_MEMORY_OWNER("Triangle");
+  if (!BuildPipeline(ctx)) {
+    return;
+  }
   struct Vertex {
     glm::vec4 position = {};
     glm::vec4 color = {};
   };
-  auto pipeline =
-      GraphicsPipelineBuilder{}
-          .SetVertexShader(&vs)
-          .SetFragmentShader(&fs)
-          .SetPrimitiveType(SDL_GPU_PRIMITIVETYPE_TRIANGLELIST)
-          .SetVertexAttribs({SDL_GPUVertexAttribute{
-                                 // Position
-                                 .location = 0,
-                                 .buffer_slot = 0,
-                                 .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4,
-                                 .offset = offsetof(Vertex, position),
-                             },
-                             SDL_GPUVertexAttribute{
-                                 // Color
-                                 .location = 1,
-                                 .buffer_slot = 0,
-                                 .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4,
-                                 .offset = offsetof(Vertex, color),
-                             }})
-          .SetVertexBuffers({SDL_GPUVertexBufferDescription{
-              .slot = 0u,
-              .pitch = sizeof(Vertex),
-              .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-          }})
-          .SetColorTargets({SDL_GPUColorTargetDescription{
-              .format = ctx.GetColorFormat(),
-          }})
-          .SetPrimitiveType(SDL_GPU_PRIMITIVETYPE_TRIANGLESTRIP)
-          .SetSampleCount(ctx.GetColorSamples())
-          .SetDepthStencilFormat(ctx.GetDepthFormat())
-          .Build(ctx.GetDevice());
-  if (!pipeline.is_valid()) {
-    return;
-  }
-  pipeline_ = std::move(pipeline);
+  constexpr const auto& kLayout = shaders::triangle::kVertexMain;
+  static_assert(kLayout.vertex_pitch == sizeof(Vertex));
+  static_assert(kLayout.vertex_attributes[0].offset ==
+                offsetof(Vertex, position));
+  static_assert(kLayout.vertex_attributes[1].offset == offsetof(Vertex, color));
   std::vector<Vertex> vertices = {
       Vertex{
           .color = glm::vec4{1.0, 0.0, 0.0, 1.0},
@@ -84,22 +49,68 @@ Triangle::Triangle(const Context& ctx) {
   is_valid_ = true;
 }
 
+bool Triangle::BuildPipeline(const Context& ctx) {
+  auto code = ctx.GetShaderLibrary().GetBlob("triangle");
+  if (!code) {
+    return false;
+  }
+  auto& cache = ctx.GetPipelineCache();
+
+  auto vs = ShaderBuilder{}
+                .SetCode(code.get())
+                .SetReflection(shaders::triangle::kVertexMain)
+                .Build(ctx.GetDevice(), cache);
+  auto fs = ShaderBuilder{}
+                .SetCode(code.get())
+                .SetReflection(shaders::triangle::kFragmentMain)
+                .Build(ctx.GetDevice(), cache);
+  if (!vs || !fs) {
+    return false;
+  }
+  auto pipeline =
+      GraphicsPipelineBuilder{}
+          .SetVertexShader(vs.get())
+          .SetFragmentShader(fs.get())
+          .SetPrimitiveType(SDL_GPU_PRIMITIVETYPE_TRIANGLELIST)
+          .SetVertexLayout(shaders::triangle::kVertexMain)
+          .SetColorTargets({SDL_GPUColorTargetDescription{
+              .format = ctx.GetColorFormat(),
+          }})
+          .SetPrimitiveType(SDL_GPU_PRIMITIVETYPE_TRIANGLESTRIP)
+          .SetSampleCount(ctx.GetColorSamples())
+          .SetDepthStencilFormat(ctx.GetDepthFormat())
+          .Build(ctx.GetDevice(), cache);
+  if (!pipeline) {
+    return false;
+  }
+  pipeline_ = std::move(pipeline);
+  return true;
+}
+
+bool Triangle::ReloadShaders(const Context& ctx) {
+  return BuildPipeline(ctx);
+}
+
 bool Triangle::Draw(const DrawContext& context) {
+  TS_PROFILE_SCOPE("Triangle::Draw");
   if (!is_valid_) {
     return false;
   }
   SDL_PushGPUDebugGroup(context.command_buffer, "Triangle");
   FML_DEFER(SDL_PopGPUDebugGroup(context.command_buffer));
 
-  SDL_BindGPUGraphicsPipeline(context.pass, pipeline_.get().value);
+  SDL_BindGPUGraphicsPipeline(context.pass, pipeline_->get().value);
+  CountPipelineBind();
   {
     SDL_GPUBufferBinding binding = {
         .buffer = vtx_buffer_.get().value,
         .offset = 0u,
     };
     SDL_BindGPUVertexBuffers(context.pass, 0u, &binding, 1u);
+    CountBufferBind();
   }
   SDL_DrawGPUPrimitives(context.pass, 3, 1, 0, 0);
+  CountDraw();
   return true;
 }
 
@@ -2,6 +2,7 @@
 
 #include "context.h"
 #include "drawable.h"
+#include "pipeline_cache.h"
 #include "sdl_types.h"
 
 namespace ts {
@@ -12,11 +13,15 @@ class Triangle final : public Drawable {
 
   bool Draw(const DrawContext& context) override;
 
+  bool ReloadShaders(const Context& ctx) override;
+
  private:
-  UniqueGPUGraphicsPipeline pipeline_;
+  SharedGPUGraphicsPipeline pipeline_;
   UniqueGPUBuffer vtx_buffer_;
   bool is_valid_ = false;
 
+  bool BuildPipeline(const Context& ctx);
+
   FML_DISALLOW_COPY_ASSIGN_AND_MOVE(Triangle);
 };
 
@@ -0,0 +1,203 @@
+#include "frame_benchmark.h"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <glm/gtc/constants.hpp>
+#include <iostream>
+#include "drawable/model_renderer.h"
+#include "frame_counters.h"
+#include "renderer.h"
+#include "statistics.h"
+
+namespace ts {
+
+static constexpr int kWarmupFrames = 10;
+
+struct ModelFrameResult {
+  std::string model;
+  SampleSummary cpu_frame;
+  double submissions_per_frame = 0.0;
+  double draws_per_frame = 0.0;
+  double pipeline_binds_per_frame = 0.0;
+  double buffer_binds_per_frame = 0.0;
+  double storage_buffer_binds_per_frame = 0.0;
+  double sampler_binds_per_frame = 0.0;
+};
+
+// Orbits the origin once over the run while bobbing up and down and swinging
+// the field of view between 45 and 75 degrees. The path starts at the default
+// camera.
+static Camera GetCameraOnPath(int frame, int frame_count) {
+  const float angle =
+      glm::two_pi<float>() * static_cast<float>(frame) / frame_count;
+  return Camera{
+      .eye = glm::vec3{5.0f * std::sin(angle),         //
+                       1.5f * std::sin(2.0f * angle),  //
+                       -5.0f * std::cos(angle)},
+      .fov = 60.0f + 15.0f * std::sin(2.0f * angle),
+  };
+}
+
+static double ToMilliseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static std::optional<ModelFrameResult> RunModel(
+    const std::shared_ptr<Context>& context,
+    const LaunchOptions& options,
+    int model_index) {
+  const auto frames = options.benchmark_frames;
+  const auto name = GetModelCatalog()[model_index];
+  auto model = std::make_unique<ModelRenderer>(context, model_index);
+  if (!model->IsValid()) {
+    FML_LOG(ERROR) << "Could not load model " << name;
+    return std::nullopt;
+  }
+  std::vector<std::unique_ptr<Drawable>> drawables;
+  drawables.emplace_back(std::move(model));
+  Renderer renderer(context, std::move(drawables));
+  renderer.SetParallelPrepare(options.parallel_prepare);
+  auto device = context->GetDevice().get();
+
+  // Pipelines are built on first use. Keep that out of the measurements.
+  renderer.GetCamera() = GetCameraOnPath(0, frames);
+  for (int i = 0; i < kWarmupFrames; i++) {
+    if (!renderer.Render()) {
+      return std::nullopt;
+    }
+  }
+  SDL_WaitForGPUIdle(device);
+  TakeFrameCounters();
+
+  std::vector<double> frame_times;
+  frame_times.reserve(frames);
+  FrameCounters totals;
+  for (int i = 0; i < frames; i++) {
+    if (!context->IsHeadless()) {
+      // Keeps the window responsive since the app callbacks don't run.
+      SDL_PumpEvents();
+    }
+    renderer.GetCamera() = GetCameraOnPath(i, frames);
+    const auto start = std::chrono::steady_clock::now();
+    if (!renderer.Render()) {
+      return std::nullopt;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    // Waiting on the device outside of the measured interval keeps a backlog
+    // of GPU work from stalling the encoding of later frames.
+    SDL_WaitForGPUIdle(device);
+    frame_times.push_back(ToMilliseconds(end - start));
+    const auto counters = TakeFrameCounters();
+    totals.submissions += counters.submissions;
+    totals.draws += counters.draws;
+    totals.pipeline_binds += counters.pipeline_binds;
+    totals.buffer_binds += counters.buffer_binds;
+    totals.storage_buffer_binds += counters.storage_buffer_binds;
+    totals.sampler_binds += counters.sampler_binds;
+  }
+
+  return ModelFrameResult{
+      .model = name,
+      .cpu_frame = Summarize(std::move(frame_times)),
+      .submissions_per_frame =
+          static_cast<double>(totals.submissions) / frames,
+      .draws_per_frame = static_cast<double>(totals.draws) / frames,
+      .pipeline_binds_per_frame =
+          static_cast<double>(totals.pipeline_binds) / frames,
+      .buffer_binds_per_frame =
+          static_cast<double>(totals.buffer_binds) / frames,
+      .storage_buffer_binds_per_frame =
+          static_cast<double>(totals.storage_buffer_binds) / frames,
+      .sampler_binds_per_frame =
+          static_cast<double>(totals.sampler_binds) / frames,
+  };
+}
+
+static void WriteJSON(std::ostream& stream,
+                      const Context& context,
+                      const std::vector<ModelFrameResult>& results) {
+  stream << "{\"driver\":\""
+         << SDL_GetGPUDeviceDriver(context.GetDevice().get()) << "\","
+         << "\"headless\":" << (context.IsHeadless() ? "true" : "false")
+         << ",\"models\":[";
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& result = results[i];
+    const auto& cpu = result.cpu_frame;
+    stream << (i == 0 ? "" : ",")                           //
+           << "{\"model\":\"" << result.model << "\","      //
+           << "\"frames\":" << cpu.count << ","             //
+           << "\"cpu_frame\":{"                             //
+           << "\"mean_ms\":" << cpu.mean << ","             //
+           << "\"min_ms\":" << cpu.min << ","               //
+           << "\"p50_ms\":" << cpu.p50 << ","               //
+           << "\"p95_ms\":" << cpu.p95 << ","               //
+           << "\"p99_ms\":" << cpu.p99 << ","               //
+           << "\"max_ms\":" << cpu.max << "},"              //
+           << "\"submissions_per_frame\":"                  //
+           << result.submissions_per_frame << ","           //
+           << "\"draws_per_frame\":"                        //
+           << result.draws_per_frame << ","                 //
+           << "\"pipeline_binds_per_frame\":"               //
+           << result.pipeline_binds_per_frame << ","        //
+           << "\"buffer_binds_per_frame\":"                 //
+           << result.buffer_binds_per_frame << ","          //
+           << "\"storage_buffer_binds_per_frame\":"         //
+           << result.storage_buffer_binds_per_frame << ","  //
+           << "\"sampler_binds_per_frame\":"                //
+           << result.sampler_binds_per_frame << "}";
+  }
+  stream << "]}" << std::endl;
+}
+
+static void WriteCSV(std::ostream& stream,
+                     const std::vector<ModelFrameResult>& results) {
+  stream << "model,frames,cpu_mean_ms,cpu_min_ms,cpu_p50_ms,cpu_p95_ms,"
+            "cpu_p99_ms,cpu_max_ms,submissions_per_frame,draws_per_frame,"
+            "pipeline_binds_per_frame,buffer_binds_per_frame,"
+            "storage_buffer_binds_per_frame,sampler_binds_per_frame"
+         << std::endl;
+  for (const auto& result : results) {
+    const auto& cpu = result.cpu_frame;
+    stream << result.model << "," << cpu.count << "," << cpu.mean << ","
+           << cpu.min << "," << cpu.p50 << "," << cpu.p95 << "," << cpu.p99
+           << "," << cpu.max << "," << result.submissions_per_frame << ","
+           << result.draws_per_frame << "," << result.pipeline_binds_per_frame
+           << "," << result.buffer_binds_per_frame << ","
+           << result.storage_buffer_binds_per_frame << ","
+           << result.sampler_binds_per_frame << std::endl;
+  }
+}
+
+bool RunFrameBenchmark(std::shared_ptr<Context> context,
+                       const LaunchOptions& options) {
+  std::vector<ModelFrameResult> results;
+  const auto catalog = GetModelCatalog();
+  for (int i = 0; i < static_cast<int>(catalog.size()); i++) {
+    auto result = RunModel(context, options, i);
+    if (!result.has_value()) {
+      FML_LOG(ERROR) << "Could not benchmark model " << catalog[i];
+      return false;
+    }
+    results.emplace_back(std::move(result.value()));
+  }
+
+  const auto& path = options.benchmark_output_path;
+  if (path.empty()) {
+    WriteJSON(std::cout, *context, results);
+    return true;
+  }
+  std::ofstream stream(path);
+  if (!stream) {
+    FML_LOG(ERROR) << "Could not open " << path;
+    return false;
+  }
+  if (path.ends_with(".csv")) {
+    WriteCSV(stream, results);
+  } else {
+    WriteJSON(stream, *context, results);
+  }
+  return stream.good();
+}
+
+}  // namespace ts
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <memory>
+#include "context.h"
+#include "launch_options.h"
+
+namespace ts {
+
+// Renders each model in the catalog along a fixed camera path and reports the
+// CPU frame time percentiles along with the submissions and draws issued per
+// frame. Results are written to the benchmark output path as CSV if it ends
+// in ".csv" and as JSON otherwise. JSON is printed if no path is given.
+bool RunFrameBenchmark(std::shared_ptr<Context> context,
+                       const LaunchOptions& options);
+
+}  // namespace ts
@@ -0,0 +1,57 @@
+#include "frame_counters.h"
+
+#include <atomic>
+
+namespace ts {
+
+static std::atomic_size_t submissions_;
+static std::atomic_size_t draws_;
+static std::atomic_size_t dispatches_;
+static std::atomic_size_t pipeline_binds_;
+static std::atomic_size_t buffer_binds_;
+static std::atomic_size_t storage_buffer_binds_;
+static std::atomic_size_t sampler_binds_;
+
+void CountSubmission() {
+  submissions_.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void CountDraw() {
+  draws_.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void CountDispatch() {
+  dispatches_.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void CountPipelineBind() {
+  pipeline_binds_.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void CountBufferBind() {
+  buffer_binds_.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void CountStorageBufferBind() {
+  storage_buffer_binds_.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void CountSamplerBind() {
+  sampler_binds_.fetch_add(1u, std::memory_order_relaxed);
+}
+
+FrameCounters TakeFrameCounters() {
+  return FrameCounters{
+      .submissions = submissions_.exchange(0u, std::memory_order_relaxed),
+      .draws = draws_.exchange(0u, std::memory_order_relaxed),
+      .dispatches = dispatches_.exchange(0u, std::memory_order_relaxed),
+      .pipeline_binds =
+          pipeline_binds_.exchange(0u, std::memory_order_relaxed),
+      .buffer_binds = buffer_binds_.exchange(0u, std::memory_order_relaxed),
+      .storage_buffer_binds =
+          storage_buffer_binds_.exchange(0u, std::memory_order_relaxed),
+      .sampler_binds = sampler_binds_.exchange(0u, std::memory_order_relaxed),
+  };
+}
+
+}  // namespace ts
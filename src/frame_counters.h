@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ts {
+
+// The GPU work issued since the counters were last taken.
+struct FrameCounters {
+  size_t submissions = 0u;
+  size_t draws = 0u;
+  size_t dispatches = 0u;
+  size_t pipeline_binds = 0u;
+  // Vertex and index buffer binds.
+  size_t buffer_binds = 0u;
+  // Calls binding storage buffers to a shader stage.
+  size_t storage_buffer_binds = 0u;
+  size_t sampler_binds = 0u;
+};
+
+// These may be called on any thread. Work issued by the ImGui backend is not
+// counted.
+void CountSubmission();
+
+void CountDraw();
+
+void CountDispatch();
+
+void CountPipelineBind();
+
+void CountBufferBind();
+
+void CountStorageBufferBind();
+
+void CountSamplerBind();
+
+// Returns the counts accumulated since the last call and resets them.
+FrameCounters TakeFrameCounters();
+
+}  // namespace ts
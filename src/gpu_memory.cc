@@ -0,0 +1,215 @@
+#include "gpu_memory.h"
+
+#include <fml/logging.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "imgui.h"
+#include "macros.h"
+
+namespace ts {
+
+static thread_local const char* tCurrentOwner = "Untagged";
+
+static void AddToStats(GPUResourceStats& stats, size_t bytes) {
+  stats.count++;
+  stats.bytes += bytes;
+  stats.peak_count = std::max(stats.peak_count, stats.count);
+  stats.peak_bytes = std::max(stats.peak_bytes, stats.bytes);
+}
+
+static void RemoveFromStats(GPUResourceStats& stats, size_t bytes) {
+  stats.count--;
+  stats.bytes -= bytes;
+}
+
+const char* GetGPUResourceCategoryName(GPUResourceCategory category) {
+  switch (category) {
+    case GPUResourceCategory::kBuffer:
+      return "Buffer";
+    case GPUResourceCategory::kTexture:
+      return "Texture";
+    case GPUResourceCategory::kTransferBuffer:
+      return "TransferBuffer";
+    case GPUResourceCategory::kSampler:
+      return "Sampler";
+    case GPUResourceCategory::kShader:
+      return "Shader";
+    case GPUResourceCategory::kGraphicsPipeline:
+      return "GraphicsPipeline";
+    case GPUResourceCategory::kComputePipeline:
+      return "ComputePipeline";
+    case GPUResourceCategory::kFence:
+      return "Fence";
+    case GPUResourceCategory::kCount:
+      break;
+  }
+  return "Unknown";
+}
+
+GPUMemoryTracker& GPUMemoryTracker::GetInstance() {
+  static GPUMemoryTracker tracker;
+  return tracker;
+}
+
+GPUMemoryTracker::GPUMemoryTracker() = default;
+
+GPUMemoryTracker::~GPUMemoryTracker() = default;
+
+void GPUMemoryTracker::TrackCreation(GPUResourceCategory category,
+                                     const void* handle,
+                                     size_t bytes) {
+  if (handle == nullptr) {
+    return;
+  }
+  std::scoped_lock lock(mutex_);
+  auto [allocation, inserted] = allocations_.try_emplace(handle);
+  if (!inserted) {
+    FML_LOG(ERROR) << "GPU object tracked twice. Was a release missed?";
+    return;
+  }
+  allocation->second = Allocation{
+      .category = category,
+      .bytes = bytes,
+      .owner = tCurrentOwner,
+  };
+  AddToStats(categories_[static_cast<size_t>(category)], bytes);
+  AddToStats(owners_[tCurrentOwner], bytes);
+}
+
+void GPUMemoryTracker::TrackRelease(GPUResourceCategory category,
+                                    const void* handle) {
+  if (handle == nullptr) {
+    return;
+  }
+  std::scoped_lock lock(mutex_);
+  auto found = allocations_.find(handle);
+  if (found == allocations_.end()) {
+    // Objects created outside the helpers (like the ones by the ImGui backend)
+    // are not tracked.
+    return;
+  }
+  const auto& allocation = found->second;
+  FML_DCHECK(allocation.category == category);
+  RemoveFromStats(categories_[static_cast<size_t>(allocation.category)],
+                  allocation.bytes);
+  RemoveFromStats(owners_[allocation.owner], allocation.bytes);
+  allocations_.erase(found);
+}
+
+GPUResourceStats GPUMemoryTracker::GetStats(
+    GPUResourceCategory category) const {
+  std::scoped_lock lock(mutex_);
+  return categories_[static_cast<size_t>(category)];
+}
+
+size_t GPUMemoryTracker::GetLiveObjectCount() const {
+  std::scoped_lock lock(mutex_);
+  return allocations_.size();
+}
+
+static void WriteStatsJSON(std::ostream& stream,
+                           const std::string& name,
+                           const GPUResourceStats& stats) {
+  stream << "{\"name\":\"" << name << "\",\"count\":" << stats.count
+         << ",\"bytes\":" << stats.bytes
+         << ",\"peak_count\":" << stats.peak_count
+         << ",\"peak_bytes\":" << stats.peak_bytes << "}";
+}
+
+std::string GPUMemoryTracker::DumpJSON() const {
+  std::scoped_lock lock(mutex_);
+  std::stringstream stream;
+  stream << "{\"categories\":[";
+  for (size_t i = 0; i < categories_.size(); i++) {
+    if (i != 0) {
+      stream << ",";
+    }
+    WriteStatsJSON(stream,
+                   GetGPUResourceCategoryName(
+                       static_cast<GPUResourceCategory>(i)),
+                   categories_[i]);
+  }
+  stream << "],\"owners\":[";
+  bool first = true;
+  for (const auto& [owner, stats] : owners_) {
+    if (!first) {
+      stream << ",";
+    }
+    first = false;
+    WriteStatsJSON(stream, owner, stats);
+  }
+  stream << "]}";
+  return stream.str();
+}
+
+bool GPUMemoryTracker::WriteJSON(const std::string& path) const {
+  std::ofstream stream(path);
+  if (!stream) {
+    FML_LOG(ERROR) << "Could not open GPU memory dump file " << path;
+    return false;
+  }
+  stream << DumpJSON() << std::endl;
+  return stream.good();
+}
+
+static void DrawStatsRow(const char* name, const GPUResourceStats& stats) {
+  ImGui::TableNextRow();
+  ImGui::TableNextColumn();
+  ImGui::TextUnformatted(name);
+  ImGui::TableNextColumn();
+  ImGui::Text("%zu", stats.count);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.2f MB", stats.bytes / (1024.0 * 1024.0));
+  ImGui::TableNextColumn();
+  ImGui::Text("%zu", stats.peak_count);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.2f MB", stats.peak_bytes / (1024.0 * 1024.0));
+}
+
+static bool BeginStatsTable(const char* id) {
+  if (!ImGui::BeginTable(id, 5, ImGuiTableFlags_Borders)) {
+    return false;
+  }
+  ImGui::TableSetupColumn("Name");
+  ImGui::TableSetupColumn("Count");
+  ImGui::TableSetupColumn("Size");
+  ImGui::TableSetupColumn("Peak Count");
+  ImGui::TableSetupColumn("Peak Size");
+  ImGui::TableHeadersRow();
+  return true;
+}
+
+void GPUMemoryTracker::DrawPanel() {
+  ImGui::Begin("GPU Memory");
+  FML_DEFER(ImGui::End());
+  if (ImGui::Button("Dump JSON")) {
+    WriteJSON("gpu_memory.json");
+  }
+  std::scoped_lock lock(mutex_);
+  if (BeginStatsTable("Categories")) {
+    for (size_t i = 0; i < categories_.size(); i++) {
+      DrawStatsRow(
+          GetGPUResourceCategoryName(static_cast<GPUResourceCategory>(i)),
+          categories_[i]);
+    }
+    ImGui::EndTable();
+  }
+  if (BeginStatsTable("Owners")) {
+    for (const auto& [owner, stats] : owners_) {
+      DrawStatsRow(owner.c_str(), stats);
+    }
+    ImGui::EndTable();
+  }
+}
+
+GPUMemoryOwnerScope::GPUMemoryOwnerScope(const char* owner)
+    : previous_owner_(tCurrentOwner) {
+  tCurrentOwner = owner;
+}
+
+GPUMemoryOwnerScope::~GPUMemoryOwnerScope() {
+  tCurrentOwner = previous_owner_;
+}
+
+}  // namespace ts
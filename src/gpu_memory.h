@@ -0,0 +1,99 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <hedley.h>
+#include <array>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace ts {
+
+enum class GPUResourceCategory {
+  kBuffer,
+  kTexture,
+  kTransferBuffer,
+  kSampler,
+  kShader,
+  kGraphicsPipeline,
+  kComputePipeline,
+  kFence,
+  kCount,
+};
+
+const char* GetGPUResourceCategoryName(GPUResourceCategory category);
+
+struct GPUResourceStats {
+  size_t count = 0u;
+  size_t bytes = 0u;
+  size_t peak_count = 0u;
+  size_t peak_bytes = 0u;
+};
+
+// Accounts for the GPU objects created through the helpers in this project.
+// Objects are tracked by handle from creation till their unique object frees
+// them. Byte sizes are estimates from the creation parameters since the driver
+// doesn't report actual allocations.
+class GPUMemoryTracker {
+ public:
+  static GPUMemoryTracker& GetInstance();
+
+  // The object is attributed to the innermost GPUMemoryOwnerScope on the
+  // calling thread.
+  void TrackCreation(GPUResourceCategory category,
+                     const void* handle,
+                     size_t bytes = 0u);
+
+  void TrackRelease(GPUResourceCategory category, const void* handle);
+
+  GPUResourceStats GetStats(GPUResourceCategory category) const;
+
+  size_t GetLiveObjectCount() const;
+
+  std::string DumpJSON() const;
+
+  bool WriteJSON(const std::string& path) const;
+
+  // Shows the stats in an ImGui window.
+  void DrawPanel();
+
+ private:
+  struct Allocation {
+    GPUResourceCategory category = GPUResourceCategory::kBuffer;
+    size_t bytes = 0u;
+    std::string owner;
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<const void*, Allocation> allocations_;
+  std::array<GPUResourceStats, static_cast<size_t>(GPUResourceCategory::kCount)>
+      categories_;
+  std::map<std::string, GPUResourceStats> owners_;
+
+  GPUMemoryTracker();
+
+  ~GPUMemoryTracker();
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(GPUMemoryTracker);
+};
+
+// Tags GPU objects created on this thread while the scope is alive. The name
+// must be a string literal or otherwise outlive the scope.
+class GPUMemoryOwnerScope {
+ public:
+  explicit GPUMemoryOwnerScope(const char* owner);
+
+  ~GPUMemoryOwnerScope();
+
+ private:
+  const char* previous_owner_;
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(GPUMemoryOwnerScope);
+};
+
+}  // namespace ts
+
+#define TS_GPU_MEMORY_OWNER(owner) \
+  ::ts::GPUMemoryOwnerScope HEDLEY_CONCAT(_ts_gpu_memory_owner_, __LINE__)(owner)
@@ -35,6 +35,8 @@ UniqueGPUGraphicsPipeline GraphicsPipelineBuilder::Build(
     FML_LOG(ERROR) << "Could not create graphics pipeline: " << SDL_GetError();
     return {};
   }
+  GPUMemoryTracker::GetInstance().TrackCreation(
+      GPUResourceCategory::kGraphicsPipeline, pipeline);
 
   GPUDevicePair<SDL_GPUGraphicsPipeline> res = {};
   res.device = device.get();
@@ -42,6 +44,12 @@ UniqueGPUGraphicsPipeline GraphicsPipelineBuilder::Build(
   return UniqueGPUGraphicsPipeline{res};
 }
 
+SharedGPUGraphicsPipeline GraphicsPipelineBuilder::Build(
+    const UniqueGPUDevice& device,
+    PipelineCache& cache) const {
+  return cache.GetGraphicsPipeline(device, *this);
+}
+
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetPrimitiveType(
     SDL_GPUPrimitiveType type) {
   primitive_type_ = type;
@@ -49,13 +57,13 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetPrimitiveType(
 }
 
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetVertexShader(
-    UniqueGPUShader* vertex_shader) {
+    const UniqueGPUShader* vertex_shader) {
   vertex_shader_ = vertex_shader;
   return *this;
 }
 
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetFragmentShader(
-    UniqueGPUShader* fragment_shader) {
+    const UniqueGPUShader* fragment_shader) {
   fragment_shader_ = fragment_shader;
   return *this;
 }
@@ -72,6 +80,21 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetVertexAttribs(
   return *this;
 }
 
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetVertexLayout(
+    const EntryPointReflection& vertex_entrypoint) {
+  FML_DCHECK(vertex_entrypoint.stage == ShaderStage::kVertex);
+  const auto& attribs = vertex_entrypoint.vertex_attributes;
+  vertex_attribs_.assign(attribs.begin(), attribs.end());
+  vertex_buffers_ = {
+      SDL_GPUVertexBufferDescription{
+          .slot = 0u,
+          .pitch = vertex_entrypoint.vertex_pitch,
+          .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
+      },
+  };
+  return *this;
+}
+
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetColorTargets(
     std::vector<SDL_GPUColorTargetDescription> color_targets) {
   color_targets_ = std::move(color_targets);
@@ -2,7 +2,9 @@
 
 #include <fml/macros.h>
 
+#include "pipeline_cache.h"
 #include "sdl_types.h"
+#include "shader_reflection.h"
 
 namespace ts {
 
@@ -14,11 +16,18 @@ class GraphicsPipelineBuilder {
 
   UniqueGPUGraphicsPipeline Build(const UniqueGPUDevice& device) const;
 
+  // Returns a shared pipeline with the same state from the cache if there is
+  // one. The shaders must have been obtained from the same cache.
+  SharedGPUGraphicsPipeline Build(const UniqueGPUDevice& device,
+                                  PipelineCache& cache) const;
+
   GraphicsPipelineBuilder& SetPrimitiveType(SDL_GPUPrimitiveType type);
 
-  GraphicsPipelineBuilder& SetVertexShader(UniqueGPUShader* vertex_shader);
+  GraphicsPipelineBuilder& SetVertexShader(
+      const UniqueGPUShader* vertex_shader);
 
-  GraphicsPipelineBuilder& SetFragmentShader(UniqueGPUShader* fragment_shader);
+  GraphicsPipelineBuilder& SetFragmentShader(
+      const UniqueGPUShader* fragment_shader);
 
   GraphicsPipelineBuilder& SetVertexBuffers(
       std::vector<SDL_GPUVertexBufferDescription> vertex_buffers);
@@ -26,6 +35,11 @@ class GraphicsPipelineBuilder {
   GraphicsPipelineBuilder& SetVertexAttribs(
       std::vector<SDL_GPUVertexAttribute> vertex_attribs);
 
+  // Sets the vertex attributes and the buffer description for the reflected
+  // inputs of a vertex entrypoint.
+  GraphicsPipelineBuilder& SetVertexLayout(
+      const EntryPointReflection& vertex_entrypoint);
+
   GraphicsPipelineBuilder& SetColorTargets(
       std::vector<SDL_GPUColorTargetDescription> color_targets);
 
@@ -40,8 +54,10 @@ class GraphicsPipelineBuilder {
   GraphicsPipelineBuilder& SetCullMode(SDL_GPUCullMode cull_mode);
 
  private:
-  UniqueGPUShader* vertex_shader_ = nullptr;
-  UniqueGPUShader* fragment_shader_ = nullptr;
+  friend class PipelineCache;
+
+  const UniqueGPUShader* vertex_shader_ = nullptr;
+  const UniqueGPUShader* fragment_shader_ = nullptr;
   SDL_GPUPrimitiveType primitive_type_ = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST;
   std::vector<SDL_GPUVertexBufferDescription> vertex_buffers_;
   std::vector<SDL_GPUVertexAttribute> vertex_attribs_;
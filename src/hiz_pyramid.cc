@@ -0,0 +1,206 @@
+#include "hiz_pyramid.h"
+
+#include <fml/logging.h>
+#include <bit>
+#include "frame_counters.h"
+#include "hiz.slang.reflection.h"
+#include "macros.h"
+#include "profiler.h"
+
+namespace ts {
+
+static constexpr SDL_GPUTextureFormat kFormat = SDL_GPU_TEXTUREFORMAT_R32_FLOAT;
+
+static ComputePipeline CreateReductionPipeline(const Context& ctx) {
+  auto code = ctx.GetShaderLibrary().GetBlob("hiz");
+  if (!code) {
+    return {};
+  }
+  return ComputePipelineBuilder{}
+      .SetShader(code.get())
+      .SetReflection(shaders::hiz::kReduceDepth)
+      .Build(ctx.GetDevice());
+}
+
+// Levels are rounded down till the larger dimension is a single texel.
+static glm::ivec2 GetLevelSize(glm::ivec2 size, size_t level) {
+  return glm::max(size >> glm::ivec2{static_cast<int>(level)}, glm::ivec2{1});
+}
+
+HiZPyramid::HiZPyramid(const Context& ctx)
+    : device_(ctx.GetDevice().get()), pool_(&ctx.GetRenderTargetPool()) {
+  pipeline_ = CreateReductionPipeline(ctx);
+  if (!pipeline_.IsValid()) {
+    return;
+  }
+  sampler_ = CreateSampler(
+      device_, SDL_GPUSamplerCreateInfo{
+                   .min_filter = SDL_GPU_FILTER_NEAREST,
+                   .mag_filter = SDL_GPU_FILTER_NEAREST,
+                   .mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_NEAREST,
+                   .address_mode_u = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+                   .address_mode_v = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+               });
+  if (!sampler_.is_valid()) {
+    FML_LOG(ERROR) << "Could not create Hi-Z sampler.";
+    return;
+  }
+  is_valid_ = true;
+}
+
+HiZPyramid::~HiZPyramid() = default;
+
+bool HiZPyramid::IsValid() const {
+  return is_valid_;
+}
+
+SDL_GPUTexture* HiZPyramid::GetTexture() const {
+  return pyramid_.Get();
+}
+
+glm::ivec2 HiZPyramid::GetSize() const {
+  return size_;
+}
+
+Uint32 HiZPyramid::GetLevelCount() const {
+  return levels_.size();
+}
+
+SDL_GPUSampler* HiZPyramid::GetSampler() const {
+  return sampler_.get().value;
+}
+
+size_t HiZPyramid::GetGPUMemorySize() const {
+  auto size = pyramid_.GetSize();
+  for (const auto& level : levels_) {
+    size += level.GetSize();
+  }
+  return size;
+}
+
+bool HiZPyramid::ReloadShaders(const Context& ctx) {
+  auto pipeline = CreateReductionPipeline(ctx);
+  if (!pipeline.IsValid()) {
+    return false;
+  }
+  pipeline_ = std::move(pipeline);
+  return true;
+}
+
+bool HiZPyramid::Resize(glm::ivec2 size) {
+  const auto max_size = static_cast<unsigned>(glm::max(size.x, size.y));
+  const Uint32 level_count = std::bit_width(max_size);
+  // The previous textures go back to the pool.
+  size_ = {};
+  levels_.clear();
+  pyramid_ = pool_->Acquire(RenderTargetDescriptor{
+      .size = size,
+      .format = kFormat,
+      .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER,
+      .mip_levels = level_count,
+  });
+  if (!pyramid_.IsValid()) {
+    return false;
+  }
+  for (Uint32 level = 0; level < level_count; level++) {
+    auto texture = pool_->Acquire(RenderTargetDescriptor{
+        .size = GetLevelSize(size, level),
+        .format = kFormat,
+        .usage = SDL_GPU_TEXTUREUSAGE_SAMPLER |
+                 SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_WRITE,
+    });
+    if (!texture.IsValid()) {
+      levels_.clear();
+      return false;
+    }
+    levels_.push_back(std::move(texture));
+  }
+  size_ = size;
+  return true;
+}
+
+bool HiZPyramid::RecordLevel(SDL_GPUCommandBuffer* command_buffer,
+                             SDL_GPUTexture* source,
+                             glm::ivec2 source_size,
+                             size_t level) const {
+  const auto size = GetLevelSize(size_, level);
+  const auto output = SDL_GPUStorageTextureReadWriteBinding{
+      .texture = levels_[level].Get(),
+  };
+  // Each level gets its own pass so that it sees the writes to the previous
+  // one.
+  auto pass = SDL_BeginGPUComputePass(command_buffer, &output, 1u, nullptr, 0u);
+  if (!pass) {
+    FML_LOG(ERROR) << "Could not create compute pass: " << SDL_GetError();
+    return false;
+  }
+  FML_DEFER(SDL_EndGPUComputePass(pass));
+  SDL_BindGPUComputePipeline(pass, pipeline_.pipeline.get().value);
+  CountPipelineBind();
+  const auto binding = SDL_GPUTextureSamplerBinding{
+      .texture = source,
+      .sampler = sampler_.get().value,
+  };
+  SDL_BindGPUComputeSamplers(pass, 0u, &binding, 1u);
+  CountSamplerBind();
+  const auto uniforms = Uniforms{
+      .source_size = source_size,
+      .size = size,
+      .scale = level == 0u ? 1 : 2,
+  };
+  SDL_PushGPUComputeUniformData(command_buffer, 0u, &uniforms,
+                                sizeof(uniforms));
+  SDL_DispatchGPUCompute(
+      pass, MakeGroupCount<Uint32>(size.x, pipeline_.thread_count.x),
+      MakeGroupCount<Uint32>(size.y, pipeline_.thread_count.y), 1u);
+  CountDispatch();
+  return true;
+}
+
+bool HiZPyramid::Record(SDL_GPUCommandBuffer* command_buffer,
+                        SDL_GPUTexture* depth,
+                        glm::ivec2 size) {
+  TS_PROFILE_SCOPE("HiZPyramid::Record");
+  if (!is_valid_ || glm::any(glm::lessThan(size, glm::ivec2{1}))) {
+    return false;
+  }
+  if (size != size_ && !Resize(size)) {
+    return false;
+  }
+
+  SDL_PushGPUDebugGroup(command_buffer, "Hi-Z");
+  FML_DEFER(SDL_PopGPUDebugGroup(command_buffer));
+
+  // Level zero is a copy of the depth buffer.
+  if (!RecordLevel(command_buffer, depth, size, 0u)) {
+    return false;
+  }
+  for (size_t level = 1; level < levels_.size(); level++) {
+    if (!RecordLevel(command_buffer, levels_[level - 1].Get(),
+                     GetLevelSize(size, level - 1), level)) {
+      return false;
+    }
+  }
+
+  auto copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+  if (!copy_pass) {
+    FML_LOG(ERROR) << "Could not create copy pass: " << SDL_GetError();
+    return false;
+  }
+  FML_DEFER(SDL_EndGPUCopyPass(copy_pass));
+  for (size_t level = 0; level < levels_.size(); level++) {
+    const auto level_size = GetLevelSize(size, level);
+    const auto src = SDL_GPUTextureLocation{
+        .texture = levels_[level].Get(),
+    };
+    const auto dst = SDL_GPUTextureLocation{
+        .texture = pyramid_.Get(),
+        .mip_level = static_cast<Uint32>(level),
+    };
+    SDL_CopyGPUTextureToTexture(copy_pass, &src, &dst, level_size.x,
+                                level_size.y, 1u, false);
+  }
+  return true;
+}
+
+}  // namespace ts
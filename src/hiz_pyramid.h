@@ -0,0 +1,78 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "compute_pipeline.h"
+#include "context.h"
+#include "render_target_pool.h"
+#include "sdl_types.h"
+
+namespace ts {
+
+// A hierarchical depth pyramid built from a depth buffer with compute. Level
+// zero has the size of the depth buffer and each texel of a level keeps the
+// smallest depth of the texels it covers in the level below. Draws pass the
+// depth test with greater depths so anything whose depth is smaller than that
+// of a texel is hidden everywhere the texel covers.
+//
+// SDL GPU can't bind a level of a texture for reading while another is
+// written. So each level is reduced into a texture of its own and copied into
+// the mip chain that is sampled. The textures come from the render target
+// pool of the context so that going back to a previous size doesn't allocate.
+class HiZPyramid {
+ public:
+  explicit HiZPyramid(const Context& ctx);
+
+  ~HiZPyramid();
+
+  bool IsValid() const;
+
+  // Records the reduction of the depth buffer into the command buffer. The
+  // depth buffer must be sampleable and not multisampled. The textures are
+  // recreated when the size changes.
+  bool Record(SDL_GPUCommandBuffer* command_buffer,
+              SDL_GPUTexture* depth,
+              glm::ivec2 size);
+
+  // An R32 float texture with a level per reduction. Null till recorded.
+  SDL_GPUTexture* GetTexture() const;
+
+  glm::ivec2 GetSize() const;
+
+  Uint32 GetLevelCount() const;
+
+  // A nearest sampler to load texels of the pyramid with.
+  SDL_GPUSampler* GetSampler() const;
+
+  size_t GetGPUMemorySize() const;
+
+  bool ReloadShaders(const Context& ctx);
+
+ private:
+  struct Uniforms {
+    glm::ivec2 source_size = {};
+    glm::ivec2 size = {};
+    Sint32 scale = 1;
+    Sint32 padding[3] = {};
+  };
+  SDL_GPUDevice* device_ = nullptr;
+  RenderTargetPool* pool_ = nullptr;
+  ComputePipeline pipeline_;
+  UniqueGPUSampler sampler_;
+  glm::ivec2 size_ = {};
+  PooledTexture pyramid_;
+  std::vector<PooledTexture> levels_;
+  bool is_valid_ = false;
+
+  bool Resize(glm::ivec2 size);
+
+  bool RecordLevel(SDL_GPUCommandBuffer* command_buffer,
+                   SDL_GPUTexture* source,
+                   glm::ivec2 source_size,
+                   size_t level) const;
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(HiZPyramid);
+};
+
+}  // namespace ts
@@ -0,0 +1,244 @@
+#include "job_system.h"
+
+#include <fml/logging.h>
+#include <algorithm>
+#include <string>
+#include "profiler.h"
+
+namespace ts {
+
+struct JobCounter::Job {
+  std::function<void()> function;
+  JobCounter* counter = nullptr;
+  // The next continuation of the same dependency.
+  Job* next = nullptr;
+};
+
+namespace {
+
+struct WorkerIdentity {
+  const JobSystem* system = nullptr;
+  size_t index = 0u;
+};
+
+}  // namespace
+
+static thread_local WorkerIdentity tWorker;
+
+bool JobCounter::IsDone() const {
+  return pending_.load(std::memory_order_acquire) == 0u;
+}
+
+size_t JobSystem::GetDefaultWorkerCount() {
+  const size_t hardware_threads = std::thread::hardware_concurrency();
+  return hardware_threads > 1u ? hardware_threads - 1u : 0u;
+}
+
+JobSystem::JobSystem(size_t worker_count) {
+  deques_.reserve(worker_count);
+  for (size_t i = 0; i < worker_count; i++) {
+    deques_.emplace_back(std::make_unique<Deque>());
+  }
+  workers_.reserve(worker_count);
+  for (size_t i = 0; i < worker_count; i++) {
+    workers_.emplace_back([this, i]() { WorkerMain(i); });
+  }
+}
+
+JobSystem::~JobSystem() {
+  FML_CHECK(queued_.load() == 0u) << "Jobs were still pending.";
+  {
+    std::scoped_lock lock(sleep_mutex_);
+    terminate_ = true;
+  }
+  sleep_cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+size_t JobSystem::GetWorkerCount() const {
+  return workers_.size();
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter& counter) {
+  counter.pending_.fetch_add(1u, std::memory_order_relaxed);
+  Schedule(new Job{
+      .function = std::move(job),
+      .counter = &counter,
+  });
+}
+
+void JobSystem::RunAfter(JobCounter& dependency,
+                         std::function<void()> job,
+                         JobCounter& counter) {
+  counter.pending_.fetch_add(1u, std::memory_order_relaxed);
+  auto continuation = new Job{
+      .function = std::move(job),
+      .counter = &counter,
+  };
+  // Hold the dependency open while the continuation is pushed. Whoever
+  // finishes the dependency schedules its continuations.
+  dependency.pending_.fetch_add(1u, std::memory_order_relaxed);
+  continuation->next =
+      dependency.continuations_.load(std::memory_order_relaxed);
+  while (!dependency.continuations_.compare_exchange_weak(
+      continuation->next, continuation, std::memory_order_release,
+      std::memory_order_relaxed)) {
+  }
+  FinishJob(dependency);
+}
+
+void JobSystem::Wait(const JobCounter& counter) {
+  TS_PROFILE_SCOPE("JobSystem::Wait");
+  while (!counter.IsDone()) {
+    if (!TryRunOne()) {
+      // The remaining jobs are running on other threads.
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::ParallelFor(
+    size_t count,
+    size_t batch_size,
+    const std::function<void(size_t, size_t)>& function) {
+  batch_size = std::max<size_t>(batch_size, 1u);
+  if (count <= batch_size) {
+    function(0u, count);
+    return;
+  }
+  JobCounter counter;
+  // The calling thread takes the first batch itself.
+  for (size_t begin = batch_size; begin < count; begin += batch_size) {
+    const auto end = std::min(begin + batch_size, count);
+    Run([&function, begin, end]() { function(begin, end); }, counter);
+  }
+  function(0u, batch_size);
+  Wait(counter);
+}
+
+void JobSystem::WorkerMain(size_t index) {
+  tWorker = {.system = this, .index = index};
+  Profiler::GetInstance().SetThreadName("Job Worker " + std::to_string(index));
+  while (true) {
+    if (auto job = TakeJob()) {
+      Execute(job);
+      continue;
+    }
+    std::unique_lock lock(sleep_mutex_);
+    sleeping_workers_.fetch_add(1u);
+    sleep_cv_.wait(lock, [&]() { return terminate_ || queued_.load() > 0u; });
+    sleeping_workers_.fetch_sub(1u);
+    if (terminate_) {
+      return;
+    }
+  }
+}
+
+void JobSystem::Schedule(Job* job) {
+  // Counted before the job is visible so the count never underflows.
+  queued_.fetch_add(1u);
+  const auto is_worker = tWorker.system == this;
+  if (!is_worker || !deques_[tWorker.index]->Push(job)) {
+    std::scoped_lock lock(injected_mutex_);
+    injected_.push_back(job);
+  }
+  WakeWorker();
+}
+
+JobSystem::Job* JobSystem::TakeJob() {
+  Job* job = nullptr;
+  const auto is_worker = tWorker.system == this;
+  if (is_worker) {
+    job = deques_[tWorker.index]->Pop().value_or(nullptr);
+  }
+  if (!job) {
+    std::scoped_lock lock(injected_mutex_);
+    if (!injected_.empty()) {
+      job = injected_.front();
+      injected_.pop_front();
+    }
+  }
+  if (!job && !deques_.empty()) {
+    // Start at a different victim on each thread to spread out contention.
+    const auto start = is_worker ? tWorker.index + 1u : 0u;
+    for (size_t i = 0; i < deques_.size() && !job; i++) {
+      const auto victim = (start + i) % deques_.size();
+      if (is_worker && victim == tWorker.index) {
+        continue;
+      }
+      job = deques_[victim]->Steal().value_or(nullptr);
+    }
+  }
+  if (job) {
+    queued_.fetch_sub(1u);
+  }
+  return job;
+}
+
+bool JobSystem::TryRunOne() {
+  auto job = TakeJob();
+  if (!job) {
+    return false;
+  }
+  Execute(job);
+  return true;
+}
+
+void JobSystem::Execute(Job* job) {
+  job->function();
+  auto& counter = *job->counter;
+  delete job;
+  FinishJob(counter);
+}
+
+void JobSystem::FinishJob(JobCounter& counter) {
+  auto pending = counter.pending_.load(std::memory_order_acquire);
+  while (true) {
+    if (pending > 1u) {
+      if (counter.pending_.compare_exchange_weak(pending, pending - 1u,
+                                                 std::memory_order_acq_rel)) {
+        return;
+      }
+      continue;
+    }
+    // This may be the last job. The counter may be destroyed as soon as it
+    // reaches zero so the continuations are taken before that.
+    auto continuations =
+        counter.continuations_.exchange(nullptr, std::memory_order_acquire);
+    if (counter.pending_.compare_exchange_strong(pending, 0u,
+                                                 std::memory_order_acq_rel)) {
+      while (continuations) {
+        auto next = continuations->next;
+        continuations->next = nullptr;
+        Schedule(continuations);
+        continuations = next;
+      }
+      return;
+    }
+    // More jobs were added in the meantime. Put the continuations back.
+    while (continuations) {
+      auto next = continuations->next;
+      continuations->next = counter.continuations_.load();
+      while (!counter.continuations_.compare_exchange_weak(
+          continuations->next, continuations, std::memory_order_release,
+          std::memory_order_relaxed)) {
+      }
+      continuations = next;
+    }
+  }
+}
+
+void JobSystem::WakeWorker() {
+  if (sleeping_workers_.load() == 0u) {
+    return;
+  }
+  {
+    // Workers check for jobs with this held before sleeping.
+    std::scoped_lock lock(sleep_mutex_);
+  }
+  sleep_cv_.notify_one();
+}
+
+}  // namespace ts
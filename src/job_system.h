@@ -0,0 +1,106 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "work_stealing_deque.h"
+
+namespace ts {
+
+class JobSystem;
+
+// Tracks the completion of a group of jobs. A counter must outlive the jobs
+// it tracks and the jobs that run after it.
+class JobCounter {
+ public:
+  JobCounter() = default;
+
+  bool IsDone() const;
+
+ private:
+  friend class JobSystem;
+
+  struct Job;
+
+  std::atomic_size_t pending_ = 0u;
+  // An intrusive stack of jobs to schedule once the counter reaches zero.
+  std::atomic<Job*> continuations_ = nullptr;
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(JobCounter);
+};
+
+// Runs jobs on a fixed set of worker threads. Each worker owns a Chase-Lev
+// deque. Jobs run from a worker are pushed onto its deque and idle workers
+// steal from the others. Jobs run from other threads are injected through a
+// shared queue.
+//
+// Threads waiting on a counter execute pending jobs instead of blocking. So
+// jobs may wait on jobs they start.
+class JobSystem {
+ public:
+  // Leaves one hardware thread for the thread submitting jobs.
+  static size_t GetDefaultWorkerCount();
+
+  // With no workers, jobs run on the threads that wait on their counters.
+  explicit JobSystem(size_t worker_count = GetDefaultWorkerCount());
+
+  // All counters must have been waited upon.
+  ~JobSystem();
+
+  size_t GetWorkerCount() const;
+
+  void Run(std::function<void()> job, JobCounter& counter);
+
+  // Runs the job once all jobs tracked by the dependency have finished.
+  void RunAfter(JobCounter& dependency,
+                std::function<void()> job,
+                JobCounter& counter);
+
+  void Wait(const JobCounter& counter);
+
+  // Splits [0, count) into ranges of at most batch_size items and calls the
+  // function with the beginning and end of each range concurrently. Returns
+  // once all ranges have been processed.
+  void ParallelFor(size_t count,
+                   size_t batch_size,
+                   const std::function<void(size_t, size_t)>& function);
+
+ private:
+  using Job = JobCounter::Job;
+  using Deque = WorkStealingDeque<Job*, 4096u>;
+
+  std::vector<std::unique_ptr<Deque>> deques_;
+  std::vector<std::thread> workers_;
+  std::mutex injected_mutex_;
+  std::deque<Job*> injected_;
+  // Jobs that have been queued but not yet taken by any thread.
+  std::atomic_size_t queued_ = 0u;
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+  std::atomic_size_t sleeping_workers_ = 0u;
+  std::atomic_bool terminate_ = false;
+
+  void WorkerMain(size_t index);
+
+  void Schedule(Job* job);
+
+  Job* TakeJob();
+
+  bool TryRunOne();
+
+  void Execute(Job* job);
+
+  void FinishJob(JobCounter& counter);
+
+  void WakeWorker();
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(JobSystem);
+};
+
+}  // namespace ts
@@ -0,0 +1,96 @@
+#include "launch_options.h"
+
+#include <fml/logging.h>
+#include <charconv>
+#include <string_view>
+
+namespace ts {
+
+static bool ParseInt(std::string_view str, int& value) {
+  auto [ptr, error] = std::from_chars(str.data(), str.data() + str.size(), value);
+  return error == std::errc{} && ptr == str.data() + str.size();
+}
+
+static bool ParseSize(std::string_view str, glm::ivec2& size) {
+  const auto separator = str.find('x');
+  if (separator == std::string_view::npos) {
+    return false;
+  }
+  return ParseInt(str.substr(0, separator), size.x) &&
+         ParseInt(str.substr(separator + 1), size.y) && size.x > 0 &&
+         size.y > 0;
+}
+
+std::optional<LaunchOptions> ParseLaunchOptions(int argc, char* argv[]) {
+  LaunchOptions options;
+  for (int i = 1; i < argc; i++) {
+    const std::string_view arg = argv[i];
+    const auto separator = arg.find('=');
+    const auto name = arg.substr(0, separator);
+    const auto value = separator == std::string_view::npos
+                           ? std::string_view{}
+                           : arg.substr(separator + 1);
+    if (name == "--headless") {
+      options.headless = true;
+    } else if (name == "--size") {
+      if (!ParseSize(value, options.size)) {
+        FML_LOG(ERROR) << "Invalid size '" << value << "'. Expected WxH.";
+        return std::nullopt;
+      }
+    } else if (name == "--frames") {
+      if (!ParseInt(value, options.frames) || options.frames < 1) {
+        FML_LOG(ERROR) << "Invalid frame count '" << value << "'.";
+        return std::nullopt;
+      }
+    } else if (name == "--capture") {
+      if (value.empty()) {
+        FML_LOG(ERROR) << "A capture path must be specified.";
+        return std::nullopt;
+      }
+      options.capture_path = value;
+    } else if (name == "--shader-benchmark") {
+      options.shader_benchmark = true;
+      options.headless = true;
+    } else if (name == "--benchmark") {
+      options.frame_benchmark = true;
+    } else if (name == "--benchmark-frames") {
+      if (!ParseInt(value, options.benchmark_frames) ||
+          options.benchmark_frames < 1) {
+        FML_LOG(ERROR) << "Invalid benchmark frame count '" << value << "'.";
+        return std::nullopt;
+      }
+    } else if (name == "--benchmark-output") {
+      if (value.empty()) {
+        FML_LOG(ERROR) << "A benchmark output path must be specified.";
+        return std::nullopt;
+      }
+      options.benchmark_output_path = value;
+    } else if (name == "--warm-up-pipelines") {
+      options.warm_up_pipelines = true;
+    } else if (name == "--parallel-prepare") {
+      options.parallel_prepare = true;
+    } else if (name == "--dynamic-resolution") {
+      options.dynamic_resolution = true;
+    } else if (name == "--hot-reload-shaders") {
+      options.hot_reload_shaders = true;
+    } else if (name == "--trace") {
+      if (value.empty()) {
+        FML_LOG(ERROR) << "A trace path must be specified.";
+        return std::nullopt;
+      }
+      options.trace_path = value;
+    } else if (name == "--gpu-memory-dump") {
+      if (value.empty()) {
+        FML_LOG(ERROR) << "A GPU memory dump path must be specified.";
+        return std::nullopt;
+      }
+      options.gpu_memory_dump_path = value;
+    } else {
+      FML_LOG(ERROR) << "Unknown argument '" << arg << "'.";
+      return std::nullopt;
+    }
+  }
+  return options;
+}
+
+}  // namespace ts
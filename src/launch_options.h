@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <optional>
+#include <string>
+
+namespace ts {
+
+struct LaunchOptions {
+  // Render without a window into offscreen textures.
+  bool headless = false;
+  // The size of the window or the offscreen render target.
+  glm::ivec2 size = {1200, 800};
+  // The number of frames to render before exiting in headless mode.
+  int frames = 1;
+  // If set, the last headless frame is written to this path as a BMP.
+  std::string capture_path;
+  // Render the shader workloads headlessly, print GPU frame times and exit.
+  bool shader_benchmark = false;
+  // Render each model along a fixed camera path, report CPU frame times and
+  // exit.
+  bool frame_benchmark = false;
+  // The number of frames measured per benchmark workload.
+  int benchmark_frames = 300;
+  // If set, frame benchmark results are written to this path. The results are
+  // CSV if the path ends in ".csv" and JSON otherwise.
+  std::string benchmark_output_path;
+  // Build all pipelines up front instead of on first use.
+  bool warm_up_pipelines = false;
+  // Prepare drawables concurrently on the job system.
+  bool parallel_prepare = false;
+  // Scale the resolution the scene is rendered at to keep frames within the
+  // refresh interval.
+  bool dynamic_resolution = false;
+  // Recompile shaders and rebuild pipelines as shader sources are edited.
+  bool hot_reload_shaders = false;
+  // If set, CPU profiler zones are written to this path as Chrome trace JSON
+  // on exit.
+  std::string trace_path;
+  // If set, GPU memory accounting is written to this path as JSON on exit.
+  std::string gpu_memory_dump_path;
+};
+
+std::optional<LaunchOptions> ParseLaunchOptions(int argc, char* argv[]);
+
+}  // namespace ts
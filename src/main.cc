@@ -4,23 +4,111 @@
 #include <fml/logging.h>
 #include <hedley.h>
 #include "backends/imgui_impl_sdl3.h"
+#include "drawable/model.h"
+#include "frame_benchmark.h"
+#include "gpu_memory.h"
+#include "launch_options.h"
+#include "macros.h"
+#include "profiler.h"
 #include "renderer.h"
+#include "shader_benchmark.h"
 
 namespace ts {
 
 static std::unique_ptr<Renderer> renderer_;
+static LaunchOptions options_;
+static int frames_rendered_ = 0;
+// The capture of the last frame while it is being read back.
+static TextureReadback capture_;
+
+static bool WriteCapture(const HostTexture& texture, const std::string& path) {
+  if (texture.format != SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM) {
+    FML_LOG(ERROR) << "Unsupported capture format.";
+    return false;
+  }
+  auto surface = SDL_CreateSurfaceFrom(
+      texture.size.x, texture.size.y, SDL_PIXELFORMAT_RGBA32,
+      const_cast<uint8_t*>(texture.pixels.data()), texture.GetBytesPerRow());
+  if (!surface) {
+    FML_LOG(ERROR) << "Could not create surface: " << SDL_GetError();
+    return false;
+  }
+  FML_DEFER(SDL_DestroySurface(surface));
+  if (!SDL_SaveBMP(surface, path.c_str())) {
+    FML_LOG(ERROR) << "Could not write capture: " << SDL_GetError();
+    return false;
+  }
+  return true;
+}
+
+static std::unique_ptr<Renderer> CreateRenderer(
+    std::shared_ptr<Context> context) {
+  if (options_.warm_up_pipelines) {
+    // Failures are not fatal as the pipelines are built again on first use.
+    if (!Model::WarmUpPipelines(*context)) {
+      FML_LOG(ERROR) << "Could not warm up model pipelines.";
+    }
+    const auto stats = context->GetPipelineCache().GetStats();
+    FML_LOG(INFO) << "Warmed up " << stats.pipeline_count << " pipelines and "
+                  << stats.shader_count << " shaders.";
+  }
+  if (options_.hot_reload_shaders && !context->StartShaderHotReload()) {
+    FML_LOG(ERROR) << "Could not start shader hot reload.";
+  }
+  auto renderer = std::make_unique<Renderer>(std::move(context));
+  renderer->SetParallelPrepare(options_.parallel_prepare);
+  renderer->SetDynamicResolution(options_.dynamic_resolution);
+  return renderer;
+}
+
+// Either runs the frame benchmark to completion or sets up the renderer for
+// the app callbacks.
+static SDL_AppResult Start(std::shared_ptr<Context> context) {
+  if (options_.frame_benchmark) {
+    return RunFrameBenchmark(std::move(context), options_) ? SDL_APP_SUCCESS
+                                                           : SDL_APP_FAILURE;
+  }
+  renderer_ = CreateRenderer(std::move(context));
+  return SDL_APP_CONTINUE;
+}
 
 HEDLEY_C_DECL
 SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[]) {
   SDL_SetAppMetadata("Triangle Sandbox", "1.0",
                      "com.chinmaygarde.triangle_sandbox");
 
+  auto options = ParseLaunchOptions(argc, argv);
+  if (!options.has_value()) {
+    return SDL_APP_FAILURE;
+  }
+  options_ = std::move(options.value());
+
+  Profiler::GetInstance().SetThreadName("Main");
+  if (!options_.trace_path.empty()) {
+    Profiler::GetInstance().StartTrace();
+  }
+
+  if (options_.headless) {
+    // The video subsystem is still necessary to load the Vulkan library. The
+    // offscreen driver doesn't need a display server.
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+  }
+
   if (!SDL_Init(SDL_INIT_VIDEO)) {
     SDL_Log("Couldn't initialize SDL: %s", SDL_GetError());
     return SDL_APP_FAILURE;
   }
 
-  UniqueSDLWindow window(SDL_CreateWindow("Triangle Sandbox", 1200, 800, 0));
+  if (options_.shader_benchmark) {
+    return RunShaderBenchmark(options_) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+  }
+
+  if (options_.headless) {
+    return Start(std::make_unique<Context>(options_.size));
+  }
+
+  UniqueSDLWindow window(SDL_CreateWindow("Triangle Sandbox", options_.size.x,
+                                          options_.size.y, 0));
 
   if (!window.is_valid()) {
     SDL_Log("Couldn't create window: %s", SDL_GetError());
@@ -29,9 +117,7 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[]) {
 
   SDL_SetWindowResizable(window.get(), true);
 
-  renderer_ =
-      std::make_unique<Renderer>(std::make_unique<Context>(std::move(window)));
-  return SDL_APP_CONTINUE;
+  return Start(std::make_unique<Context>(std::move(window)));
 }
 
 HEDLEY_C_DECL
@@ -39,21 +125,58 @@ SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event) {
   if (event->type == SDL_EVENT_QUIT) {
     return SDL_APP_SUCCESS;
   }
-  ImGui_ImplSDL3_ProcessEvent(event);
+  if (!options_.headless) {
+    ImGui_ImplSDL3_ProcessEvent(event);
+  }
   return SDL_APP_CONTINUE;
 }
 
 HEDLEY_C_DECL
 SDL_AppResult SDL_AppIterate(void* appstate) {
-  if (renderer_) {
-    return renderer_->Render() ? SDL_APP_CONTINUE : SDL_APP_FAILURE;
+  if (!renderer_) {
+    return SDL_APP_CONTINUE;
   }
-  return SDL_APP_CONTINUE;
+  if (capture_.IsValid()) {
+    if (!capture_.IsReady()) {
+      return SDL_APP_CONTINUE;
+    }
+    auto frame = capture_.Take();
+    if (!frame.has_value() || !WriteCapture(*frame, options_.capture_path)) {
+      return SDL_APP_FAILURE;
+    }
+    return SDL_APP_SUCCESS;
+  }
+  if (!renderer_->Render()) {
+    return SDL_APP_FAILURE;
+  }
+  if (!options_.headless || ++frames_rendered_ < options_.frames) {
+    return SDL_APP_CONTINUE;
+  }
+  if (!options_.capture_path.empty()) {
+    // Written once the readback lands on a later iteration.
+    capture_ = renderer_->CaptureFrameAsync();
+    return capture_.IsValid() ? SDL_APP_CONTINUE : SDL_APP_FAILURE;
+  }
+  return SDL_APP_SUCCESS;
 }
 
 HEDLEY_C_DECL
 void SDL_AppQuit(void* appstate, SDL_AppResult result) {
+  capture_ = {};
   renderer_.reset();
+  // The renderer owned the last reference to the context. Everything tracked
+  // should have been released along with it.
+  auto& gpu_memory = GPUMemoryTracker::GetInstance();
+  if (const auto leaked = gpu_memory.GetLiveObjectCount(); leaked > 0u) {
+    FML_LOG(ERROR) << "Leaked " << leaked << " GPU objects.";
+  }
+  if (!options_.gpu_memory_dump_path.empty()) {
+    gpu_memory.WriteJSON(options_.gpu_memory_dump_path);
+  }
+  if (!options_.trace_path.empty()) {
+    Profiler::GetInstance().CollectFrame();
+    Profiler::GetInstance().StopTrace(options_.trace_path);
+  }
 }
 
 }  // namespace ts
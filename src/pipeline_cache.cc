@@ -0,0 +1,221 @@
+#include "pipeline_cache.h"
+
+#include <type_traits>
+#include "gpu_memory.h"
+#include "graphics_pipeline.h"
+#include "shader.h"
+
+namespace ts {
+
+namespace {
+
+// Appends each field individually so that struct padding never leaks into a
+// key.
+class KeyWriter {
+ public:
+  template <class T>
+  KeyWriter& Write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    key_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    return *this;
+  }
+
+  KeyWriter& Write(const std::string& value) {
+    Write(value.size());
+    key_.append(value);
+    return *this;
+  }
+
+  std::string TakeKey() { return std::move(key_); }
+
+ private:
+  std::string key_;
+};
+
+uint64_t HashCode(const uint8_t* data, size_t size) {
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325u;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 0x100000001b3u;
+  }
+  return hash;
+}
+
+void WriteStencilOpState(KeyWriter& writer,
+                         const SDL_GPUStencilOpState& state) {
+  writer.Write(state.fail_op)
+      .Write(state.pass_op)
+      .Write(state.depth_fail_op)
+      .Write(state.compare_op);
+}
+
+}  // namespace
+
+PipelineCache::PipelineCache() = default;
+
+PipelineCache::~PipelineCache() = default;
+
+SharedGPUShader PipelineCache::GetShader(const UniqueGPUDevice& device,
+                                         const ShaderBuilder& builder) {
+  auto code = builder.ResolveCode(device);
+  if (!code.has_value()) {
+    return nullptr;
+  }
+  KeyWriter writer;
+  writer.Write(HashCode(code->data, code->size))
+      .Write(code->size)
+      .Write(code->format)
+      .Write(builder.entrypoint_)
+      .Write(builder.stage_)
+      .Write(builder.num_samplers_)
+      .Write(builder.num_storage_textures_)
+      .Write(builder.num_storage_buffers_)
+      .Write(builder.num_uniform_buffers_);
+  auto key = writer.TakeKey();
+
+  std::scoped_lock lock(mutex_);
+  if (auto found = shaders_.find(key); found != shaders_.end()) {
+    hits_++;
+    return found->second;
+  }
+  misses_++;
+  // Shared objects are attributed to the cache instead of the first user.
+  TS_GPU_MEMORY_OWNER("PipelineCache");
+  auto shader = builder.Build(device);
+  if (!shader.is_valid()) {
+    return nullptr;
+  }
+  auto shared = std::make_shared<const UniqueGPUShader>(std::move(shader));
+  shader_handles_[shared->get().value] = shared;
+  shaders_[std::move(key)] = shared;
+  return shared;
+}
+
+SharedGPUGraphicsPipeline PipelineCache::GetGraphicsPipeline(
+    const UniqueGPUDevice& device,
+    const GraphicsPipelineBuilder& builder) {
+  auto shader_handle = [](const UniqueGPUShader* shader) -> SDL_GPUShader* {
+    return shader ? shader->get().value : nullptr;
+  };
+  auto vertex_shader = shader_handle(builder.vertex_shader_);
+  auto fragment_shader = shader_handle(builder.fragment_shader_);
+
+  SharedGPUShader shared_vertex_shader;
+  SharedGPUShader shared_fragment_shader;
+  {
+    std::scoped_lock lock(mutex_);
+    auto find_shader = [&](SDL_GPUShader* handle) -> SharedGPUShader {
+      auto found = shader_handles_.find(handle);
+      return found == shader_handles_.end() ? nullptr : found->second.lock();
+    };
+    shared_vertex_shader = find_shader(vertex_shader);
+    shared_fragment_shader = find_shader(fragment_shader);
+    if (!shared_vertex_shader || !shared_fragment_shader) {
+      FML_LOG(ERROR) << "Pipeline shaders were not obtained from the cache. "
+                        "The pipeline will not be cached.";
+      misses_++;
+      auto pipeline = builder.Build(device);
+      if (!pipeline.is_valid()) {
+        return nullptr;
+      }
+      return std::make_shared<const UniqueGPUGraphicsPipeline>(
+          std::move(pipeline));
+    }
+  }
+
+  KeyWriter writer;
+  writer.Write(vertex_shader)
+      .Write(fragment_shader)
+      .Write(builder.primitive_type_)
+      .Write(builder.vertex_buffers_.size());
+  for (const auto& buffer : builder.vertex_buffers_) {
+    writer.Write(buffer.slot)
+        .Write(buffer.pitch)
+        .Write(buffer.input_rate)
+        .Write(buffer.instance_step_rate);
+  }
+  writer.Write(builder.vertex_attribs_.size());
+  for (const auto& attrib : builder.vertex_attribs_) {
+    writer.Write(attrib.location)
+        .Write(attrib.buffer_slot)
+        .Write(attrib.format)
+        .Write(attrib.offset);
+  }
+  writer.Write(builder.color_targets_.size());
+  for (const auto& target : builder.color_targets_) {
+    const auto& blend = target.blend_state;
+    writer.Write(target.format)
+        .Write(blend.src_color_blendfactor)
+        .Write(blend.dst_color_blendfactor)
+        .Write(blend.color_blend_op)
+        .Write(blend.src_alpha_blendfactor)
+        .Write(blend.dst_alpha_blendfactor)
+        .Write(blend.alpha_blend_op)
+        .Write(blend.color_write_mask)
+        .Write(blend.enable_blend)
+        .Write(blend.enable_color_write_mask);
+  }
+  const auto& depth = builder.depth_stencil_;
+  writer.Write(builder.depth_stencil_format_)
+      .Write(builder.sample_count_)
+      .Write(builder.cull_mode_)
+      .Write(depth.compare_op)
+      .Write(depth.compare_mask)
+      .Write(depth.write_mask)
+      .Write(depth.enable_depth_test)
+      .Write(depth.enable_depth_write)
+      .Write(depth.enable_stencil_test);
+  WriteStencilOpState(writer, depth.back_stencil_state);
+  WriteStencilOpState(writer, depth.front_stencil_state);
+  auto key = writer.TakeKey();
+
+  std::scoped_lock lock(mutex_);
+  if (auto found = pipelines_.find(key); found != pipelines_.end()) {
+    hits_++;
+    return found->second.pipeline;
+  }
+  misses_++;
+  TS_GPU_MEMORY_OWNER("PipelineCache");
+  auto pipeline = builder.Build(device);
+  if (!pipeline.is_valid()) {
+    return nullptr;
+  }
+  auto shared =
+      std::make_shared<const UniqueGPUGraphicsPipeline>(std::move(pipeline));
+  pipelines_[std::move(key)] = CachedPipeline{
+      .pipeline = shared,
+      .vertex_shader = std::move(shared_vertex_shader),
+      .fragment_shader = std::move(shared_fragment_shader),
+  };
+  return shared;
+}
+
+size_t PipelineCache::Collect() {
+  std::scoped_lock lock(mutex_);
+  size_t collected = 0u;
+  // Pipelines go first since they hold references to their shaders.
+  collected += std::erase_if(pipelines_, [](const auto& entry) {
+    return entry.second.pipeline.use_count() == 1;
+  });
+  collected += std::erase_if(shaders_, [&](const auto& entry) {
+    if (entry.second.use_count() != 1) {
+      return false;
+    }
+    shader_handles_.erase(entry.second->get().value);
+    return true;
+  });
+  return collected;
+}
+
+PipelineCache::Stats PipelineCache::GetStats() const {
+  std::scoped_lock lock(mutex_);
+  return Stats{
+      .shader_count = shaders_.size(),
+      .pipeline_count = pipelines_.size(),
+      .hits = hits_,
+      .misses = misses_,
+  };
+}
+
+}  // namespace ts
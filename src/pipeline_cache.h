@@ -0,0 +1,70 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "sdl_types.h"
+
+namespace ts {
+
+class ShaderBuilder;
+class GraphicsPipelineBuilder;
+
+using SharedGPUShader = std::shared_ptr<const UniqueGPUShader>;
+using SharedGPUGraphicsPipeline =
+    std::shared_ptr<const UniqueGPUGraphicsPipeline>;
+
+// Deduplicates shaders and graphics pipelines created on a device.
+//
+// Shaders are keyed by the hash of their code along with the entrypoint, stage,
+// format and resource counts. Pipelines are keyed by the full builder state.
+// Cached shaders are kept alive while any cached pipeline built with them is so
+// that their handles may be used in pipeline keys.
+class PipelineCache {
+ public:
+  struct Stats {
+    size_t shader_count = 0u;
+    size_t pipeline_count = 0u;
+    size_t hits = 0u;
+    size_t misses = 0u;
+  };
+
+  PipelineCache();
+
+  ~PipelineCache();
+
+  SharedGPUShader GetShader(const UniqueGPUDevice& device,
+                            const ShaderBuilder& builder);
+
+  // The shaders referenced by the builder must have been obtained from this
+  // cache. Pipelines with other shaders are built but not cached.
+  SharedGPUGraphicsPipeline GetGraphicsPipeline(
+      const UniqueGPUDevice& device,
+      const GraphicsPipelineBuilder& builder);
+
+  Stats GetStats() const;
+
+  // Releases the objects no longer referenced outside the cache. Returns the
+  // number of objects released.
+  size_t Collect();
+
+ private:
+  struct CachedPipeline {
+    SharedGPUGraphicsPipeline pipeline;
+    SharedGPUShader vertex_shader;
+    SharedGPUShader fragment_shader;
+  };
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, SharedGPUShader> shaders_;
+  std::unordered_map<SDL_GPUShader*, std::weak_ptr<const UniqueGPUShader>>
+      shader_handles_;
+  std::unordered_map<std::string, CachedPipeline> pipelines_;
+  size_t hits_ = 0u;
+  size_t misses_ = 0u;
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(PipelineCache);
+};
+
+}  // namespace ts
@@ -0,0 +1,281 @@
+#include "profiler.h"
+
+#include <fml/logging.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <optional>
+#include "imgui.h"
+#include "macros.h"
+
+namespace ts {
+
+// Written only by the owning thread and read only by the collecting thread.
+struct Profiler::ThreadBuffer {
+  static constexpr size_t kCapacity = 16384u;
+
+  // A seqlock over one zone. The sequence is odd while the zone is written
+  // and 2 * (index + 1) once the zone at that index in the ring is complete.
+  // The fields are atomic so that the collector may copy a slot while the
+  // owner overwrites it and then discard the torn copy.
+  struct Slot {
+    std::atomic<Uint64> sequence = 0u;
+    std::atomic<const char*> name = nullptr;
+    std::atomic<Uint64> begin_ns = 0u;
+    std::atomic<Uint64> end_ns = 0u;
+    std::atomic<Uint32> depth = 0u;
+  };
+
+  Uint32 index = 0u;
+  std::string name;
+  std::array<Slot, kCapacity> zones;
+  std::atomic<Uint64> head = 0u;
+  Uint64 tail = 0u;
+
+  void Write(const ProfileZone& zone) {
+    const auto zone_index = head.load(std::memory_order_relaxed);
+    auto& slot = zones[zone_index % kCapacity];
+    slot.sequence.store(2u * zone_index + 1u, std::memory_order_relaxed);
+    // Release stores so that a reader that sees any of them also sees the
+    // odd sequence when it checks again.
+    slot.name.store(zone.name, std::memory_order_release);
+    slot.begin_ns.store(zone.begin_ns, std::memory_order_release);
+    slot.end_ns.store(zone.end_ns, std::memory_order_release);
+    slot.depth.store(zone.depth, std::memory_order_release);
+    slot.sequence.store(2u * zone_index + 2u, std::memory_order_release);
+    head.store(zone_index + 1u, std::memory_order_release);
+  }
+
+  // Returns nullopt if the zone was overwritten before or while it was read.
+  std::optional<ProfileZone> Read(Uint64 zone_index) const {
+    const auto& slot = zones[zone_index % kCapacity];
+    const auto sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != 2u * zone_index + 2u) {
+      return std::nullopt;
+    }
+    ProfileZone zone = {
+        .name = slot.name.load(std::memory_order_acquire),
+        .begin_ns = slot.begin_ns.load(std::memory_order_acquire),
+        .end_ns = slot.end_ns.load(std::memory_order_acquire),
+        .depth = slot.depth.load(std::memory_order_acquire),
+        .thread = index,
+    };
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+      return std::nullopt;
+    }
+    return zone;
+  }
+};
+
+static thread_local Uint32 tScopeDepth = 0u;
+
+Profiler& Profiler::GetInstance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler() = default;
+
+Profiler::~Profiler() = default;
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer() {
+  // Buffers are shared with the profiler so that zones recorded by threads
+  // that have exited may still be collected.
+  static thread_local std::shared_ptr<ThreadBuffer> tBuffer = [this]() {
+    auto buffer = std::make_shared<ThreadBuffer>();
+    std::scoped_lock lock(mutex_);
+    buffer->index = static_cast<Uint32>(buffers_.size());
+    buffer->name = "Thread " + std::to_string(buffer->index);
+    buffers_.push_back(buffer);
+    return buffer;
+  }();
+  return *tBuffer;
+}
+
+void Profiler::SetThreadName(std::string name) {
+  auto& buffer = GetThreadBuffer();
+  std::scoped_lock lock(mutex_);
+  buffer.name = std::move(name);
+}
+
+void Profiler::RecordZone(const ProfileZone& zone) {
+  GetThreadBuffer().Write(zone);
+}
+
+void Profiler::CollectFrame() {
+  std::scoped_lock lock(mutex_);
+  if (is_paused_) {
+    // Keep draining so that the buffers don't overflow while paused.
+    for (const auto& buffer : buffers_) {
+      buffer->tail = buffer->head.load(std::memory_order_acquire);
+    }
+    return;
+  }
+  last_frame_.clear();
+  for (const auto& buffer : buffers_) {
+    const auto head = buffer->head.load(std::memory_order_acquire);
+    auto tail = buffer->tail;
+    if (head - tail > ThreadBuffer::kCapacity) {
+      dropped_zones_ += head - tail - ThreadBuffer::kCapacity;
+      tail = head - ThreadBuffer::kCapacity;
+    }
+    // The owning thread keeps recording and may lap the reader while zones
+    // are being copied. The zones it overwrites are discarded.
+    for (auto i = tail; i < head; i++) {
+      if (auto zone = buffer->Read(i)) {
+        last_frame_.push_back(*zone);
+      } else {
+        dropped_zones_++;
+      }
+    }
+    buffer->tail = head;
+  }
+  if (is_tracing_) {
+    trace_.insert(trace_.end(), last_frame_.begin(), last_frame_.end());
+  }
+}
+
+void Profiler::StartTrace() {
+  std::scoped_lock lock(mutex_);
+  trace_.clear();
+  is_tracing_ = true;
+}
+
+bool Profiler::IsTracing() const {
+  std::scoped_lock lock(mutex_);
+  return is_tracing_;
+}
+
+static void WriteJSONString(std::ostream& stream, const std::string& str) {
+  stream << '"';
+  for (const auto c : str) {
+    if (c == '"' || c == '\\') {
+      stream << '\\';
+    }
+    stream << c;
+  }
+  stream << '"';
+}
+
+bool Profiler::StopTrace(const std::string& path) {
+  std::scoped_lock lock(mutex_);
+  is_tracing_ = false;
+  std::ofstream stream(path);
+  if (!stream) {
+    FML_LOG(ERROR) << "Could not open trace file " << path;
+    return false;
+  }
+  stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  auto separator = [&]() {
+    if (!first) {
+      stream << ",\n";
+    }
+    first = false;
+  };
+  for (const auto& buffer : buffers_) {
+    separator();
+    stream << R"({"ph":"M","name":"thread_name","pid":1,"tid":)"
+           << buffer->index << R"(,"args":{"name":)";
+    WriteJSONString(stream, buffer->name);
+    stream << "}}";
+  }
+  // Timestamps are in microseconds but fractions are allowed.
+  stream.precision(3);
+  stream << std::fixed;
+  for (const auto& zone : trace_) {
+    separator();
+    stream << R"({"ph":"X","pid":1,"tid":)" << zone.thread
+           << R"(,"ts":)" << zone.begin_ns / 1000.0 << R"(,"dur":)"
+           << (zone.end_ns - zone.begin_ns) / 1000.0 << R"(,"name":)";
+    WriteJSONString(stream, zone.name);
+    stream << "}";
+  }
+  stream << "]}\n";
+  FML_LOG(INFO) << "Wrote " << trace_.size() << " zones to " << path;
+  trace_.clear();
+  return stream.good();
+}
+
+void Profiler::DrawFlameView() {
+  std::scoped_lock lock(mutex_);
+  ImGui::Begin("Profiler");
+  FML_DEFER(ImGui::End());
+
+  ImGui::Checkbox("Pause", &is_paused_);
+  ImGui::SameLine();
+  ImGui::Text("Dropped zones: %zu", dropped_zones_);
+
+  if (last_frame_.empty()) {
+    return;
+  }
+  Uint64 frame_begin = last_frame_.front().begin_ns;
+  Uint64 frame_end = last_frame_.front().end_ns;
+  for (const auto& zone : last_frame_) {
+    frame_begin = std::min(frame_begin, zone.begin_ns);
+    frame_end = std::max(frame_end, zone.end_ns);
+  }
+  const auto frame_duration = std::max<Uint64>(frame_end - frame_begin, 1u);
+  ImGui::Text("Frame: %.3f ms", frame_duration / 1e6);
+
+  constexpr float kRowHeight = 20.0f;
+  const auto origin = ImGui::GetCursorScreenPos();
+  const auto width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+  auto draw_list = ImGui::GetWindowDrawList();
+  // Threads are stacked with each scope depth getting its own row.
+  float thread_offset = 0.0f;
+  for (const auto& buffer : buffers_) {
+    Uint32 max_depth = 0u;
+    bool has_zones = false;
+    for (const auto& zone : last_frame_) {
+      if (zone.thread != buffer->index) {
+        continue;
+      }
+      has_zones = true;
+      max_depth = std::max(max_depth, zone.depth);
+      const ImVec2 min = {
+          origin.x + width * (zone.begin_ns - frame_begin) / frame_duration,
+          origin.y + thread_offset + kRowHeight * (zone.depth + 1u),
+      };
+      const ImVec2 max = {
+          origin.x + width * (zone.end_ns - frame_begin) / frame_duration,
+          min.y + kRowHeight - 1.0f,
+      };
+      const auto hue = (std::hash<const char*>{}(zone.name) % 64u) / 64.0f;
+      draw_list->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.7f));
+      draw_list->PushClipRect(min, max, true);
+      draw_list->AddText({min.x + 2.0f, min.y + 2.0f},
+                         IM_COL32(255, 255, 255, 255), zone.name);
+      draw_list->PopClipRect();
+      if (ImGui::IsMouseHoveringRect(min, max)) {
+        ImGui::SetTooltip("%s\n%.3f ms", zone.name,
+                          (zone.end_ns - zone.begin_ns) / 1e6);
+      }
+    }
+    if (!has_zones) {
+      continue;
+    }
+    draw_list->AddText({origin.x, origin.y + thread_offset},
+                       IM_COL32(200, 200, 200, 255), buffer->name.c_str());
+    thread_offset += kRowHeight * (max_depth + 2u);
+  }
+  ImGui::Dummy({width, thread_offset});
+}
+
+ProfileScope::ProfileScope(const char* name)
+    : name_(name), begin_ns_(SDL_GetTicksNS()) {
+  tScopeDepth++;
+}
+
+ProfileScope::~ProfileScope() {
+  tScopeDepth--;
+  Profiler::GetInstance().RecordZone(ProfileZone{
+      .name = name_,
+      .begin_ns = begin_ns_,
+      .end_ns = SDL_GetTicksNS(),
+      .depth = tScopeDepth,
+  });
+}
+
+}  // namespace ts
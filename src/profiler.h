@@ -0,0 +1,84 @@
+#pragma once
+
+#include <SDL3/SDL_timer.h>
+#include <fml/macros.h>
+#include <hedley.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ts {
+
+struct ProfileZone {
+  // Must be a string literal or otherwise outlive the profiler.
+  const char* name = nullptr;
+  Uint64 begin_ns = 0u;
+  Uint64 end_ns = 0u;
+  Uint32 depth = 0u;
+  Uint32 thread = 0u;
+};
+
+// Records scoped CPU zones into per-thread ring buffers. Recording a zone takes
+// no locks. The thread driving rendering collects zones from all threads once a
+// frame for the flame view and trace export.
+class Profiler {
+ public:
+  static Profiler& GetInstance();
+
+  // Names the calling thread in traces.
+  void SetThreadName(std::string name);
+
+  void RecordZone(const ProfileZone& zone);
+
+  // Moves the zones recorded since the last call out of the thread buffers.
+  void CollectFrame();
+
+  void StartTrace();
+
+  bool IsTracing() const;
+
+  // Writes the zones collected since the trace was started as Chrome trace
+  // JSON. The file may be opened in chrome://tracing or Perfetto.
+  bool StopTrace(const std::string& path);
+
+  // Shows the zones of the last collected frame in an ImGui window.
+  void DrawFlameView();
+
+ private:
+  struct ThreadBuffer;
+
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+  std::vector<ProfileZone> last_frame_;
+  std::vector<ProfileZone> trace_;
+  bool is_tracing_ = false;
+  bool is_paused_ = false;
+  size_t dropped_zones_ = 0u;
+
+  Profiler();
+
+  ~Profiler();
+
+  ThreadBuffer& GetThreadBuffer();
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(Profiler);
+};
+
+class ProfileScope {
+ public:
+  explicit ProfileScope(const char* name);
+
+  ~ProfileScope();
+
+ private:
+  const char* name_;
+  Uint64 begin_ns_;
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(ProfileScope);
+};
+
+}  // namespace ts
+
+#define TS_PROFILE_SCOPE(name) \
+  ::ts::ProfileScope HEDLEY_CONCAT(_ts_profile_scope_, __LINE__)(name)
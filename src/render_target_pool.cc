@@ -0,0 +1,135 @@
+#include "render_target_pool.h"
+
+#include <algorithm>
+#include <utility>
+#include "gpu_memory.h"
+
+namespace ts {
+
+// About five seconds at 60 FPS. Long enough to keep the targets of the scales
+// a dynamic resolution controller settles between.
+static constexpr size_t kMaxIdleFrames = 300u;
+
+PooledTexture::PooledTexture() = default;
+
+PooledTexture::PooledTexture(RenderTargetPool* pool,
+                             RenderTargetDescriptor descriptor,
+                             GPUTexture texture)
+    : pool_(pool), descriptor_(descriptor), texture_(std::move(texture)) {}
+
+PooledTexture::~PooledTexture() {
+  Reset();
+}
+
+PooledTexture::PooledTexture(PooledTexture&& other)
+    : pool_(std::exchange(other.pool_, nullptr)),
+      descriptor_(other.descriptor_),
+      texture_(std::move(other.texture_)) {}
+
+PooledTexture& PooledTexture::operator=(PooledTexture&& other) {
+  if (this != &other) {
+    Reset();
+    pool_ = std::exchange(other.pool_, nullptr);
+    descriptor_ = other.descriptor_;
+    texture_ = std::move(other.texture_);
+  }
+  return *this;
+}
+
+void PooledTexture::Reset() {
+  if (pool_ && texture_.IsValid()) {
+    pool_->Return(descriptor_, std::move(texture_));
+  }
+  pool_ = nullptr;
+  texture_ = {};
+}
+
+bool PooledTexture::IsValid() const {
+  return texture_.IsValid();
+}
+
+SDL_GPUTexture* PooledTexture::Get() const {
+  return texture_.texture.get().value;
+}
+
+const RenderTargetDescriptor& PooledTexture::GetDescriptor() const {
+  return descriptor_;
+}
+
+size_t PooledTexture::GetSize() const {
+  return texture_.GetSize();
+}
+
+RenderTargetPool::RenderTargetPool(SDL_GPUDevice* device) : device_(device) {}
+
+RenderTargetPool::~RenderTargetPool() = default;
+
+PooledTexture RenderTargetPool::Acquire(
+    const RenderTargetDescriptor& descriptor) {
+  {
+    std::scoped_lock lock(mutex_);
+    // The most recently returned match is the likeliest to be warm.
+    auto found = std::find_if(
+        free_textures_.rbegin(), free_textures_.rend(),
+        [&](const auto& free) { return free.descriptor == descriptor; });
+    if (found != free_textures_.rend()) {
+      auto texture = std::move(found->texture);
+      free_textures_.erase(std::next(found).base());
+      stats_.free_count--;
+      stats_.reuses++;
+      return PooledTexture{this, descriptor, std::move(texture)};
+    }
+  }
+
+  TS_GPU_MEMORY_OWNER("RenderTargetPool");
+  auto texture = CreateGPUTexture(device_,                         //
+                                  glm::ivec3{descriptor.size, 1},  //
+                                  SDL_GPU_TEXTURETYPE_2D,          //
+                                  descriptor.format,               //
+                                  descriptor.usage,                //
+                                  descriptor.mip_levels,           //
+                                  descriptor.sample_count          //
+  );
+  if (!texture.IsValid()) {
+    return {};
+  }
+  std::scoped_lock lock(mutex_);
+  stats_.texture_count++;
+  stats_.bytes += texture.GetSize();
+  stats_.allocations++;
+  return PooledTexture{this, descriptor, std::move(texture)};
+}
+
+void RenderTargetPool::Return(const RenderTargetDescriptor& descriptor,
+                              GPUTexture texture) {
+  std::scoped_lock lock(mutex_);
+  free_textures_.push_back(FreeTexture{
+      .descriptor = descriptor,
+      .texture = std::move(texture),
+      .returned_frame = frame_,
+  });
+  stats_.free_count++;
+}
+
+size_t RenderTargetPool::Collect() {
+  std::scoped_lock lock(mutex_);
+  frame_++;
+  const auto released = std::erase_if(free_textures_, [&](const auto& free) {
+    if (frame_ - free.returned_frame <= kMaxIdleFrames) {
+      return false;
+    }
+    stats_.bytes -= free.texture.GetSize();
+    return true;
+  });
+  stats_.texture_count -= released;
+  stats_.free_count -= released;
+  stats_.releases += released;
+  return released;
+}
+
+RenderTargetPool::Stats RenderTargetPool::GetStats() const {
+  std::scoped_lock lock(mutex_);
+  return stats_;
+}
+
+}  // namespace ts
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <vector>
+#include "buffer.h"
+#include "sdl_types.h"
+
+namespace ts {
+
+class RenderTargetPool;
+
+struct RenderTargetDescriptor {
+  glm::ivec2 size = {};
+  SDL_GPUTextureFormat format = SDL_GPU_TEXTUREFORMAT_INVALID;
+  SDL_GPUTextureUsageFlags usage = 0u;
+  Uint32 mip_levels = 1u;
+  SDL_GPUSampleCount sample_count = SDL_GPU_SAMPLECOUNT_1;
+
+  bool operator==(const RenderTargetDescriptor& other) const = default;
+};
+
+// A texture of a render target pool. Given back to the pool when destroyed.
+class PooledTexture {
+ public:
+  PooledTexture();
+
+  PooledTexture(RenderTargetPool* pool,
+                RenderTargetDescriptor descriptor,
+                GPUTexture texture);
+
+  ~PooledTexture();
+
+  PooledTexture(PooledTexture&& other);
+
+  PooledTexture& operator=(PooledTexture&& other);
+
+  bool IsValid() const;
+
+  SDL_GPUTexture* Get() const;
+
+  const RenderTargetDescriptor& GetDescriptor() const;
+
+  // An estimate of the device memory the texture occupies.
+  size_t GetSize() const;
+
+ private:
+  RenderTargetPool* pool_ = nullptr;
+  RenderTargetDescriptor descriptor_;
+  GPUTexture texture_;
+
+  void Reset();
+};
+
+// Recycles textures that are rendered to and sampled within a frame, like
+// scene targets and depth pyramids, so that switching between a few sizes
+// doesn't allocate. Textures given back are kept for a while in case a
+// texture like them is asked for again. Safe to use from any thread.
+class RenderTargetPool {
+ public:
+  struct Stats {
+    // Textures handed out and waiting in the pool.
+    size_t texture_count = 0u;
+    size_t free_count = 0u;
+    size_t bytes = 0u;
+    size_t reuses = 0u;
+    size_t allocations = 0u;
+    size_t releases = 0u;
+  };
+
+  explicit RenderTargetPool(SDL_GPUDevice* device);
+
+  ~RenderTargetPool();
+
+  // Hands out a free texture matching the descriptor or creates one.
+  PooledTexture Acquire(const RenderTargetDescriptor& descriptor);
+
+  // Releases the free textures that weren't asked for in a number of calls.
+  // Called once a frame. Returns the number of textures released.
+  size_t Collect();
+
+  Stats GetStats() const;
+
+ private:
+  friend class PooledTexture;
+
+  struct FreeTexture {
+    RenderTargetDescriptor descriptor;
+    GPUTexture texture;
+    size_t returned_frame = 0u;
+  };
+  SDL_GPUDevice* device_ = nullptr;
+  mutable std::mutex mutex_;
+  std::vector<FreeTexture> free_textures_;
+  size_t frame_ = 0u;
+  Stats stats_;
+
+  void Return(const RenderTargetDescriptor& descriptor, GPUTexture texture);
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(RenderTargetPool);
+};
+
+}  // namespace ts
@@ -1,12 +1,20 @@
 #include "renderer.h"
 
 #include <fml/closure.h>
+#include <algorithm>
 #include "backends/imgui_impl_sdl3.h"
 #include "backends/imgui_impl_sdlgpu3.h"
 #include "drawable/compute.h"
 #include "drawable/model_renderer.h"
+#include "drawable/particles.h"
 #include "drawable/triangle.h"
+#include "frame_counters.h"
+#include "gpu_memory.h"
+#include "graphics_pipeline.h"
 #include "imgui.h"
+#include "profiler.h"
+#include "shader.h"
+#include "upscale.slang.reflection.h"
 
 namespace ts {
 
@@ -15,35 +23,156 @@ Renderer::Renderer(std::shared_ptr<Context> context)
   drawables_.emplace_back(std::make_unique<Compute>(*context_));
   drawables_.emplace_back(std::make_unique<Triangle>(*context_));
   drawables_.emplace_back(std::make_unique<ModelRenderer>(context_));
+  // Last since the particles are blended over everything else.
+  drawables_.emplace_back(std::make_unique<Particles>(*context_));
 
   StartupIMGUI();
 }
 
+Renderer::Renderer(std::shared_ptr<Context> context,
+                   std::vector<std::unique_ptr<Drawable>> drawables)
+    : context_(std::move(context)), drawables_(std::move(drawables)) {
+  StartupIMGUI();
+}
+
 Renderer::~Renderer() {
   ShutdownIMGUI();
   SDL_WaitForGPUIdle(context_->GetDevice().get());
 }
 
 bool Renderer::Render() {
+  // Collected before the frame zone is opened so that the flame view shows
+  // whole frames.
+  Profiler::GetInstance().CollectFrame();
+  TS_PROFILE_SCOPE("Renderer::Render");
+  TS_GPU_MEMORY_OWNER("Renderer");
+  ReloadShadersIfNecessary();
+  AdvanceTime();
+  if (dynamic_resolution_) {
+    resolution_scaler_.Update(frame_ms_);
+  }
+  context_->GetRenderTargetPool().Collect();
   BeginIMGUIFrame();
-  if (auto texture = RenderOnce()) {
-    EndIMGUIFrame(texture);
+  Profiler::GetInstance().DrawFlameView();
+  GPUMemoryTracker::GetInstance().DrawPanel();
+  DrawViewportUI();
+  const auto texture = RenderOnce();
+  if (context_->IsHeadless() || !texture.has_value() || !texture.value()) {
+    // The UI is not composited into offscreen frames so captures only contain
+    // the scene. Frames that weren't rendered still end the UI frame so that
+    // the next one may begin.
+    ImGui::EndFrame();
+  } else {
+    EndIMGUIFrame(texture.value());
   }
-  return true;
+  // Frames skipped for want of a swapchain texture aren't failures.
+  return texture.has_value();
+}
+
+void Renderer::ReloadShadersIfNecessary() {
+  TS_PROFILE_SCOPE("Renderer::ReloadShadersIfNecessary");
+  if (!context_->GetShaderLibrary().ApplyPendingReloads()) {
+    return;
+  }
+  for (const auto& drawable : drawables_) {
+    if (!drawable->ReloadShaders(*context_)) {
+      FML_LOG(ERROR) << "Could not reload shaders. Keeping previous pipelines.";
+    }
+  }
+  // Rebuilt from the new blobs on next use.
+  upscale_pipeline_ = nullptr;
+  // Drop the pipelines and shaders built from the previous blobs.
+  context_->GetPipelineCache().Collect();
+}
+
+std::optional<HostTexture> Renderer::CaptureFrame() const {
+  return CaptureFrameAsync().Take();
+}
+
+TextureReadback Renderer::CaptureFrameAsync() const {
+  if (!context_->IsHeadless()) {
+    FML_LOG(ERROR) << "Only headless frames may be captured.";
+    return {};
+  }
+  return PerformDeviceToHostTransferTexture2DAsync(offscreen_texture_);
+}
+
+Camera& Renderer::GetCamera() {
+  return camera_;
+}
+
+void Renderer::SetParallelPrepare(bool parallel) {
+  parallel_prepare_ = parallel;
+}
+
+void Renderer::SetDynamicResolution(bool dynamic) {
+  if (dynamic_resolution_ != dynamic) {
+    resolution_scaler_.Reset();
+  }
+  dynamic_resolution_ = dynamic;
+}
+
+void Renderer::DrawViewportUI() {
+  constexpr size_t kMiB = 1u << 20u;
+  ImGui::Begin("Viewport");
+  ImGui::SliderFloat("FOV", &camera_.fov, 10, 180);
+  ImGui::SliderFloat3("Eye", reinterpret_cast<float*>(&camera_.eye), -10, 10);
+  auto dynamic_resolution = dynamic_resolution_;
+  if (ImGui::Checkbox("Dynamic Resolution", &dynamic_resolution)) {
+    SetDynamicResolution(dynamic_resolution);
+  }
+  auto budget = resolution_scaler_.GetSettings().budget_ms;
+  if (ImGui::SliderFloat("Frame Budget (ms)", &budget, 4.0f, 50.0f)) {
+    resolution_scaler_.SetBudget(budget);
+  }
+  ImGui::Text("Render scale %.0f%%, frame %.2f ms",
+              (dynamic_resolution_ ? resolution_scaler_.GetScale() : 1.0f) *
+                  100.0f,
+              frame_ms_);
+  const auto pool = context_->GetRenderTargetPool().GetStats();
+  ImGui::Text("Render targets %zu (%zu free) in %.1f MiB", pool.texture_count,
+              pool.free_count, static_cast<float>(pool.bytes) / kMiB);
+  ImGui::End();
+}
+
+void Renderer::AdvanceTime() {
+  if (context_->IsHeadless()) {
+    // Matches the delta time given to ImGui for headless frames.
+    time_ += 1.0f / 60.0f;
+    frame_ms_ = 1000.0f / 60.0f;
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  if (last_frame_.has_value()) {
+    const auto delta =
+        std::chrono::duration<float>(now - last_frame_.value()).count();
+    time_ += delta;
+    frame_ms_ = delta * 1000.0f;
+  }
+  last_frame_ = now;
 }
 
 void Renderer::BeginIMGUIFrame() {
   ImGui_ImplSDLGPU3_NewFrame();
-  ImGui_ImplSDL3_NewFrame();
+  if (context_->IsHeadless()) {
+    const auto size = context_->GetOffscreenSize();
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(size.x, size.y);
+    io.DeltaTime = 1.0f / 60.0f;
+  } else {
+    ImGui_ImplSDL3_NewFrame();
+  }
   ImGui::NewFrame();
 }
 
 void Renderer::EndIMGUIFrame(SDL_GPUTexture* texture) {
+  TS_PROFILE_SCOPE("Renderer::EndIMGUIFrame");
   ImGui::Render();
 
   auto command_buffer =
       SDL_AcquireGPUCommandBuffer(context_->GetDevice().get());
   FML_DEFER(SDL_SubmitGPUCommandBuffer(command_buffer));
+  CountSubmission();
 
   SDL_PushGPUDebugGroup(command_buffer, "IMGUI");
   FML_DEFER(SDL_PopGPUDebugGroup(command_buffer));
@@ -73,110 +202,284 @@ void Renderer::StartupIMGUI() {
       .Device = context_->GetDevice().get(),
       .ColorTargetFormat = context_->GetColorFormat(),
   };
-  FML_CHECK(ImGui_ImplSDL3_InitForSDLGPU(context_->GetWindow().get()));
+  if (!context_->IsHeadless()) {
+    FML_CHECK(ImGui_ImplSDL3_InitForSDLGPU(context_->GetWindow().get()));
+  }
   FML_CHECK(ImGui_ImplSDLGPU3_Init(&info));
 }
 
 void Renderer::ShutdownIMGUI() {
-  ImGui_ImplSDL3_Shutdown();
+  if (!context_->IsHeadless()) {
+    ImGui_ImplSDL3_Shutdown();
+  }
   ImGui_ImplSDLGPU3_Shutdown();
   ImGui::DestroyContext();
 }
 
-SDL_GPUTexture* Renderer::RenderOnce() {
+SDL_GPUTexture* Renderer::AcquireOffscreenTexture() {
+  const auto size = context_->GetOffscreenSize();
+  if (offscreen_texture_.IsValid()) {
+    return offscreen_texture_.texture.get().value;
+  }
+  offscreen_texture_ = CreateGPUTexture(
+      context_->GetDevice().get(),                                      //
+      {size.x, size.y, 1u},                                             //
+      SDL_GPU_TEXTURETYPE_2D,                                           //
+      context_->GetColorFormat(),                                       //
+      SDL_GPU_TEXTUREUSAGE_COLOR_TARGET | SDL_GPU_TEXTUREUSAGE_SAMPLER  //
+  );
+  if (!offscreen_texture_.IsValid()) {
+    return NULL;
+  }
+  return offscreen_texture_.texture.get().value;
+}
+
+std::optional<SDL_GPUTexture*> Renderer::RenderOnce() {
+  TS_PROFILE_SCOPE("Renderer::RenderOnce");
   const auto& device = context_->GetDevice();
   auto command_buffer = SDL_AcquireGPUCommandBuffer(device.get());
   if (!command_buffer) {
     FML_LOG(ERROR) << "Could not get command buffer: " << SDL_GetError();
-    return NULL;
+    return std::nullopt;
   }
   FML_DEFER(SDL_SubmitGPUCommandBuffer(command_buffer));
+  CountSubmission();
   SDL_GPUTexture* swapchain_image = nullptr;
   Uint32 texture_width = 0u;
   Uint32 texture_height = 0u;
-  if (!SDL_WaitAndAcquireGPUSwapchainTexture(command_buffer,               //
-                                             context_->GetWindow().get(),  //
-                                             &swapchain_image,             //
-                                             &texture_width,               //
-                                             &texture_height               //
-                                             )) {
-    FML_LOG(ERROR) << "Could not acquire swapchain image: " << SDL_GetError();
-    return NULL;
+  if (context_->IsHeadless()) {
+    swapchain_image = AcquireOffscreenTexture();
+    if (swapchain_image == NULL) {
+      FML_LOG(ERROR) << "Could not create offscreen texture.";
+      return std::nullopt;
+    }
+    texture_width = context_->GetOffscreenSize().x;
+    texture_height = context_->GetOffscreenSize().y;
+  } else {
+    if (!SDL_WaitAndAcquireGPUSwapchainTexture(command_buffer,               //
+                                               context_->GetWindow().get(),  //
+                                               &swapchain_image,             //
+                                               &texture_width,               //
+                                               &texture_height               //
+                                               )) {
+      FML_LOG(ERROR) << "Could not acquire swapchain image: "
+                     << SDL_GetError();
+      return std::nullopt;
+    }
+    if (swapchain_image == NULL) {
+      // There is nothing to present to, like when the window is minimized.
+      // Skip the frame.
+      return nullptr;
+    }
   }
-  if (swapchain_image == NULL) {
-    // The wait completed with failure.
-    FML_LOG(ERROR) << "Acquired swapchain texture was invalid.";
-    return NULL;
+
+  const auto output_size = glm::ivec2{texture_width, texture_height};
+  const auto render_size = dynamic_resolution_
+                               ? resolution_scaler_.GetRenderSize(output_size)
+                               : output_size;
+  const auto is_scaled = render_size != output_size;
+
+  DrawContext context = {
+      .viewport = render_size,
+      .camera = camera_,
+      .time = time_,
+  };
+  if (!PrepareDrawables(context)) {
+    return std::nullopt;
   }
 
   const auto texture_format = context_->GetColorFormat();
 
-  auto color_texture = CreateGPUTexture(device.get(),                         //
-                                        {texture_width, texture_height, 1u},  //
-                                        SDL_GPU_TEXTURETYPE_2D,               //
-                                        texture_format,                       //
-                                        SDL_GPU_TEXTUREUSAGE_COLOR_TARGET,    //
-                                        1u,                                   //
-                                        context_->GetColorSamples()           //
-  );
+  // Pooled so that the targets of the few scales in use are reused instead of
+  // being allocated every frame.
+  auto& pool = context_->GetRenderTargetPool();
+  auto color_texture = pool.Acquire(RenderTargetDescriptor{
+      .size = render_size,
+      .format = texture_format,
+      .usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET,
+      .sample_count = context_->GetColorSamples(),
+  });
+  auto depth_texture = pool.Acquire(RenderTargetDescriptor{
+      .size = render_size,
+      .format = context_->GetDepthFormat(),
+      .usage = SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET,
+      .sample_count = context_->GetColorSamples(),
+  });
+  // Scaled frames are resolved into a texture the upscale samples from.
+  PooledTexture scene_texture;
+  if (is_scaled) {
+    scene_texture = pool.Acquire(RenderTargetDescriptor{
+        .size = render_size,
+        .format = texture_format,
+        .usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET |
+                 SDL_GPU_TEXTUREUSAGE_SAMPLER,
+    });
+  }
 
-  auto depth_texture =
-      CreateGPUTexture(device.get(),                               //
-                       {texture_width, texture_height, 1u},        //
-                       SDL_GPU_TEXTURETYPE_2D,                     //
-                       context_->GetDepthFormat(),                 //
-                       SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET,  //
-                       1u,                                         //
-                       context_->GetColorSamples()                 //
-      );
-
-  if (!color_texture.IsValid() || !depth_texture.IsValid()) {
-    return NULL;
+  if (!color_texture.IsValid() || !depth_texture.IsValid() ||
+      (is_scaled && !scene_texture.IsValid())) {
+    return std::nullopt;
   }
 
   const auto color_info = SDL_GPUColorTargetInfo{
-      .texture = color_texture.texture.get().value,
-      .resolve_texture = swapchain_image,
+      .texture = color_texture.Get(),
+      .resolve_texture = is_scaled ? scene_texture.Get() : swapchain_image,
       .clear_color = {1.0f, 0.0f, 1.0f, 1.0f},
       .load_op = SDL_GPU_LOADOP_CLEAR,
       .store_op = SDL_GPU_STOREOP_RESOLVE,
+      // Pooled targets may still be in use by the previous frame.
+      .cycle = true,
+      .cycle_resolve_texture = is_scaled,
   };
 
   const auto depth_stencil_info = SDL_GPUDepthStencilTargetInfo{
-      .texture = depth_texture.texture.get().value,
+      .texture = depth_texture.Get(),
       .clear_depth = 0.0f,
       .load_op = SDL_GPU_LOADOP_CLEAR,
       .store_op = SDL_GPU_STOREOP_DONT_CARE,
       .stencil_load_op = SDL_GPU_LOADOP_CLEAR,
       .stencil_store_op = SDL_GPU_STOREOP_DONT_CARE,
+      .cycle = true,
       .clear_stencil = 0,
   };
 
-  auto render_pass = SDL_BeginGPURenderPass(command_buffer,      //
-                                            &color_info,         //
-                                            1,                   //
-                                            &depth_stencil_info  //
-  );
+  {
+    auto render_pass = SDL_BeginGPURenderPass(command_buffer,      //
+                                              &color_info,         //
+                                              1,                   //
+                                              &depth_stencil_info  //
+    );
+
+    if (!render_pass) {
+      FML_LOG(ERROR) << "Could not begin render pass: " << SDL_GetError();
+      return std::nullopt;
+    }
+    FML_DEFER(SDL_EndGPURenderPass(render_pass));
+
+    context.command_buffer = command_buffer;
+    context.pass = render_pass;
+
+    for (auto& drawable : drawables_) {
+      if (!drawable->Draw(context)) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  if (is_scaled &&
+      !Upscale(command_buffer, scene_texture.Get(), swapchain_image)) {
+    return std::nullopt;
+  }
+
+  return swapchain_image;
+}
 
+bool Renderer::BuildUpscalePipeline() {
+  auto code = context_->GetShaderLibrary().GetBlob("upscale");
+  if (!code) {
+    return false;
+  }
+  const auto& device = context_->GetDevice();
+  auto& cache = context_->GetPipelineCache();
+  auto vs = ShaderBuilder{}
+                .SetCode(code.get())
+                .SetReflection(shaders::upscale::kUpscaleVertexMain)
+                .Build(device, cache);
+  auto fs = ShaderBuilder{}
+                .SetCode(code.get())
+                .SetReflection(shaders::upscale::kUpscaleFragmentMain)
+                .Build(device, cache);
+  if (!vs || !fs) {
+    return false;
+  }
+  upscale_pipeline_ =
+      GraphicsPipelineBuilder{}
+          .SetColorTargets({
+              SDL_GPUColorTargetDescription{
+                  .format = context_->GetColorFormat(),
+              },
+          })
+          .SetVertexShader(vs.get())
+          .SetFragmentShader(fs.get())
+          .SetPrimitiveType(SDL_GPU_PRIMITIVETYPE_TRIANGLELIST)
+          .Build(device, cache);
+  if (!upscale_sampler_.is_valid()) {
+    upscale_sampler_ = CreateSampler(
+        device.get(),
+        SDL_GPUSamplerCreateInfo{
+            .min_filter = SDL_GPU_FILTER_LINEAR,
+            .mag_filter = SDL_GPU_FILTER_LINEAR,
+            .mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_NEAREST,
+            .address_mode_u = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+            .address_mode_v = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE,
+        });
+  }
+  return upscale_pipeline_ && upscale_sampler_.is_valid();
+}
+
+bool Renderer::Upscale(SDL_GPUCommandBuffer* command_buffer,
+                       SDL_GPUTexture* scene,
+                       SDL_GPUTexture* output) {
+  TS_PROFILE_SCOPE("Renderer::Upscale");
+  if ((!upscale_pipeline_ || !upscale_sampler_.is_valid()) &&
+      !BuildUpscalePipeline()) {
+    FML_LOG(ERROR) << "Could not build upscale pipeline.";
+    return false;
+  }
+
+  SDL_PushGPUDebugGroup(command_buffer, "Upscale");
+  FML_DEFER(SDL_PopGPUDebugGroup(command_buffer));
+
+  // Every pixel is overwritten.
+  const auto color_info = SDL_GPUColorTargetInfo{
+      .texture = output,
+      .load_op = SDL_GPU_LOADOP_DONT_CARE,
+      .store_op = SDL_GPU_STOREOP_STORE,
+  };
+  auto render_pass =
+      SDL_BeginGPURenderPass(command_buffer, &color_info, 1u, nullptr);
   if (!render_pass) {
     FML_LOG(ERROR) << "Could not begin render pass: " << SDL_GetError();
-    return NULL;
+    return false;
   }
   FML_DEFER(SDL_EndGPURenderPass(render_pass));
-
-  DrawContext context = {
-      .command_buffer = command_buffer,
-      .pass = render_pass,
-      .viewport = {texture_width, texture_height},
+  SDL_BindGPUGraphicsPipeline(render_pass, upscale_pipeline_->get().value);
+  CountPipelineBind();
+  const auto binding = SDL_GPUTextureSamplerBinding{
+      .texture = scene,
+      .sampler = upscale_sampler_.get().value,
   };
+  SDL_BindGPUFragmentSamplers(render_pass, 0u, &binding, 1u);
+  CountSamplerBind();
+  SDL_DrawGPUPrimitives(render_pass, 3u, 1u, 0u, 0u);
+  CountDraw();
+  return true;
+}
 
-  for (auto& drawable : drawables_) {
-    if (!drawable->Draw(context)) {
-      return NULL;
+bool Renderer::PrepareDrawables(const DrawContext& context) {
+  TS_PROFILE_SCOPE("Renderer::PrepareDrawables");
+  if (!parallel_prepare_) {
+    for (auto& drawable : drawables_) {
+      if (!drawable->Prepare(context)) {
+        return false;
+      }
     }
+    return true;
   }
-
-  return swapchain_image;
+  auto& jobs = context_->GetJobSystem();
+  // Not a std::vector<bool> since elements are written from different
+  // threads.
+  std::vector<uint8_t> prepared(drawables_.size(), false);
+  JobCounter counter;
+  for (size_t i = 0; i < drawables_.size(); i++) {
+    jobs.Run(
+        [&, i]() {
+          prepared[i] = drawables_[i]->Prepare(context);
+        },
+        counter);
+  }
+  jobs.Wait(counter);
+  return std::ranges::all_of(prepared, [](auto ok) { return ok; });
 }
 
 }  // namespace ts
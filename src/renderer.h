@@ -1,8 +1,12 @@
 #pragma once
 
 #include <fml/logging.h>
+#include <chrono>
+#include <optional>
+#include "buffer.h"
 #include "context.h"
 #include "drawable.h"
+#include "resolution_scaler.h"
 
 namespace ts {
 
@@ -10,13 +14,49 @@ class Renderer {
  public:
   Renderer(std::shared_ptr<Context> context);
 
+  // Renders only the given drawables instead of the default scene.
+  Renderer(std::shared_ptr<Context> context,
+           std::vector<std::unique_ptr<Drawable>> drawables);
+
   ~Renderer();
 
+  // Returns false if the frame could not be rendered.
   bool Render();
 
+  // Reads back the last frame rendered into the offscreen texture. Only
+  // headless contexts render offscreen.
+  std::optional<HostTexture> CaptureFrame() const;
+
+  // Like CaptureFrame but returns as soon as the copy is submitted.
+  TextureReadback CaptureFrameAsync() const;
+
+  // The camera used for subsequent frames. Also edited in the Viewport
+  // window.
+  Camera& GetCamera();
+
+  // Prepares drawables concurrently on the job system of the context. Commands
+  // are still encoded on the calling thread in order.
+  void SetParallelPrepare(bool parallel);
+
+  // Renders the scene at a scale picked each frame to fit the frame budget
+  // and upscales it into the swapchain image. Also toggled in the Viewport
+  // window.
+  void SetDynamicResolution(bool dynamic);
+
  private:
   std::shared_ptr<Context> context_;
   std::vector<std::unique_ptr<Drawable>> drawables_;
+  GPUTexture offscreen_texture_;
+  Camera camera_;
+  bool parallel_prepare_ = false;
+  bool dynamic_resolution_ = false;
+  ResolutionScaler resolution_scaler_;
+  SharedGPUGraphicsPipeline upscale_pipeline_;
+  UniqueGPUSampler upscale_sampler_;
+  float time_ = 0.0f;
+  // The time the last frame took.
+  float frame_ms_ = 0.0f;
+  std::optional<std::chrono::steady_clock::time_point> last_frame_;
 
   void StartupIMGUI();
 
@@ -26,7 +66,26 @@ class Renderer {
 
   void EndIMGUIFrame(SDL_GPUTexture* texture);
 
-  SDL_GPUTexture* RenderOnce();
+  void DrawViewportUI();
+
+  void AdvanceTime();
+
+  SDL_GPUTexture* AcquireOffscreenTexture();
+
+  // Null if there was nothing to render into this frame and nullopt if the
+  // frame failed.
+  std::optional<SDL_GPUTexture*> RenderOnce();
+
+  bool PrepareDrawables(const DrawContext& context);
+
+  bool BuildUpscalePipeline();
+
+  // Draws the scene texture stretched over the output texture.
+  bool Upscale(SDL_GPUCommandBuffer* command_buffer,
+               SDL_GPUTexture* scene,
+               SDL_GPUTexture* output);
+
+  void ReloadShadersIfNecessary();
 
   FML_DISALLOW_COPY_ASSIGN_AND_MOVE(Renderer);
 };
@@ -0,0 +1,118 @@
+#include "resolution_scaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ts {
+
+// The weight of the latest frame in the average frame time.
+static constexpr float kSmoothing = 0.1f;
+
+// The band around the budget within which the scale is kept.
+static constexpr float kOverBudget = 1.05f;
+static constexpr float kUnderBudget = 0.85f;
+
+// Frames rendered at a new scale before it is judged. The first few may also
+// pay for allocating targets of a size not seen before.
+static constexpr int kSettleFrames = 10;
+
+static constexpr int kMinProbeFrames = 120;
+static constexpr int kMaxProbeFrames = 960;
+
+ResolutionScaler::ResolutionScaler() : ResolutionScaler(Settings{}) {}
+
+ResolutionScaler::ResolutionScaler(Settings settings) : settings_(settings) {
+  settings_.step = std::max(settings_.step, 1e-3f);
+  settings_.min_scale = std::clamp(settings_.min_scale, settings_.step, 1.0f);
+  settings_.max_scale =
+      std::clamp(settings_.max_scale, settings_.min_scale, 1.0f);
+  Reset();
+}
+
+ResolutionScaler::~ResolutionScaler() = default;
+
+const ResolutionScaler::Settings& ResolutionScaler::GetSettings() const {
+  return settings_;
+}
+
+void ResolutionScaler::SetBudget(float budget_ms) {
+  settings_.budget_ms = std::max(budget_ms, 1.0f);
+  probe_frames_ = kMinProbeFrames;
+}
+
+float ResolutionScaler::GetScale() const {
+  return scale_;
+}
+
+float ResolutionScaler::GetAverageFrameTime() const {
+  return average_ms_;
+}
+
+glm::ivec2 ResolutionScaler::GetRenderSize(glm::ivec2 output_size) const {
+  return glm::max(glm::ivec2{glm::round(glm::vec2{output_size} * scale_)},
+                  glm::ivec2{1});
+}
+
+void ResolutionScaler::Reset() {
+  scale_ = settings_.max_scale;
+  average_ms_ = 0.0f;
+  frames_at_scale_ = 0;
+  probe_frames_ = kMinProbeFrames;
+  is_probing_ = false;
+}
+
+float ResolutionScaler::Quantize(float scale) const {
+  // Nudged so that scales already on a step stay there.
+  const auto quantized =
+      std::floor(scale / settings_.step + 1e-3f) * settings_.step;
+  return std::clamp(quantized, settings_.min_scale, settings_.max_scale);
+}
+
+void ResolutionScaler::SetScale(float scale, bool is_probe) {
+  if (scale == scale_) {
+    return;
+  }
+  scale_ = scale;
+  // Frames at the previous scale say little about this one.
+  average_ms_ = 0.0f;
+  frames_at_scale_ = 0;
+  is_probing_ = is_probe;
+}
+
+float ResolutionScaler::Update(float frame_ms) {
+  if (!(frame_ms > 0.0f)) {
+    return scale_;
+  }
+  average_ms_ = frames_at_scale_ == 0
+                    ? frame_ms
+                    : average_ms_ + (frame_ms - average_ms_) * kSmoothing;
+  frames_at_scale_++;
+  if (frames_at_scale_ < kSettleFrames) {
+    return scale_;
+  }
+
+  const auto budget = settings_.budget_ms;
+  if (average_ms_ > budget * kOverBudget) {
+    // Frames that miss vsync take twice as long. So a failed probe goes back
+    // to the scale it started from instead of the one predicted.
+    if (is_probing_) {
+      probe_frames_ = std::min(probe_frames_ * 2, kMaxProbeFrames);
+      SetScale(Quantize(scale_ - settings_.step), false);
+      return scale_;
+    }
+    const auto predicted = scale_ * std::sqrt(budget / average_ms_);
+    SetScale(Quantize(std::min(predicted, scale_ - settings_.step)), false);
+    return scale_;
+  }
+  // A probe that settled within the budget paid off.
+  is_probing_ = false;
+  if (average_ms_ < budget * kUnderBudget) {
+    probe_frames_ = kMinProbeFrames;
+    SetScale(Quantize(scale_ + settings_.step), false);
+  } else if (frames_at_scale_ >= probe_frames_) {
+    SetScale(Quantize(scale_ + settings_.step), true);
+  }
+  return scale_;
+}
+
+}  // namespace ts
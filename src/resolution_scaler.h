@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace ts {
+
+// Picks the scale the scene is rendered at so that frames fit a time budget.
+// The cost of a frame is taken to scale with its pixel count. Frames over the
+// budget drop straight to the scale predicted to fit while frames with
+// headroom raise it a step at a time.
+//
+// Frames paced by vsync never take less than the refresh interval and so never
+// show headroom. After a while within the budget a step up is probed. If that
+// overshoots, the wait before the next probe doubles.
+//
+// Scales are multiples of a step so that render targets of only a few sizes
+// are ever asked for.
+class ResolutionScaler {
+ public:
+  struct Settings {
+    float budget_ms = 1000.0f / 60.0f;
+    float min_scale = 0.5f;
+    float max_scale = 1.0f;
+    float step = 1.0f / 16.0f;
+  };
+
+  ResolutionScaler();
+
+  explicit ResolutionScaler(Settings settings);
+
+  ~ResolutionScaler();
+
+  const Settings& GetSettings() const;
+
+  void SetBudget(float budget_ms);
+
+  // Feeds the time the last frame took. Returns the scale of the next one.
+  float Update(float frame_ms);
+
+  float GetScale() const;
+
+  // The frame time averaged over recent frames at the current scale.
+  float GetAverageFrameTime() const;
+
+  // The output size scaled. Never empty.
+  glm::ivec2 GetRenderSize(glm::ivec2 output_size) const;
+
+  // Goes back to the largest scale and forgets past frames.
+  void Reset();
+
+ private:
+  Settings settings_;
+  float scale_ = 1.0f;
+  float average_ms_ = 0.0f;
+  int frames_at_scale_ = 0;
+  int probe_frames_ = 0;
+  // Whether the last change was a probe.
+  bool is_probing_ = false;
+
+  float Quantize(float scale) const;
+
+  void SetScale(float scale, bool is_probe);
+};
+
+}  // namespace ts
@@ -11,6 +11,8 @@ UniqueGPUSampler CreateSampler(SDL_GPUDevice* device,
     FML_LOG(ERROR) << "Could not create sampler: " << SDL_GetError();
     return {};
   }
+  GPUMemoryTracker::GetInstance().TrackCreation(GPUResourceCategory::kSampler,
+                                                sampler);
   UniqueGPUSampler ::element_type res = {};
   res.device = device;
   res.value = sampler;
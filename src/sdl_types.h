@@ -2,6 +2,7 @@
 
 #include <SDL3/SDL_gpu.h>
 #include <fml/unique_object.h>
+#include "gpu_memory.h"
 
 namespace ts {
 
@@ -54,41 +55,62 @@ inline void FreeSDLType(SDL_Window* window) {
 template <>
 inline void FreeSDLTypeWithDevice(
     const GPUDevicePair<SDL_GPUGraphicsPipeline>& value) {
+  GPUMemoryTracker::GetInstance().TrackRelease(
+      GPUResourceCategory::kGraphicsPipeline, value.value);
   SDL_ReleaseGPUGraphicsPipeline(value.device, value.value);
 }
 
 template <>
 inline void FreeSDLTypeWithDevice(
     const GPUDevicePair<SDL_GPUComputePipeline>& value) {
+  GPUMemoryTracker::GetInstance().TrackRelease(
+      GPUResourceCategory::kComputePipeline, value.value);
   SDL_ReleaseGPUComputePipeline(value.device, value.value);
 }
 
 template <>
 inline void FreeSDLTypeWithDevice(const GPUDevicePair<SDL_GPUShader>& value) {
+  GPUMemoryTracker::GetInstance().TrackRelease(
+      GPUResourceCategory::kShader, value.value);
   SDL_ReleaseGPUShader(value.device, value.value);
 }
 
 template <>
 inline void FreeSDLTypeWithDevice(
     const GPUDevicePair<SDL_GPUTransferBuffer>& value) {
+  GPUMemoryTracker::GetInstance().TrackRelease(
+      GPUResourceCategory::kTransferBuffer, value.value);
   SDL_ReleaseGPUTransferBuffer(value.device, value.value);
 }
 
 template <>
 inline void FreeSDLTypeWithDevice(const GPUDevicePair<SDL_GPUBuffer>& value) {
+  GPUMemoryTracker::GetInstance().TrackRelease(
+      GPUResourceCategory::kBuffer, value.value);
   SDL_ReleaseGPUBuffer(value.device, value.value);
 }
 
 template <>
 inline void FreeSDLTypeWithDevice(const GPUDevicePair<SDL_GPUTexture>& value) {
+  GPUMemoryTracker::GetInstance().TrackRelease(
+      GPUResourceCategory::kTexture, value.value);
   SDL_ReleaseGPUTexture(value.device, value.value);
 }
 
 template <>
 inline void FreeSDLTypeWithDevice(const GPUDevicePair<SDL_GPUSampler>& value) {
+  GPUMemoryTracker::GetInstance().TrackRelease(
+      GPUResourceCategory::kSampler, value.value);
   SDL_ReleaseGPUSampler(value.device, value.value);
 }
 
+template <>
+inline void FreeSDLTypeWithDevice(const GPUDevicePair<SDL_GPUFence>& value) {
+  GPUMemoryTracker::GetInstance().TrackRelease(
+      GPUResourceCategory::kFence, value.value);
+  SDL_ReleaseGPUFence(value.device, value.value);
+}
+
 template <class T>
 using UniqueGPUObject = fml::UniqueObject<T*, UniqueSDLTypeTraits<T>>;
 
@@ -108,6 +130,7 @@ using UniqueGPUTransferBuffer =
 using UniqueGPUBuffer = UniqueGPUObjectWithDevice<SDL_GPUBuffer>;
 using UniqueGPUTexture = UniqueGPUObjectWithDevice<SDL_GPUTexture>;
 using UniqueGPUSampler = UniqueGPUObjectWithDevice<SDL_GPUSampler>;
+using UniqueGPUFence = UniqueGPUObjectWithDevice<SDL_GPUFence>;
 
 UniqueGPUSampler CreateSampler(SDL_GPUDevice* device,
                                SDL_GPUSamplerCreateInfo info);
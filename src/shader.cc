@@ -11,6 +11,13 @@ ShaderBuilder& ShaderBuilder::SetCode(fml::Mapping* code,
                                       SDL_GPUShaderFormat format) {
   code_ = code;
   format_ = format;
+  blob_ = nullptr;
+  return *this;
+}
+
+ShaderBuilder& ShaderBuilder::SetCode(const ShaderBlob* blob) {
+  blob_ = blob;
+  code_ = nullptr;
   return *this;
 }
 
@@ -19,13 +26,30 @@ ShaderBuilder& ShaderBuilder::SetEntrypoint(std::string entrypoint) {
   return *this;
 }
 
-UniqueGPUShader ShaderBuilder::Build(const UniqueGPUDevice& device) const {
-  SDL_GPUShaderCreateInfo info = {};
+std::optional<ShaderCode> ShaderBuilder::ResolveCode(
+    const UniqueGPUDevice& device) const {
+  if (blob_) {
+    return blob_->PickCode(SDL_GetGPUShaderFormats(device.get()));
+  }
   if (code_) {
-    info.code = code_->GetMapping();
-    info.code_size = code_->GetSize();
+    return ShaderCode{
+        .format = format_,
+        .data = code_->GetMapping(),
+        .size = code_->GetSize(),
+    };
+  }
+  return ShaderCode{.format = format_};
+}
+
+UniqueGPUShader ShaderBuilder::Build(const UniqueGPUDevice& device) const {
+  auto code = ResolveCode(device);
+  if (!code.has_value()) {
+    return {};
   }
-  info.format = format_;
+  SDL_GPUShaderCreateInfo info = {};
+  info.code = code->data;
+  info.code_size = code->size;
+  info.format = code->format;
   info.stage = stage_;
   info.num_samplers = num_samplers_;
   info.num_storage_textures = num_storage_textures_;
@@ -41,9 +65,16 @@ UniqueGPUShader ShaderBuilder::Build(const UniqueGPUDevice& device) const {
     FML_LOG(ERROR) << "Could not create shader: " << SDL_GetError();
     return {};
   }
+  GPUMemoryTracker::GetInstance().TrackCreation(GPUResourceCategory::kShader,
+                                                shader.value);
   return UniqueGPUShader{shader};
 }
 
+SharedGPUShader ShaderBuilder::Build(const UniqueGPUDevice& device,
+                                     PipelineCache& cache) const {
+  return cache.GetShader(device, *this);
+}
+
 ShaderBuilder& ShaderBuilder::SetResourceCounts(Uint32 num_samplers,
                                                 Uint32 num_storage_textures,
                                                 Uint32 num_storage_buffers,
@@ -55,4 +86,18 @@ ShaderBuilder& ShaderBuilder::SetResourceCounts(Uint32 num_samplers,
   return *this;
 }
 
+ShaderBuilder& ShaderBuilder::SetReflection(
+    const EntryPointReflection& reflection) {
+  const auto stage = ToSDLShaderStage(reflection.stage);
+  FML_CHECK(stage.has_value())
+      << "Entrypoint " << reflection.name << " is not a graphics shader.";
+  return SetStage(stage.value())
+      .SetEntrypoint(reflection.name)
+      .SetResourceCounts(reflection.resources.num_samplers,         //
+                         reflection.resources.num_storage_textures,  //
+                         reflection.resources.num_storage_buffers,   //
+                         reflection.resources.num_uniform_buffers    //
+      );
+}
+
 }  // namespace ts
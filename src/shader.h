@@ -2,7 +2,10 @@
 
 #include <fml/macros.h>
 #include <fml/mapping.h>
+#include "pipeline_cache.h"
 #include "sdl_types.h"
+#include "shader_blob.h"
+#include "shader_reflection.h"
 
 namespace ts {
 
@@ -14,6 +17,10 @@ class ShaderBuilder {
 
   ShaderBuilder& SetCode(fml::Mapping* code, SDL_GPUShaderFormat format);
 
+  // The code for a format supported by the device is picked from the blob when
+  // the shader is built.
+  ShaderBuilder& SetCode(const ShaderBlob* blob);
+
   ShaderBuilder& SetEntrypoint(std::string entrypoint);
 
   ShaderBuilder& SetResourceCounts(Uint32 num_samplers,
@@ -21,18 +28,31 @@ class ShaderBuilder {
                                    Uint32 num_storage_buffers,
                                    Uint32 num_uniform_buffers);
 
+  // Sets the stage, entrypoint and resource counts.
+  ShaderBuilder& SetReflection(const EntryPointReflection& reflection);
+
   UniqueGPUShader Build(const UniqueGPUDevice& device) const;
 
+  // Returns a shared shader with the same code and configuration from the
+  // cache if there is one.
+  SharedGPUShader Build(const UniqueGPUDevice& device,
+                        PipelineCache& cache) const;
+
  private:
+  friend class PipelineCache;
+
   SDL_GPUShaderFormat format_ = SDL_GPU_SHADERFORMAT_MSL;
   SDL_GPUShaderStage stage_ = SDL_GPU_SHADERSTAGE_VERTEX;
   fml::Mapping* code_ = nullptr;
+  const ShaderBlob* blob_ = nullptr;
   std::string entrypoint_;
   Uint32 num_samplers_ = {};
   Uint32 num_storage_textures_ = {};
   Uint32 num_storage_buffers_ = {};
   Uint32 num_uniform_buffers_ = {};
 
+  std::optional<ShaderCode> ResolveCode(const UniqueGPUDevice& device) const;
+
   FML_DISALLOW_COPY_ASSIGN_AND_MOVE(ShaderBuilder);
 };
 
@@ -0,0 +1,127 @@
+#include "shader_benchmark.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include "drawable/compute.h"
+#include "drawable/model_renderer.h"
+#include "renderer.h"
+#include "statistics.h"
+
+namespace ts {
+
+#ifndef TS_SHADER_OPTIMIZATION_LEVEL
+#define TS_SHADER_OPTIMIZATION_LEVEL -1
+#endif  // TS_SHADER_OPTIMIZATION_LEVEL
+
+static constexpr int kWarmupFrames = 10;
+
+struct ShaderWorkload {
+  const char* name = nullptr;
+  std::function<std::unique_ptr<Drawable>(std::shared_ptr<Context>)> create;
+  // Called before every frame, e.g. to defeat caching so each frame does the
+  // measured work.
+  std::function<void(Drawable&)> before_frame;
+};
+
+static double ToMilliseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static void PrintSummary(const char* name, const SampleSummary& summary) {
+  std::cout << "\"" << name << "\":{"                     //
+            << "\"mean_ms\":" << summary.mean << ","      //
+            << "\"min_ms\":" << summary.min << ","        //
+            << "\"p50_ms\":" << summary.p50 << ","        //
+            << "\"p95_ms\":" << summary.p95 << ","        //
+            << "\"p99_ms\":" << summary.p99 << ","        //
+            << "\"max_ms\":" << summary.max << "}";
+}
+
+static bool RunWorkload(const std::shared_ptr<Context>& context,
+                        const ShaderWorkload& workload,
+                        int frames) {
+  std::vector<std::unique_ptr<Drawable>> drawables;
+  drawables.emplace_back(workload.create(context));
+  auto& drawable = *drawables.back();
+  Renderer renderer(context, std::move(drawables));
+  auto device = context->GetDevice().get();
+  const auto render = [&]() {
+    if (workload.before_frame) {
+      workload.before_frame(drawable);
+    }
+    return renderer.Render();
+  };
+
+  for (int i = 0; i < kWarmupFrames; i++) {
+    if (!render()) {
+      return false;
+    }
+  }
+  SDL_WaitForGPUIdle(device);
+
+  // SDL GPU exposes no timestamp queries. Each frame is waited upon so the
+  // frame time is the time taken to encode the frame and for the device to
+  // finish executing it.
+  std::vector<double> encode_times;
+  std::vector<double> frame_times;
+  encode_times.reserve(frames);
+  frame_times.reserve(frames);
+  for (int i = 0; i < frames; i++) {
+    const auto start = std::chrono::steady_clock::now();
+    if (!render()) {
+      return false;
+    }
+    const auto encoded = std::chrono::steady_clock::now();
+    SDL_WaitForGPUIdle(device);
+    const auto end = std::chrono::steady_clock::now();
+    encode_times.push_back(ToMilliseconds(encoded - start));
+    frame_times.push_back(ToMilliseconds(end - start));
+  }
+
+  std::cout << "{\"workload\":\"" << workload.name << "\","
+            << "\"shader_optimization_level\":"
+            << TS_SHADER_OPTIMIZATION_LEVEL << ","
+            << "\"driver\":\"" << SDL_GetGPUDeviceDriver(device) << "\","
+            << "\"frames\":" << frames << ",";
+  PrintSummary("encode", Summarize(std::move(encode_times)));
+  std::cout << ",";
+  PrintSummary("frame", Summarize(std::move(frame_times)));
+  std::cout << "}" << std::endl;
+  return true;
+}
+
+bool RunShaderBenchmark(const LaunchOptions& options) {
+  auto context = std::make_shared<Context>(options.size);
+  const ShaderWorkload workloads[] = {
+      {
+          .name = "model",
+          .create =
+              [](std::shared_ptr<Context> context) {
+                return std::make_unique<ModelRenderer>(std::move(context));
+              },
+      },
+      {
+          .name = "compute",
+          .create =
+              [](std::shared_ptr<Context> context) {
+                return std::make_unique<Compute>(*context);
+              },
+          // The output is cached while the viewport doesn't change. Dispatch
+          // every frame so that the compute shader is what gets measured.
+          .before_frame =
+              [](Drawable& drawable) {
+                static_cast<Compute&>(drawable).Invalidate();
+              },
+      },
+  };
+  for (const auto& workload : workloads) {
+    if (!RunWorkload(context, workload, options.benchmark_frames)) {
+      FML_LOG(ERROR) << "Could not run shader workload " << workload.name;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace ts
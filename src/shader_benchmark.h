@@ -0,0 +1,14 @@
+#pragma once
+
+#include "launch_options.h"
+
+namespace ts {
+
+// Renders the model and compute workloads headlessly and prints one JSON
+// object per workload with the frame times measured at the shader
+// optimization level this binary was built with. Compare the output of builds
+// configured with different TS_SHADER_OPTIMIZATION_LEVEL values (see `make
+// shader_bench`).
+bool RunShaderBenchmark(const LaunchOptions& options);
+
+}  // namespace ts
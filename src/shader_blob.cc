@@ -0,0 +1,124 @@
+#include "shader_blob.h"
+
+#include <fml/logging.h>
+
+namespace ts {
+
+static constexpr uint32_t kBlobMagic = 0x42535354;  // 'TSSB'
+static constexpr uint32_t kBlobVersion = 2u;
+// SPIR-V is consumed as 32-bit words so payloads are aligned to them.
+static constexpr size_t kPayloadAlignment = sizeof(uint32_t);
+
+static size_t AlignPayload(size_t offset) {
+  return (offset + kPayloadAlignment - 1u) / kPayloadAlignment *
+         kPayloadAlignment;
+}
+
+static uint32_t ReadLE32(const uint8_t* data) {
+  return static_cast<uint32_t>(data[0]) |
+         static_cast<uint32_t>(data[1]) << 8u |
+         static_cast<uint32_t>(data[2]) << 16u |
+         static_cast<uint32_t>(data[3]) << 24u;
+}
+
+static void WriteLE32(std::vector<uint8_t>& data, uint32_t value) {
+  for (uint32_t shift = 0u; shift < 32u; shift += 8u) {
+    data.push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+SDL_GPUShaderFormat PickPreferredShaderFormat(SDL_GPUShaderFormat formats) {
+  for (const auto format : {SDL_GPU_SHADERFORMAT_MSL,    //
+                            SDL_GPU_SHADERFORMAT_SPIRV,  //
+                            SDL_GPU_SHADERFORMAT_DXIL}) {
+    if ((formats & format) != 0) {
+      return format;
+    }
+  }
+  return SDL_GPU_SHADERFORMAT_INVALID;
+}
+
+std::vector<uint8_t> PackShaderBlob(const std::vector<ShaderCode>& codes) {
+  std::vector<uint8_t> data;
+  WriteLE32(data, kBlobMagic);
+  WriteLE32(data, kBlobVersion);
+  WriteLE32(data, static_cast<uint32_t>(codes.size()));
+  size_t offset = (3u + 3u * codes.size()) * sizeof(uint32_t);
+  for (const auto& code : codes) {
+    WriteLE32(data, code.format);
+    WriteLE32(data, static_cast<uint32_t>(offset));
+    WriteLE32(data, static_cast<uint32_t>(code.size));
+    offset = AlignPayload(offset + code.size);
+  }
+  for (const auto& code : codes) {
+    data.insert(data.end(), code.data, code.data + code.size);
+    data.resize(AlignPayload(data.size()), 0u);
+  }
+  return data;
+}
+
+ShaderBlob::ShaderBlob(const uint8_t* data, size_t size) {
+  constexpr size_t kHeaderSize = 3u * sizeof(uint32_t);
+  constexpr size_t kEntrySize = 3u * sizeof(uint32_t);
+  if (data == nullptr || size < kHeaderSize) {
+    FML_LOG(ERROR) << "Shader blob is too small.";
+    return;
+  }
+  if (ReadLE32(data) != kBlobMagic || ReadLE32(data + 4u) != kBlobVersion) {
+    FML_LOG(ERROR) << "Shader blob has an unknown format.";
+    return;
+  }
+  const size_t count = ReadLE32(data + 8u);
+  if (size < kHeaderSize + count * kEntrySize) {
+    FML_LOG(ERROR) << "Shader blob entries are truncated.";
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    const auto entry = data + kHeaderSize + i * kEntrySize;
+    const size_t offset = ReadLE32(entry + 4u);
+    const size_t length = ReadLE32(entry + 8u);
+    if (offset > size || length > size - offset) {
+      FML_LOG(ERROR) << "Shader blob entry is out of bounds.";
+      return;
+    }
+    if (offset % kPayloadAlignment != 0u ||
+        reinterpret_cast<uintptr_t>(data + offset) % kPayloadAlignment != 0u) {
+      FML_LOG(ERROR) << "Shader blob entry is misaligned.";
+      return;
+    }
+    codes_.push_back(ShaderCode{
+        .format = ReadLE32(entry),
+        .data = data + offset,
+        .size = length,
+    });
+  }
+  is_valid_ = true;
+}
+
+ShaderBlob::~ShaderBlob() = default;
+
+bool ShaderBlob::IsValid() const {
+  return is_valid_;
+}
+
+SDL_GPUShaderFormat ShaderBlob::GetFormats() const {
+  SDL_GPUShaderFormat formats = SDL_GPU_SHADERFORMAT_INVALID;
+  for (const auto& code : codes_) {
+    formats |= code.format;
+  }
+  return formats;
+}
+
+std::optional<ShaderCode> ShaderBlob::PickCode(
+    SDL_GPUShaderFormat supported) const {
+  const auto format = PickPreferredShaderFormat(supported & GetFormats());
+  for (const auto& code : codes_) {
+    if (code.format == format) {
+      return code;
+    }
+  }
+  FML_LOG(ERROR) << "Shader blob has no code in a format the device supports.";
+  return std::nullopt;
+}
+
+}  // namespace ts
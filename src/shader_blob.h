@@ -0,0 +1,54 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <optional>
+#include <vector>
+#include "sdl_types.h"
+
+namespace ts {
+
+// The shader formats embedded in each blob by the add_shader build rule.
+constexpr SDL_GPUShaderFormat kBundledShaderFormats =
+    SDL_GPU_SHADERFORMAT_MSL | SDL_GPU_SHADERFORMAT_SPIRV
+#ifdef TS_SHADERS_DXIL
+    | SDL_GPU_SHADERFORMAT_DXIL
+#endif  // TS_SHADERS_DXIL
+    ;
+
+struct ShaderCode {
+  SDL_GPUShaderFormat format = SDL_GPU_SHADERFORMAT_INVALID;
+  const uint8_t* data = nullptr;
+  size_t size = 0u;
+};
+
+// Picks one of the given formats in the order MSL, SPIR-V, DXIL.
+SDL_GPUShaderFormat PickPreferredShaderFormat(SDL_GPUShaderFormat formats);
+
+// Packs code into the same layout shader_blob.cmake generates.
+std::vector<uint8_t> PackShaderBlob(const std::vector<ShaderCode>& codes);
+
+// A view into the multi-format shader blob generated by shader_blob.cmake. The
+// data is not copied and must outlive the blob. It must also be 4-byte aligned
+// so that the payloads are.
+class ShaderBlob {
+ public:
+  ShaderBlob(const uint8_t* data, size_t size);
+
+  ~ShaderBlob();
+
+  bool IsValid() const;
+
+  SDL_GPUShaderFormat GetFormats() const;
+
+  // Picks the code for one of the supported formats. Formats are preferred in
+  // the order MSL, SPIR-V, DXIL.
+  std::optional<ShaderCode> PickCode(SDL_GPUShaderFormat supported) const;
+
+ private:
+  std::vector<ShaderCode> codes_;
+  bool is_valid_ = false;
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(ShaderBlob);
+};
+
+}  // namespace ts
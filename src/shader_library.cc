@@ -0,0 +1,123 @@
+#include "shader_library.h"
+
+#include <fml/logging.h>
+#include "compute.slang.h"
+#include "compute_primitives.slang.h"
+#include "hiz.slang.h"
+#include "model.slang.h"
+#include "occlusion_culling.slang.h"
+#include "occlusion_depth.slang.h"
+#include "particle_simulation.slang.h"
+#include "particles.slang.h"
+#include "sampling.slang.h"
+#include "shader_sources_location.h"
+#include "shader_watcher.h"
+#include "skinning.slang.h"
+#include "triangle.slang.h"
+#include "upscale.slang.h"
+
+namespace ts {
+
+namespace {
+
+// Keeps the data of blobs compiled at runtime alive along with the blob.
+struct OwnedShaderBlob {
+  std::vector<uint8_t> data;
+  ShaderBlob blob;
+
+  explicit OwnedShaderBlob(std::vector<uint8_t> p_data)
+      : data(std::move(p_data)), blob(data.data(), data.size()) {}
+};
+
+}  // namespace
+
+ShaderLibrary::ShaderLibrary() {
+  auto bundled = [&](const char* name, const unsigned char* data,
+                     unsigned int length) {
+    blobs_[name] = std::make_shared<const ShaderBlob>(data, length);
+  };
+  bundled("compute", xxd_compute_data, xxd_compute_length);
+  bundled("compute_primitives", xxd_compute_primitives_data,
+          xxd_compute_primitives_length);
+  bundled("hiz", xxd_hiz_data, xxd_hiz_length);
+  bundled("model", xxd_model_data, xxd_model_length);
+  bundled("occlusion_culling", xxd_occlusion_culling_data,
+          xxd_occlusion_culling_length);
+  bundled("occlusion_depth", xxd_occlusion_depth_data,
+          xxd_occlusion_depth_length);
+  bundled("particle_simulation", xxd_particle_simulation_data,
+          xxd_particle_simulation_length);
+  bundled("particles", xxd_particles_data, xxd_particles_length);
+  bundled("sampling", xxd_sampling_data, xxd_sampling_length);
+  bundled("skinning", xxd_skinning_data, xxd_skinning_length);
+  bundled("triangle", xxd_triangle_data, xxd_triangle_length);
+  bundled("upscale", xxd_upscale_data, xxd_upscale_length);
+}
+
+ShaderLibrary::~ShaderLibrary() {
+  // Stop the watcher before the pending reloads it appends to go away.
+  watcher_.reset();
+}
+
+std::shared_ptr<const ShaderBlob> ShaderLibrary::GetBlob(
+    const std::string& name) const {
+  std::scoped_lock lock(mutex_);
+  auto found = blobs_.find(name);
+  if (found == blobs_.end()) {
+    FML_LOG(ERROR) << "Unknown shader '" << name << "'.";
+    return nullptr;
+  }
+  return found->second;
+}
+
+bool ShaderLibrary::StartHotReload(SDL_GPUShaderFormat format) {
+#if defined(SHADER_SOURCES_LOCATION) && defined(SLANGC_LOCATION)
+  auto watcher = std::make_unique<ShaderWatcher>(
+      SHADER_SOURCES_LOCATION, SLANGC_LOCATION, format,
+      [this, format](std::string name, std::vector<uint8_t> code) {
+        auto blob = PackShaderBlob({ShaderCode{
+            .format = format,
+            .data = code.data(),
+            .size = code.size(),
+        }});
+        std::scoped_lock lock(mutex_);
+        pending_reloads_.push_back(PendingReload{
+            .name = std::move(name),
+            .blob = std::move(blob),
+        });
+      });
+  if (!watcher->IsValid()) {
+    return false;
+  }
+  watcher_ = std::move(watcher);
+  return true;
+#else   // defined(SHADER_SOURCES_LOCATION) && defined(SLANGC_LOCATION)
+  FML_LOG(ERROR) << "Shader hot reload was not enabled in this build.";
+  return false;
+#endif  // defined(SHADER_SOURCES_LOCATION) && defined(SLANGC_LOCATION)
+}
+
+bool ShaderLibrary::ApplyPendingReloads() {
+  std::vector<PendingReload> reloads;
+  {
+    std::scoped_lock lock(mutex_);
+    std::swap(reloads, pending_reloads_);
+  }
+  for (auto& reload : reloads) {
+    RegisterBlob(std::move(reload.name), std::move(reload.blob));
+  }
+  return !reloads.empty();
+}
+
+void ShaderLibrary::RegisterBlob(std::string name, std::vector<uint8_t> data) {
+  auto owned = std::make_shared<const OwnedShaderBlob>(std::move(data));
+  if (!owned->blob.IsValid()) {
+    return;
+  }
+  FML_LOG(INFO) << "Reloaded shader '" << name << "'.";
+  std::scoped_lock lock(mutex_);
+  blobs_[std::move(name)] =
+      std::shared_ptr<const ShaderBlob>(owned, &owned->blob);
+}
+
+}  // namespace ts
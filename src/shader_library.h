@@ -0,0 +1,49 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "shader_blob.h"
+
+namespace ts {
+
+class ShaderWatcher;
+
+// Holds the blobs of the shaders bundled into the binary by name. In hot reload
+// mode, blobs are replaced as their sources are edited and recompiled.
+class ShaderLibrary {
+ public:
+  ShaderLibrary();
+
+  ~ShaderLibrary();
+
+  // The name is the file name of the shader source without the extension.
+  std::shared_ptr<const ShaderBlob> GetBlob(const std::string& name) const;
+
+  // Watches the shader sources and recompiles them to the given format on a
+  // background thread as they change.
+  bool StartHotReload(SDL_GPUShaderFormat format);
+
+  // Replaces the blobs of shaders recompiled since the last call. Pipelines
+  // must be rebuilt to pick up the new blobs. Returns if there were any.
+  bool ApplyPendingReloads();
+
+ private:
+  struct PendingReload {
+    std::string name;
+    std::vector<uint8_t> blob;
+  };
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const ShaderBlob>> blobs_;
+  std::vector<PendingReload> pending_reloads_;
+  std::unique_ptr<ShaderWatcher> watcher_;
+
+  void RegisterBlob(std::string name, std::vector<uint8_t> data);
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(ShaderLibrary);
+};
+
+}  // namespace ts
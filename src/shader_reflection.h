@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <span>
+#include "sdl_types.h"
+
+namespace ts {
+
+enum class ShaderStage {
+  kVertex,
+  kFragment,
+  kCompute,
+};
+
+// Compute entrypoints have no graphics shader stage. They are built into
+// compute pipelines instead.
+constexpr std::optional<SDL_GPUShaderStage> ToSDLShaderStage(
+    ShaderStage stage) {
+  switch (stage) {
+    case ShaderStage::kVertex:
+      return SDL_GPU_SHADERSTAGE_VERTEX;
+    case ShaderStage::kFragment:
+      return SDL_GPU_SHADERSTAGE_FRAGMENT;
+    case ShaderStage::kCompute:
+      return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+struct ShaderResourceCounts {
+  Uint32 num_samplers = 0;
+  Uint32 num_storage_textures = 0;
+  Uint32 num_storage_buffers = 0;
+  Uint32 num_readwrite_storage_textures = 0;
+  Uint32 num_readwrite_storage_buffers = 0;
+  Uint32 num_uniform_buffers = 0;
+};
+
+// Describes a shader entrypoint. Instances are generated at build time from
+// the Slang reflection JSON by shader_reflection.cmake. See the
+// <shader>.slang.reflection.h headers.
+struct EntryPointReflection {
+  const char* name = nullptr;
+  ShaderStage stage = ShaderStage::kVertex;
+  ShaderResourceCounts resources;
+  std::array<int, 3> thread_count = {1, 1, 1};
+  // Vertex entrypoints only. Attributes are tightly packed in location order
+  // in buffer slot zero.
+  std::span<const SDL_GPUVertexAttribute> vertex_attributes;
+  Uint32 vertex_pitch = 0;
+};
+
+}  // namespace ts
@@ -0,0 +1,195 @@
+#include "shader_watcher.h"
+
+#include <fml/logging.h>
+#include <hedley.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include "macros.h"
+#include "profiler.h"
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif  // defined(__linux__)
+
+namespace ts {
+
+ShaderWatcher::ShaderWatcher(std::string directory,
+                             std::string slangc,
+                             SDL_GPUShaderFormat format,
+                             CompileCallback callback)
+    : directory_(std::move(directory)),
+      slangc_(std::move(slangc)),
+      format_(format),
+      callback_(std::move(callback)) {
+#if defined(__linux__)
+  inotify_fd_ = inotify_init1(IN_CLOEXEC);
+  wakeup_fd_ = eventfd(0, EFD_CLOEXEC);
+  if (inotify_fd_ < 0 || wakeup_fd_ < 0) {
+    FML_LOG(ERROR) << "Could not create shader watcher descriptors.";
+    return;
+  }
+  // Editors commonly save by renaming a temporary file over the original.
+  if (inotify_add_watch(inotify_fd_, directory_.c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    FML_LOG(ERROR) << "Could not watch shader directory " << directory_;
+    return;
+  }
+  thread_ = std::thread([this]() { WatchChanges(); });
+  FML_LOG(INFO) << "Watching " << directory_ << " for shader changes.";
+#else   // defined(__linux__)
+  FML_LOG(ERROR) << "Shader hot reload is only supported on Linux.";
+#endif  // defined(__linux__)
+}
+
+ShaderWatcher::~ShaderWatcher() {
+#if defined(__linux__)
+  if (thread_.joinable()) {
+    const uint64_t wakeup = 1u;
+    [[maybe_unused]] auto written = write(wakeup_fd_, &wakeup, sizeof(wakeup));
+    thread_.join();
+  }
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+  }
+  if (wakeup_fd_ >= 0) {
+    close(wakeup_fd_);
+  }
+#endif  // defined(__linux__)
+}
+
+bool ShaderWatcher::IsValid() const {
+  return thread_.joinable();
+}
+
+void ShaderWatcher::WatchChanges() {
+#if defined(__linux__)
+  Profiler::GetInstance().SetThreadName("ShaderWatcher");
+  alignas(inotify_event) char buffer[4096];
+  while (true) {
+    pollfd fds[] = {
+        {.fd = inotify_fd_, .events = POLLIN},
+        {.fd = wakeup_fd_, .events = POLLIN},
+    };
+    if (poll(fds, std::size(fds), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      FML_LOG(ERROR) << "Could not poll for shader changes.";
+      return;
+    }
+    if (fds[1].revents != 0) {
+      return;
+    }
+    // A single save may generate multiple events. Compile each shader once.
+    std::set<std::string> changed;
+    const auto length = read(inotify_fd_, buffer, sizeof(buffer));
+    for (ssize_t offset = 0; offset < length;) {
+      const auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+      offset += sizeof(inotify_event) + event->len;
+      if (event->len == 0) {
+        continue;
+      }
+      const auto path = std::filesystem::path{event->name};
+      if (path.extension() == ".slang") {
+        changed.insert(path.stem().string());
+      }
+    }
+    for (const auto& name : changed) {
+      if (auto code = Compile(name); code.has_value()) {
+        callback_(name, std::move(code.value()));
+      }
+    }
+  }
+#endif  // defined(__linux__)
+}
+
+std::optional<std::vector<uint8_t>> ShaderWatcher::Compile(
+    const std::string& name) const {
+#if defined(__linux__)
+  TS_PROFILE_SCOPE("ShaderWatcher::Compile");
+  const auto source = std::filesystem::path{directory_} / (name + ".slang");
+  // Unique so that concurrent instances don't overwrite each other's output.
+  auto output_template = (std::filesystem::temp_directory_path() /
+                          ("triangle_sandbox_" + name + "_XXXXXX"))
+                             .string();
+  const auto output_fd = mkstemp(output_template.data());
+  if (output_fd < 0) {
+    FML_LOG(ERROR) << "Could not create a temporary file for shader '" << name
+                   << "'.";
+    return std::nullopt;
+  }
+  close(output_fd);
+  const auto output = std::filesystem::path{output_template};
+  FML_DEFER({
+    std::error_code error;
+    std::filesystem::remove(output, error);
+  });
+  // Matches the flags of the add_shader build rule.
+  std::vector<std::string> args = {
+      slangc_,
+      "-O" HEDLEY_STRINGIFY(TS_SHADER_OPTIMIZATION_LEVEL),
+#if TS_SHADER_DEBUG_INFO
+      "-g",
+#else   // TS_SHADER_DEBUG_INFO
+      "-line-directive-mode",
+      "none",
+#endif  // TS_SHADER_DEBUG_INFO
+  };
+  switch (format_) {
+    case SDL_GPU_SHADERFORMAT_MSL:
+      args.insert(args.end(), {"-target", "metal"});
+      break;
+    case SDL_GPU_SHADERFORMAT_SPIRV:
+      args.insert(args.end(), {"-target", "spirv", "-fvk-use-entrypoint-name"});
+      break;
+    case SDL_GPU_SHADERFORMAT_DXIL:
+      args.insert(args.end(), {"-target", "dxil", "-profile", "sm_6_0"});
+      break;
+    default:
+      FML_LOG(ERROR) << "Unsupported shader format for hot reload.";
+      return std::nullopt;
+  }
+  args.insert(args.end(), {"-o", output.string(), source.string()});
+
+  std::vector<char*> argv;
+  for (auto& arg : args) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+
+  const auto pid = fork();
+  if (pid < 0) {
+    FML_LOG(ERROR) << "Could not launch slangc.";
+    return std::nullopt;
+  }
+  if (pid == 0) {
+    execv(argv[0], argv.data());
+    _exit(127);
+  }
+  int status = 0;
+  if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0) {
+    // slangc prints its own diagnostics.
+    FML_LOG(ERROR) << "Could not compile shader '" << name << "'.";
+    return std::nullopt;
+  }
+
+  std::ifstream stream(output, std::ios::binary);
+  if (!stream) {
+    FML_LOG(ERROR) << "Could not read compiled shader " << output;
+    return std::nullopt;
+  }
+  return std::vector<uint8_t>{std::istreambuf_iterator<char>{stream},
+                              std::istreambuf_iterator<char>{}};
+#else   // defined(__linux__)
+  return std::nullopt;
+#endif  // defined(__linux__)
+}
+
+}  // namespace ts
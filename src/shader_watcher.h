@@ -0,0 +1,47 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <functional>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sdl_types.h"
+
+namespace ts {
+
+// Watches a directory of Slang shader sources and recompiles the ones that
+// change with slangc on a background thread. Only supported on Linux.
+class ShaderWatcher {
+ public:
+  // Invoked on the watcher thread with the name of the shader and its newly
+  // compiled code.
+  using CompileCallback =
+      std::function<void(std::string name, std::vector<uint8_t> code)>;
+
+  ShaderWatcher(std::string directory,
+                std::string slangc,
+                SDL_GPUShaderFormat format,
+                CompileCallback callback);
+
+  ~ShaderWatcher();
+
+  bool IsValid() const;
+
+ private:
+  const std::string directory_;
+  const std::string slangc_;
+  const SDL_GPUShaderFormat format_;
+  const CompileCallback callback_;
+  int inotify_fd_ = -1;
+  int wakeup_fd_ = -1;
+  std::thread thread_;
+
+  void WatchChanges();
+
+  std::optional<std::vector<uint8_t>> Compile(const std::string& name) const;
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(ShaderWatcher);
+};
+
+}  // namespace ts
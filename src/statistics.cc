@@ -0,0 +1,32 @@
+#include "statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace ts {
+
+static double Percentile(const std::vector<double>& sorted, double percentile) {
+  const auto rank = std::ceil(percentile / 100.0 * sorted.size());
+  const auto index = std::clamp<size_t>(rank, 1u, sorted.size()) - 1u;
+  return sorted[index];
+}
+
+SampleSummary Summarize(std::vector<double> samples) {
+  if (samples.empty()) {
+    return {};
+  }
+  std::sort(samples.begin(), samples.end());
+  return SampleSummary{
+      .count = samples.size(),
+      .min = samples.front(),
+      .max = samples.back(),
+      .mean = std::accumulate(samples.begin(), samples.end(), 0.0) /
+              samples.size(),
+      .p50 = Percentile(samples, 50.0),
+      .p95 = Percentile(samples, 95.0),
+      .p99 = Percentile(samples, 99.0),
+  };
+}
+
+}  // namespace ts
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace ts {
+
+struct SampleSummary {
+  size_t count = 0u;
+  double min = 0.0;
+  double max = 0.0;
+  double mean = 0.0;
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+};
+
+// Percentiles use the nearest-rank method.
+SampleSummary Summarize(std::vector<double> samples);
+
+}  // namespace ts
@@ -0,0 +1,228 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <random>
+#include "buffer.h"
+#include "compute_primitives.h"
+#include "context.h"
+#include "shader_blob.h"
+
+namespace ts {
+
+// Empty and single item inputs, counts around the items per group and counts
+// that take several levels of group totals.
+static constexpr Uint32 kItemCounts[] = {
+    0u, 1u, 2u, 5u, 1023u, 1024u, 1025u, 300001u, (1u << 20u) + 7u,
+};
+
+// Checks each primitive against a CPU reference on a headless context. The
+// tests are skipped when no device can consume the bundled shaders.
+class ComputePrimitivesTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite() {
+    // The video subsystem is still necessary to load the Vulkan library. The
+    // offscreen driver doesn't need a display server.
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    if (!SDL_Init(SDL_INIT_VIDEO) ||
+        !SDL_GPUSupportsShaderFormats(kBundledShaderFormats, "vulkan")) {
+      return;
+    }
+    context_ = std::make_unique<Context>(glm::ivec2{1, 1});
+    primitives_ = std::make_unique<ComputePrimitives>(
+        context_->GetDevice(), context_->GetShaderLibrary());
+  }
+
+  static void TearDownTestSuite() {
+    primitives_.reset();
+    context_.reset();
+    SDL_Quit();
+  }
+
+  void SetUp() override {
+    if (!context_) {
+      GTEST_SKIP() << "No GPU device consumes the bundled shader formats.";
+    }
+    ASSERT_TRUE(primitives_->IsValid());
+  }
+
+  static std::vector<uint32_t> MakeRandomItems(size_t count, uint32_t max) {
+    std::mt19937 generator(static_cast<uint32_t>(count));
+    std::uniform_int_distribution<uint32_t> distribution(0u, max);
+    std::vector<uint32_t> items(count);
+    for (auto& item : items) {
+      item = distribution(generator);
+    }
+    return items;
+  }
+
+  // Buffers may not be empty. Empty inputs get a single unused item.
+  static UniqueGPUBuffer UploadItems(std::vector<uint32_t> items) {
+    if (items.empty()) {
+      items.push_back(0xdeadbeefu);
+    }
+    return PerformHostToDeviceTransfer(
+        context_->GetDevice(), items,
+        SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ |
+            SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE);
+  }
+
+  // Records the work into a command buffer and waits for the device to finish
+  // it.
+  static bool RunAndWait(
+      const std::function<bool(SDL_GPUCommandBuffer*)>& record) {
+    auto device = context_->GetDevice().get();
+    auto command_buffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!command_buffer) {
+      return false;
+    }
+    if (!record(command_buffer)) {
+      SDL_CancelGPUCommandBuffer(command_buffer);
+      return false;
+    }
+    auto fence = SDL_SubmitGPUCommandBufferAndAcquireFence(command_buffer);
+    if (!fence) {
+      return false;
+    }
+    const auto waited = SDL_WaitForGPUFences(device, true, &fence, 1u);
+    SDL_ReleaseGPUFence(device, fence);
+    return waited;
+  }
+
+  static std::vector<uint32_t> ReadItems(const UniqueGPUBuffer& buffer,
+                                         size_t count) {
+    if (count == 0u) {
+      return {};
+    }
+    auto bytes =
+        PerformDeviceToHostTransfer(buffer, 0u, count * sizeof(uint32_t))
+            .Take();
+    if (!bytes.has_value()) {
+      ADD_FAILURE() << "Could not read back the buffer.";
+      return {};
+    }
+    std::vector<uint32_t> items(count);
+    std::memcpy(items.data(), bytes->data(), bytes->size());
+    return items;
+  }
+
+  static std::unique_ptr<Context> context_;
+  static std::unique_ptr<ComputePrimitives> primitives_;
+};
+
+std::unique_ptr<Context> ComputePrimitivesTest::context_;
+std::unique_ptr<ComputePrimitives> ComputePrimitivesTest::primitives_;
+
+TEST_F(ComputePrimitivesTest, ExclusiveScanMatchesTheCPU) {
+  for (const auto count : kItemCounts) {
+    SCOPED_TRACE(count);
+    const auto items = MakeRandomItems(count, 255u);
+    auto buffer = UploadItems(items);
+    ASSERT_TRUE(buffer.is_valid());
+    ASSERT_TRUE(RunAndWait([&](SDL_GPUCommandBuffer* command_buffer) {
+      return primitives_->ExclusiveScan(command_buffer, buffer.get().value,
+                                        count);
+    }));
+    std::vector<uint32_t> expected(count);
+    std::exclusive_scan(items.begin(), items.end(), expected.begin(), 0u);
+    EXPECT_EQ(ReadItems(buffer, count), expected);
+  }
+}
+
+TEST_F(ComputePrimitivesTest, ReduceMatchesTheCPU) {
+  for (const auto count : kItemCounts) {
+    SCOPED_TRACE(count);
+    const auto items = MakeRandomItems(count, 0xffffffffu);
+    auto input = UploadItems(items);
+    auto result = UploadItems({0x12345678u});
+    ASSERT_TRUE(input.is_valid() && result.is_valid());
+    // The reduction of no items is the identity of the operation.
+    const auto operations = {
+        std::make_pair(ReduceOperation::kSum,
+                       std::accumulate(items.begin(), items.end(), 0u)),
+        std::make_pair(ReduceOperation::kMin,
+                       std::accumulate(items.begin(), items.end(), 0xffffffffu,
+                                       [](uint32_t a, uint32_t b) {
+                                         return std::min(a, b);
+                                       })),
+        std::make_pair(ReduceOperation::kMax,
+                       std::accumulate(items.begin(), items.end(), 0u,
+                                       [](uint32_t a, uint32_t b) {
+                                         return std::max(a, b);
+                                       })),
+    };
+    for (const auto& [operation, expected] : operations) {
+      SCOPED_TRACE(static_cast<int>(operation));
+      ASSERT_TRUE(RunAndWait([&](SDL_GPUCommandBuffer* command_buffer) {
+        return primitives_->Reduce(command_buffer, input.get().value, count,
+                                   operation, result.get().value);
+      }));
+      EXPECT_EQ(ReadItems(result, 1u), std::vector<uint32_t>{expected});
+    }
+  }
+}
+
+TEST_F(ComputePrimitivesTest, CompactMatchesTheCPU) {
+  for (const auto count : kItemCounts) {
+    SCOPED_TRACE(count);
+    const auto values = MakeRandomItems(count, 0xffffffffu);
+    const auto flags = MakeRandomItems(count, 1u);
+    auto values_buffer = UploadItems(values);
+    auto flags_buffer = UploadItems(flags);
+    auto output = UploadItems(std::vector<uint32_t>(count));
+    // Must be overwritten even when nothing is kept.
+    auto output_count = UploadItems({0x12345678u});
+    ASSERT_TRUE(values_buffer.is_valid() && flags_buffer.is_valid() &&
+                output.is_valid() && output_count.is_valid());
+    ASSERT_TRUE(RunAndWait([&](SDL_GPUCommandBuffer* command_buffer) {
+      return primitives_->Compact(
+          command_buffer, values_buffer.get().value, flags_buffer.get().value,
+          count, output.get().value, output_count.get().value);
+    }));
+    std::vector<uint32_t> expected;
+    for (size_t i = 0; i < count; i++) {
+      if (flags[i] != 0u) {
+        expected.push_back(values[i]);
+      }
+    }
+    EXPECT_EQ(ReadItems(output_count, 1u),
+              std::vector<uint32_t>{static_cast<uint32_t>(expected.size())});
+    EXPECT_EQ(ReadItems(output, expected.size()), expected);
+  }
+}
+
+TEST_F(ComputePrimitivesTest, SortKeyValueMatchesTheCPU) {
+  for (const auto count : kItemCounts) {
+    // Few distinct keys check that equal keys keep their order.
+    for (const auto max_key : {15u, 0xffffffffu}) {
+      SCOPED_TRACE(testing::Message() << count << " keys up to " << max_key);
+      const auto keys = MakeRandomItems(count, max_key);
+      std::vector<uint32_t> values(count);
+      std::iota(values.begin(), values.end(), 0u);
+      auto keys_buffer = UploadItems(keys);
+      auto values_buffer = UploadItems(values);
+      ASSERT_TRUE(keys_buffer.is_valid() && values_buffer.is_valid());
+      ASSERT_TRUE(RunAndWait([&](SDL_GPUCommandBuffer* command_buffer) {
+        return primitives_->SortKeyValue(command_buffer,
+                                         keys_buffer.get().value,
+                                         values_buffer.get().value, count);
+      }));
+      // The values are the original indices so a stable sort is fully
+      // determined.
+      std::vector<uint32_t> expected_values = values;
+      std::stable_sort(
+          expected_values.begin(), expected_values.end(),
+          [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+      std::vector<uint32_t> expected_keys(count);
+      for (size_t i = 0; i < count; i++) {
+        expected_keys[i] = keys[expected_values[i]];
+      }
+      EXPECT_EQ(ReadItems(keys_buffer, count), expected_keys);
+      EXPECT_EQ(ReadItems(values_buffer, count), expected_values);
+    }
+  }
+}
+
+}  // namespace ts
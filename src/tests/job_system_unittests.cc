@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "job_system.h"
+
+namespace ts {
+
+// Each test runs with no workers, where waiting threads run every job, and
+// with enough workers for jobs to be stolen.
+class JobSystemTest : public ::testing::TestWithParam<size_t> {};
+
+INSTANTIATE_TEST_SUITE_P(WorkerCounts,
+                         JobSystemTest,
+                         ::testing::Values(0u, 1u, 4u));
+
+TEST_P(JobSystemTest, RunsEveryJob) {
+  JobSystem jobs(GetParam());
+  constexpr int kJobCount = 10000;
+  std::atomic_int ran = 0;
+  JobCounter counter;
+  for (int i = 0; i < kJobCount; i++) {
+    jobs.Run([&]() { ran.fetch_add(1); }, counter);
+  }
+  jobs.Wait(counter);
+  EXPECT_TRUE(counter.IsDone());
+  EXPECT_EQ(ran.load(), kJobCount);
+}
+
+TEST_P(JobSystemTest, RunAfterWaitsForTheDependency) {
+  JobSystem jobs(GetParam());
+  constexpr int kJobCount = 1000;
+  constexpr int kContinuationCount = 16;
+  std::atomic_int ran = 0;
+  std::atomic_int continuations_ran = 0;
+  std::atomic_bool early = false;
+  JobCounter dependency;
+  JobCounter counter;
+  for (int i = 0; i < kJobCount; i++) {
+    jobs.Run([&]() { ran.fetch_add(1); }, dependency);
+  }
+  for (int i = 0; i < kContinuationCount; i++) {
+    jobs.RunAfter(
+        dependency,
+        [&]() {
+          if (ran.load() != kJobCount) {
+            early = true;
+          }
+          continuations_ran.fetch_add(1);
+        },
+        counter);
+  }
+  jobs.Wait(counter);
+  EXPECT_FALSE(early.load());
+  EXPECT_EQ(continuations_ran.load(), kContinuationCount);
+  EXPECT_TRUE(dependency.IsDone());
+}
+
+TEST_P(JobSystemTest, RunAfterADoneDependencyRunsRightAway) {
+  JobSystem jobs(GetParam());
+  JobCounter dependency;
+  JobCounter counter;
+  std::atomic_bool ran = false;
+  jobs.RunAfter(dependency, [&]() { ran = true; }, counter);
+  jobs.Wait(counter);
+  EXPECT_TRUE(ran.load());
+}
+
+TEST_P(JobSystemTest, ContinuationsChainInOrder) {
+  JobSystem jobs(GetParam());
+  constexpr size_t kChainLength = 64u;
+  std::vector<JobCounter> counters(kChainLength);
+  std::vector<size_t> order;
+  jobs.Run([&]() { order.push_back(0u); }, counters[0]);
+  // Each link only runs once the previous one is done so the vector is never
+  // written concurrently.
+  for (size_t i = 1; i < kChainLength; i++) {
+    jobs.RunAfter(
+        counters[i - 1], [&order, i]() { order.push_back(i); }, counters[i]);
+  }
+  jobs.Wait(counters.back());
+  ASSERT_EQ(order.size(), kChainLength);
+  for (size_t i = 0; i < kChainLength; i++) {
+    EXPECT_EQ(order[i], i);
+  }
+}
+
+TEST_P(JobSystemTest, JobsMayWaitOnJobsTheyStart) {
+  JobSystem jobs(GetParam());
+  constexpr int kOuterCount = 32;
+  constexpr int kInnerCount = 32;
+  std::atomic_int ran = 0;
+  JobCounter outer;
+  for (int i = 0; i < kOuterCount; i++) {
+    jobs.Run(
+        [&]() {
+          JobCounter inner;
+          for (int j = 0; j < kInnerCount; j++) {
+            jobs.Run([&]() { ran.fetch_add(1); }, inner);
+          }
+          jobs.Wait(inner);
+          EXPECT_TRUE(inner.IsDone());
+        },
+        outer);
+  }
+  jobs.Wait(outer);
+  EXPECT_EQ(ran.load(), kOuterCount * kInnerCount);
+}
+
+TEST_P(JobSystemTest, NestedParallelFor) {
+  JobSystem jobs(GetParam());
+  constexpr size_t kCount = 64u;
+  std::vector<std::atomic_int> visits(kCount * kCount);
+  jobs.ParallelFor(kCount, 3u, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      jobs.ParallelFor(kCount, 5u, [&](size_t inner_begin, size_t inner_end) {
+        for (size_t j = inner_begin; j < inner_end; j++) {
+          visits[i * kCount + j].fetch_add(1);
+        }
+      });
+    }
+  });
+  for (const auto& visit : visits) {
+    ASSERT_EQ(visit.load(), 1);
+  }
+}
+
+// Counts that aren't multiples of the batch size leave a short last batch.
+TEST_P(JobSystemTest, ParallelForCoversTheRangeOnce) {
+  JobSystem jobs(GetParam());
+  for (const size_t count : {0u, 1u, 2u, 7u, 100u, 1023u, 1024u, 4099u}) {
+    for (const size_t batch_size : {0u, 1u, 3u, 64u, 1000u, 5000u}) {
+      std::vector<std::atomic_int> visits(count);
+      std::atomic_bool oversized = false;
+      jobs.ParallelFor(count, batch_size, [&](size_t begin, size_t end) {
+        if (begin > end || end > count ||
+            end - begin > std::max<size_t>(batch_size, 1u)) {
+          oversized = true;
+          return;
+        }
+        for (size_t i = begin; i < end; i++) {
+          visits[i].fetch_add(1);
+        }
+      });
+      EXPECT_FALSE(oversized.load())
+          << "count " << count << ", batch size " << batch_size;
+      for (size_t i = 0; i < count; i++) {
+        ASSERT_EQ(visits[i].load(), 1) << "Item " << i << " of " << count
+                                       << ", batch size " << batch_size;
+      }
+    }
+  }
+}
+
+}  // namespace ts
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "profiler.h"
+
+namespace ts {
+
+static constexpr const char* kZoneName = "ProfilerTestZone";
+
+// Reads the value following the key in a trace event.
+static double ReadTraceField(const std::string& event,
+                             const std::string& key) {
+  const auto position = event.find("\"" + key + "\":");
+  EXPECT_NE(position, std::string::npos) << event;
+  if (position == std::string::npos) {
+    return -1.0;
+  }
+  return std::strtod(event.c_str() + position + key.size() + 3u, nullptr);
+}
+
+// A thread records zones while they are collected, lapping its ring buffer
+// many times. Each collected zone must be one that was recorded, in order,
+// rather than a mix of the zones that shared its slot.
+TEST(ProfilerTest, CollectingWhileRecordingKeepsWholeZones) {
+  constexpr Uint64 kZoneCount = 200000u;
+  auto& profiler = Profiler::GetInstance();
+  profiler.StartTrace();
+
+  std::atomic_bool done = false;
+  std::thread recorder([&]() {
+    // Zone i begins at i us and lasts i % 7 us.
+    for (Uint64 i = 0; i < kZoneCount; i++) {
+      profiler.RecordZone(ProfileZone{
+          .name = kZoneName,
+          .begin_ns = i * 1000u,
+          .end_ns = (i + i % 7u) * 1000u,
+      });
+    }
+    done = true;
+  });
+  while (!done.load()) {
+    profiler.CollectFrame();
+  }
+  recorder.join();
+  profiler.CollectFrame();
+
+  const auto path = testing::TempDir() + "profiler_unittests_trace.json";
+  ASSERT_TRUE(profiler.StopTrace(path));
+  std::ifstream trace(path);
+  ASSERT_TRUE(trace);
+  size_t collected = 0u;
+  double previous = -1.0;
+  for (std::string event; std::getline(trace, event);) {
+    if (event.find(kZoneName) == std::string::npos) {
+      continue;
+    }
+    const auto begin = ReadTraceField(event, "ts");
+    const auto duration = ReadTraceField(event, "dur");
+    const auto index = static_cast<Uint64>(begin);
+    ASSERT_EQ(begin, static_cast<double>(index)) << event;
+    ASSERT_LT(index, kZoneCount) << event;
+    ASSERT_EQ(duration, static_cast<double>(index % 7u)) << event;
+    ASSERT_GT(begin, previous) << event;
+    previous = begin;
+    collected++;
+  }
+  EXPECT_GT(collected, 0u);
+  std::remove(path.c_str());
+}
+
+}  // namespace ts
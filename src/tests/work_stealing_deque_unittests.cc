@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "work_stealing_deque.h"
+
+namespace ts {
+
+using SmallDeque = WorkStealingDeque<int, 8u>;
+
+TEST(WorkStealingDequeTest, EmptyDequeHasNothingToTake) {
+  SmallDeque deque;
+  EXPECT_TRUE(deque.IsEmpty());
+  EXPECT_EQ(deque.Pop(), std::nullopt);
+  EXPECT_EQ(deque.Steal(), std::nullopt);
+  // Popping an empty deque must leave it usable.
+  EXPECT_TRUE(deque.Push(1));
+  EXPECT_EQ(deque.Pop(), 1);
+  EXPECT_TRUE(deque.IsEmpty());
+}
+
+TEST(WorkStealingDequeTest, OwnerPopsNewestAndThievesStealOldest) {
+  SmallDeque deque;
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(deque.Push(i));
+  }
+  EXPECT_EQ(deque.Pop(), 3);
+  EXPECT_EQ(deque.Steal(), 0);
+  EXPECT_EQ(deque.Pop(), 2);
+  EXPECT_EQ(deque.Steal(), 1);
+  EXPECT_TRUE(deque.IsEmpty());
+  EXPECT_EQ(deque.Pop(), std::nullopt);
+  EXPECT_EQ(deque.Steal(), std::nullopt);
+}
+
+TEST(WorkStealingDequeTest, PushFailsAtCapacity) {
+  SmallDeque deque;
+  for (int i = 0; i < 8; i++) {
+    ASSERT_TRUE(deque.Push(i));
+  }
+  EXPECT_FALSE(deque.Push(8));
+  // A steal frees a slot.
+  EXPECT_EQ(deque.Steal(), 0);
+  EXPECT_TRUE(deque.Push(8));
+  EXPECT_FALSE(deque.Push(9));
+  for (int i = 8; i > 0; i--) {
+    EXPECT_EQ(deque.Pop(), i);
+  }
+  EXPECT_TRUE(deque.IsEmpty());
+}
+
+TEST(WorkStealingDequeTest, IndicesWrapAroundTheRing) {
+  SmallDeque deque;
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < 8; i++) {
+      ASSERT_TRUE(deque.Push(round * 8 + i));
+    }
+    ASSERT_FALSE(deque.Push(-1));
+    for (int i = 0; i < 8; i++) {
+      EXPECT_EQ(deque.Steal(), round * 8 + i);
+    }
+    EXPECT_TRUE(deque.IsEmpty());
+  }
+}
+
+// The owner pushes and pops while thieves steal. Every item must be taken
+// exactly once.
+TEST(WorkStealingDequeTest, ConcurrentStealsTakeEachItemOnce) {
+  constexpr int kItemCount = 20000;
+  constexpr size_t kThiefCount = 4u;
+  auto deque = std::make_unique<WorkStealingDeque<int, 64u>>();
+  std::vector<std::atomic_int> taken(kItemCount);
+  std::atomic_bool done = false;
+
+  std::vector<std::thread> thieves;
+  for (size_t i = 0; i < kThiefCount; i++) {
+    thieves.emplace_back([&]() {
+      while (!done.load() || !deque->IsEmpty()) {
+        if (auto item = deque->Steal()) {
+          taken[*item].fetch_add(1);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  for (int next = 0; next < kItemCount;) {
+    if (deque->Push(next)) {
+      next++;
+    } else {
+      // Full. Give the thieves a chance to drain it.
+      std::this_thread::yield();
+    }
+    // Pop every few pushes so that the owner races thieves for the bottom.
+    if (next % 3 == 0) {
+      if (auto item = deque->Pop()) {
+        taken[*item].fetch_add(1);
+      }
+    }
+  }
+  while (auto item = deque->Pop()) {
+    taken[*item].fetch_add(1);
+  }
+  done = true;
+  for (auto& thief : thieves) {
+    thief.join();
+  }
+
+  for (int i = 0; i < kItemCount; i++) {
+    ASSERT_EQ(taken[i].load(), 1) << "Item " << i;
+  }
+}
+
+}  // namespace ts
@@ -0,0 +1,332 @@
+#include "texture_streamer.h"
+
+#include <fml/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include "frame_counters.h"
+#include "gpu_memory.h"
+#include "profiler.h"
+
+namespace ts {
+
+static constexpr auto kFormat = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+static constexpr size_t kBytesPerTexel = 4u;
+
+static glm::ivec2 GetLevelSize(glm::ivec2 size, Uint32 level) {
+  return glm::max(glm::ivec2{size.x >> level, size.y >> level}, glm::ivec2{1});
+}
+
+// Averages each two by two block of texels. The last row and column are
+// repeated for levels with an odd size.
+static std::vector<uint8_t> Downsample(const std::vector<uint8_t>& pixels,
+                                       glm::ivec2 size,
+                                       glm::ivec2 half_size) {
+  std::vector<uint8_t> result(half_size.x * half_size.y * kBytesPerTexel);
+  const auto texel = [&](int x, int y) {
+    return pixels.data() + (y * size.x + x) * kBytesPerTexel;
+  };
+  for (int y = 0; y < half_size.y; y++) {
+    const auto y0 = std::min(2 * y, size.y - 1);
+    const auto y1 = std::min(2 * y + 1, size.y - 1);
+    for (int x = 0; x < half_size.x; x++) {
+      const auto x0 = std::min(2 * x, size.x - 1);
+      const auto x1 = std::min(2 * x + 1, size.x - 1);
+      auto* out = result.data() + (y * half_size.x + x) * kBytesPerTexel;
+      for (size_t c = 0; c < kBytesPerTexel; c++) {
+        const auto sum = texel(x0, y0)[c] + texel(x1, y0)[c] +
+                         texel(x0, y1)[c] + texel(x1, y1)[c];
+        out[c] = static_cast<uint8_t>((sum + 2) / 4);
+      }
+    }
+  }
+  return result;
+}
+
+TextureStreamer::TextureStreamer(SDL_GPUDevice* device, Budgets budgets)
+    : device_(device), budgets_(budgets) {}
+
+TextureStreamer::~TextureStreamer() = default;
+
+std::optional<size_t> TextureStreamer::AddTexture(SDL_GPUTextureFormat format,
+                                                  glm::ivec2 size,
+                                                  const uint8_t* pixels,
+                                                  size_t pixels_size) {
+  TS_PROFILE_SCOPE("TextureStreamer::AddTexture");
+  if (format != kFormat) {
+    FML_LOG(ERROR) << "Only RGBA8 textures may be streamed.";
+    return std::nullopt;
+  }
+  if (size.x < 1 || size.y < 1 ||
+      pixels_size < size.x * size.y * kBytesPerTexel) {
+    FML_LOG(ERROR) << "Prevented OOB access for texture data.";
+    return std::nullopt;
+  }
+  Texture texture;
+  texture.size = size;
+  texture.levels.emplace_back(pixels,
+                              pixels + size.x * size.y * kBytesPerTexel);
+  while (GetLevelSize(size, texture.levels.size() - 1u) != glm::ivec2{1}) {
+    const Uint32 level = texture.levels.size();
+    texture.levels.push_back(Downsample(texture.levels.back(),
+                                        GetLevelSize(size, level - 1u),
+                                        GetLevelSize(size, level)));
+  }
+  const Uint32 level_count = texture.levels.size();
+  while (texture.initial_level + 1u < level_count) {
+    const auto level_size = GetLevelSize(size, texture.initial_level);
+    if (std::max(level_size.x, level_size.y) <= budgets_.initial_size) {
+      break;
+    }
+    texture.initial_level++;
+  }
+  texture.resident_level = level_count;
+  texture.requested_level = level_count - 1u;
+  textures_.push_back(std::move(texture));
+  return textures_.size() - 1u;
+}
+
+glm::ivec2 TextureStreamer::GetSize(size_t texture) const {
+  return textures_[texture].size;
+}
+
+Uint32 TextureStreamer::GetLevelCount(size_t texture) const {
+  return textures_[texture].levels.size();
+}
+
+void TextureStreamer::Request(size_t texture, Uint32 level) {
+  auto& requested = textures_[texture].requested_level;
+  requested = std::min(requested, level);
+}
+
+SDL_GPUTexture* TextureStreamer::GetTexture(size_t texture) const {
+  return textures_[texture].texture.texture.get().value;
+}
+
+const TextureStreamer::Stats& TextureStreamer::GetStats() const {
+  return stats_;
+}
+
+size_t TextureStreamer::GetResidentSize(const Texture& texture,
+                                        Uint32 resident_level) const {
+  size_t size = 0u;
+  for (auto level = resident_level; level < texture.levels.size(); level++) {
+    size += texture.levels[level].size();
+  }
+  return size;
+}
+
+bool TextureStreamer::Update() {
+  TS_PROFILE_SCOPE("TextureStreamer::Update");
+  const auto count = textures_.size();
+  std::vector<Uint32> desired(count);
+  std::vector<Uint32> targets(count);
+  size_t resident_bytes = 0u;
+  size_t uploaded_bytes = 0u;
+  for (size_t i = 0; i < count; i++) {
+    auto& texture = textures_[i];
+    desired[i] = std::min(texture.requested_level, texture.initial_level);
+    texture.requested_level = texture.levels.size() - 1u;
+    // The coarse levels are uploaded regardless of the budgets.
+    targets[i] = std::min(texture.resident_level, texture.initial_level);
+    resident_bytes += GetResidentSize(texture, targets[i]);
+    uploaded_bytes += GetResidentSize(texture, targets[i]) -
+                      GetResidentSize(texture, texture.resident_level);
+  }
+
+  // Levels finer than needed are only evicted when memory is short so that
+  // moving back and forth doesn't stream them again.
+  for (size_t i = 0; i < count && resident_bytes > budgets_.memory; i++) {
+    if (targets[i] < desired[i]) {
+      resident_bytes -= GetResidentSize(textures_[i], targets[i]) -
+                        GetResidentSize(textures_[i], desired[i]);
+      targets[i] = desired[i];
+    }
+  }
+
+  // One level per texture at a time with the textures furthest from what
+  // they need first.
+  std::vector<size_t> order(count);
+  std::iota(order.begin(), order.end(), 0u);
+  std::ranges::stable_sort(order, std::greater{}, [&](size_t i) {
+    return static_cast<int>(targets[i]) - static_cast<int>(desired[i]);
+  });
+  for (auto streamed = true; streamed;) {
+    streamed = false;
+    for (const auto i : order) {
+      if (targets[i] <= desired[i]) {
+        continue;
+      }
+      const auto bytes = textures_[i].levels[targets[i] - 1u].size();
+      if ((uploaded_bytes > 0u &&
+           uploaded_bytes + bytes > budgets_.upload) ||
+          resident_bytes + bytes > budgets_.memory) {
+        continue;
+      }
+      targets[i]--;
+      uploaded_bytes += bytes;
+      resident_bytes += bytes;
+      streamed = true;
+    }
+  }
+
+  Stats stats = {
+      .texture_count = count,
+      .resident_bytes = resident_bytes,
+      .uploaded_bytes = uploaded_bytes,
+      .streamed_levels = stats_.streamed_levels,
+      .evicted_levels = stats_.evicted_levels,
+  };
+  for (size_t i = 0; i < count; i++) {
+    const auto resident_level = textures_[i].resident_level;
+    if (targets[i] > desired[i]) {
+      stats.pending_levels += targets[i] - desired[i];
+    }
+    if (targets[i] < resident_level) {
+      stats.streamed_levels += resident_level - targets[i];
+    } else {
+      stats.evicted_levels += targets[i] - resident_level;
+    }
+  }
+  if (!Apply(targets)) {
+    return false;
+  }
+  stats_ = stats;
+  return true;
+}
+
+bool TextureStreamer::Apply(const std::vector<Uint32>& resident_levels) {
+  TS_GPU_MEMORY_OWNER("TextureStreamer");
+  std::vector<size_t> changed;
+  size_t upload_size = 0u;
+  for (size_t i = 0; i < textures_.size(); i++) {
+    const auto& texture = textures_[i];
+    if (resident_levels[i] == texture.resident_level) {
+      continue;
+    }
+    changed.push_back(i);
+    for (auto level = resident_levels[i]; level < texture.resident_level;
+         level++) {
+      upload_size += texture.levels[level].size();
+    }
+  }
+  if (changed.empty()) {
+    return true;
+  }
+
+  // The levels to upload are packed in the order they are recorded in below.
+  UniqueGPUTransferBuffer transfer_buffer;
+  if (upload_size > 0u) {
+    transfer_buffer = CreateGPUTransferBuffer(
+        device_, upload_size, SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD);
+    if (!transfer_buffer.is_valid()) {
+      return false;
+    }
+    auto memory = static_cast<uint8_t*>(
+        SDL_MapGPUTransferBuffer(device_, transfer_buffer.get().value, false));
+    if (!memory) {
+      FML_LOG(ERROR) << "Could not map buffer: " << SDL_GetError();
+      return false;
+    }
+    for (const auto i : changed) {
+      const auto& texture = textures_[i];
+      for (auto level = resident_levels[i]; level < texture.resident_level;
+           level++) {
+        const auto& pixels = texture.levels[level];
+        std::memcpy(memory, pixels.data(), pixels.size());
+        memory += pixels.size();
+      }
+    }
+    SDL_UnmapGPUTransferBuffer(device_, transfer_buffer.get().value);
+  }
+
+  auto command_buffer = SDL_AcquireGPUCommandBuffer(device_);
+  if (!command_buffer) {
+    FML_LOG(ERROR) << "Could not create command buffer: " << SDL_GetError();
+    return false;
+  }
+  SDL_PushGPUDebugGroup(command_buffer, "Texture Streaming");
+  auto copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+  if (!copy_pass) {
+    FML_LOG(ERROR) << "Could not create copy pass: " << SDL_GetError();
+    SDL_PopGPUDebugGroup(command_buffer);
+    SDL_CancelGPUCommandBuffer(command_buffer);
+    return false;
+  }
+  std::vector<GPUTexture> replacements;
+  Uint32 offset = 0u;
+  for (const auto i : changed) {
+    const auto& texture = textures_[i];
+    const auto resident_level = resident_levels[i];
+    const Uint32 level_count = texture.levels.size();
+    const auto size = GetLevelSize(texture.size, resident_level);
+    auto replacement = CreateGPUTexture(device_,                        //
+                                        glm::ivec3{size.x, size.y, 1},  //
+                                        SDL_GPU_TEXTURETYPE_2D,         //
+                                        kFormat,                        //
+                                        SDL_GPU_TEXTUREUSAGE_SAMPLER,   //
+                                        level_count - resident_level    //
+    );
+    if (!replacement.IsValid()) {
+      break;
+    }
+    // Levels resident before and after are copied on the device.
+    for (auto level = std::max(resident_level, texture.resident_level);
+         level < level_count; level++) {
+      const auto level_size = GetLevelSize(texture.size, level);
+      const auto src = SDL_GPUTextureLocation{
+          .texture = texture.texture.texture.get().value,
+          .mip_level = level - texture.resident_level,
+      };
+      const auto dst = SDL_GPUTextureLocation{
+          .texture = replacement.texture.get().value,
+          .mip_level = level - resident_level,
+      };
+      SDL_CopyGPUTextureToTexture(copy_pass, &src, &dst, level_size.x,
+                                  level_size.y, 1u, false);
+    }
+    for (auto level = resident_level; level < texture.resident_level;
+         level++) {
+      const auto level_size = GetLevelSize(texture.size, level);
+      const auto src = SDL_GPUTextureTransferInfo{
+          .transfer_buffer = transfer_buffer.get().value,
+          .offset = offset,
+          .pixels_per_row = static_cast<Uint32>(level_size.x),
+          .rows_per_layer = static_cast<Uint32>(level_size.y),
+      };
+      const auto dst = SDL_GPUTextureRegion{
+          .texture = replacement.texture.get().value,
+          .mip_level = level - resident_level,
+          .w = static_cast<Uint32>(level_size.x),
+          .h = static_cast<Uint32>(level_size.y),
+          .d = 1u,
+      };
+      SDL_UploadToGPUTexture(copy_pass, &src, &dst, false);
+      offset += texture.levels[level].size();
+    }
+    replacements.push_back(std::move(replacement));
+  }
+  SDL_EndGPUCopyPass(copy_pass);
+  SDL_PopGPUDebugGroup(command_buffer);
+  if (replacements.size() != changed.size()) {
+    FML_LOG(ERROR) << "Could not create streamed texture.";
+    SDL_CancelGPUCommandBuffer(command_buffer);
+    return false;
+  }
+  if (!SDL_SubmitGPUCommandBuffer(command_buffer)) {
+    FML_LOG(ERROR) << "Could not submit command buffer: " << SDL_GetError();
+    return false;
+  }
+  CountSubmission();
+
+  // The textures replaced are released once the device is done with them.
+  for (size_t i = 0; i < changed.size(); i++) {
+    auto& texture = textures_[changed[i]];
+    texture.texture = std::move(replacements[i]);
+    texture.resident_level = resident_levels[changed[i]];
+  }
+  return true;
+}
+
+}  // namespace ts
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <glm/glm.hpp>
+#include <optional>
+#include <vector>
+#include "buffer.h"
+#include "sdl_types.h"
+
+namespace ts {
+
+// Streams the mip levels of textures in and out of device memory as they are
+// needed. Textures start out with only their coarse levels resident so that
+// they may be drawn right away. Each frame callers request the finest level
+// each texture needs. Finer levels are then uploaded within a per-frame byte
+// budget and levels finer than needed are evicted while the resident levels
+// exceed the memory budget.
+//
+// SDL GPU textures allocate all of their levels when created. So a texture
+// whose residency changes is replaced by one with just the resident levels and
+// the levels both have in common are copied over on the device. Level zero of
+// a streamed texture is its finest resident level.
+class TextureStreamer {
+ public:
+  struct Budgets {
+    // The bytes uploaded per update. A level larger than this is uploaded on
+    // its own.
+    size_t upload = 8u << 20u;
+    // The bytes of resident levels past which unneeded ones are evicted and
+    // no more are streamed in.
+    size_t memory = 256u << 20u;
+    // Levels no larger than this in either dimension are always resident.
+    int initial_size = 128;
+  };
+
+  struct Stats {
+    size_t texture_count = 0u;
+    size_t resident_bytes = 0u;
+    // Requested levels that are not resident yet.
+    size_t pending_levels = 0u;
+    size_t uploaded_bytes = 0u;
+    size_t streamed_levels = 0u;
+    size_t evicted_levels = 0u;
+  };
+
+  TextureStreamer(SDL_GPUDevice* device, Budgets budgets);
+
+  ~TextureStreamer();
+
+  // Builds the mip chain of an RGBA8 image. Nothing is uploaded till the next
+  // update. Returns the handle of the texture.
+  std::optional<size_t> AddTexture(SDL_GPUTextureFormat format,
+                                   glm::ivec2 size,
+                                   const uint8_t* pixels,
+                                   size_t pixels_size);
+
+  glm::ivec2 GetSize(size_t texture) const;
+
+  Uint32 GetLevelCount(size_t texture) const;
+
+  // Asks for the level to be resident. The finest level requested since the
+  // last update wins. Textures not requested only keep their coarse levels
+  // when memory is short.
+  void Request(size_t texture, Uint32 level);
+
+  // Streams and evicts levels. Records into a command buffer of its own that
+  // is submitted before the one the frame is drawn with.
+  bool Update();
+
+  // Null till the first update.
+  SDL_GPUTexture* GetTexture(size_t texture) const;
+
+  // Stats of the last update.
+  const Stats& GetStats() const;
+
+ private:
+  struct Texture {
+    glm::ivec2 size = {};
+    // The host copy of every level, finest first.
+    std::vector<std::vector<uint8_t>> levels;
+    // This level and the coarser ones are always resident.
+    Uint32 initial_level = 0u;
+    // The finest resident level or the level count if none are.
+    Uint32 resident_level = 0u;
+    Uint32 requested_level = 0u;
+    GPUTexture texture;
+  };
+  SDL_GPUDevice* device_ = nullptr;
+  Budgets budgets_;
+  std::vector<Texture> textures_;
+  Stats stats_;
+
+  size_t GetResidentSize(const Texture& texture, Uint32 resident_level) const;
+
+  bool Apply(const std::vector<Uint32>& resident_levels);
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(TextureStreamer);
+};
+
+}  // namespace ts
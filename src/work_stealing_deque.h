@@ -0,0 +1,93 @@
+#pragma once
+
+#include <fml/macros.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+
+namespace ts {
+
+// A bounded Chase-Lev deque. The owning thread pushes and pops items at the
+// bottom. Any other thread may steal items from the top.
+//
+// Stores to the bottom index are releases so that thieves observing an index
+// also observe the items pushed before it.
+template <class T, size_t kCapacity>
+class WorkStealingDeque {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert((kCapacity & (kCapacity - 1u)) == 0u,
+                "Capacity must be a power of two.");
+
+ public:
+  WorkStealingDeque() = default;
+
+  // Owner only. Returns false if the deque is full.
+  bool Push(T item) {
+    const auto bottom = bottom_.load(std::memory_order_relaxed);
+    const auto top = top_.load(std::memory_order_acquire);
+    if (bottom - top >= static_cast<int64_t>(kCapacity)) {
+      return false;
+    }
+    items_[bottom & kMask].store(item, std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Owner only. Takes the most recently pushed item.
+  std::optional<T> Pop() {
+    const auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_seq_cst);
+    auto top = top_.load(std::memory_order_seq_cst);
+    if (top > bottom) {
+      // Empty.
+      bottom_.store(bottom + 1, std::memory_order_release);
+      return std::nullopt;
+    }
+    auto item = items_[bottom & kMask].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      // The last item. Race thieves for it.
+      const auto won = top_.compare_exchange_strong(
+          top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      bottom_.store(bottom + 1, std::memory_order_release);
+      if (!won) {
+        return std::nullopt;
+      }
+    }
+    return item;
+  }
+
+  // Any thread. Takes the least recently pushed item. May spuriously fail
+  // when racing other thieves or the owner.
+  std::optional<T> Steal() {
+    auto top = top_.load(std::memory_order_seq_cst);
+    const auto bottom = bottom_.load(std::memory_order_seq_cst);
+    if (top >= bottom) {
+      return std::nullopt;
+    }
+    auto item = items_[top & kMask].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return std::nullopt;
+    }
+    return item;
+  }
+
+  bool IsEmpty() const {
+    return top_.load(std::memory_order_acquire) >=
+           bottom_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static constexpr int64_t kMask = kCapacity - 1u;
+
+  // Kept on separate cache lines since thieves hammer the top.
+  alignas(64) std::atomic<int64_t> top_ = 0;
+  alignas(64) std::atomic<int64_t> bottom_ = 0;
+  alignas(64) std::array<std::atomic<T>, kCapacity> items_ = {};
+
+  FML_DISALLOW_COPY_ASSIGN_AND_MOVE(WorkStealingDeque);
+};
+
+}  // namespace ts
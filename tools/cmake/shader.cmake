@@ -6,21 +6,122 @@ if(__shader)
 endif()
 set(__shader INCLUDED)
 
+option(TS_SHADERS_DXIL "Emit DXIL in addition to MSL and SPIR-V." OFF)
+
+set(TS_SHADER_OPTIMIZATION_LEVEL "" CACHE STRING
+  "Overrides the slangc optimization level (0-3) for all build types.")
+
+# Debug builds are unoptimized. Release builds are fully optimized.
+# RelWithDebInfo and MinSizeRel builds are optimized but not aggressively.
+if(TS_SHADER_OPTIMIZATION_LEVEL STREQUAL "")
+  set(SLANGC_OPTIMIZATION_LEVEL
+    "$<IF:$<CONFIG:Release>,3,$<IF:$<CONFIG:RelWithDebInfo,MinSizeRel>,2,0>>")
+else()
+  set(SLANGC_OPTIMIZATION_LEVEL ${TS_SHADER_OPTIMIZATION_LEVEL})
+endif()
+
+# Debug information and line directives are only stripped from Release builds.
+# Every other build type keeps them.
+set(SLANGC_DEBUG_INFO "$<IF:$<CONFIG:Release>,0,1>")
+set(SLANGC_FLAGS
+  "-O${SLANGC_OPTIMIZATION_LEVEL}"
+  "$<IF:${SLANGC_DEBUG_INFO},-g,-line-directive-mode$<SEMICOLON>none>"
+)
+
+set(SHADER_BLOB_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/shader_blob.cmake)
+set(SHADER_REFLECTION_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/shader_reflection.cmake)
+
+# The numeric values of the SDL_GPUShaderFormat bits embedded in shader blobs.
+set(SHADER_FORMAT_SPIRV 2)
+set(SHADER_FORMAT_DXIL 8)
+set(SHADER_FORMAT_MSL 16)
+
 function(add_shader TARGET SHADER_FILE)
   get_filename_component(SHADER_NAME ${SHADER_FILE} NAME_WLE)
 
+  set(SHADER_SOURCE ${CMAKE_CURRENT_SOURCE_DIR}/shaders/${SHADER_FILE})
+  set(SHADER_OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${SHADER_FILE})
+  set(SLANGC ${slang_sdk_SOURCE_DIR}/bin/slangc)
+
+  set(SHADER_OUTPUTS
+    ${SHADER_OUTPUT}.metal
+    ${SHADER_OUTPUT}.spv
+  )
+  set(SHADER_BLOB_INPUTS
+    "${SHADER_FORMAT_MSL}=${SHADER_OUTPUT}.metal"
+    "${SHADER_FORMAT_SPIRV}=${SHADER_OUTPUT}.spv"
+  )
+  set(SHADER_DXIL_COMMAND)
+  if(TS_SHADERS_DXIL)
+    list(APPEND SHADER_OUTPUTS ${SHADER_OUTPUT}.dxil)
+    list(APPEND SHADER_BLOB_INPUTS "${SHADER_FORMAT_DXIL}=${SHADER_OUTPUT}.dxil")
+    set(SHADER_DXIL_COMMAND
+      COMMAND ${SLANGC}
+              ${SLANGC_FLAGS}
+              -target dxil
+              -profile sm_6_0
+              -o ${SHADER_OUTPUT}.dxil
+              ${SHADER_SOURCE}
+    )
+  endif()
+
   add_custom_command(
-    OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${SHADER_FILE}.metal
-           ${CMAKE_CURRENT_BINARY_DIR}/${SHADER_FILE}.reflection.json
+    OUTPUT ${SHADER_OUTPUTS}
+           ${SHADER_OUTPUT}.reflection.json
     DEPENDS shaders/${SHADER_FILE}
-    COMMAND ${slang_sdk_SOURCE_DIR}/bin/slangc
-            -line-directive-mode none
-            -O0
-            -o ${CMAKE_CURRENT_BINARY_DIR}/${SHADER_FILE}.metal
-            -reflection-json ${CMAKE_CURRENT_BINARY_DIR}/${SHADER_FILE}.reflection.json
-            ${CMAKE_CURRENT_SOURCE_DIR}/shaders/${SHADER_FILE}
+    COMMAND ${SLANGC}
+            ${SLANGC_FLAGS}
+            -target metal
+            -o ${SHADER_OUTPUT}.metal
+            -reflection-json ${SHADER_OUTPUT}.reflection.json
+            ${SHADER_SOURCE}
+    COMMAND ${SLANGC}
+            ${SLANGC_FLAGS}
+            -target spirv
+            -fvk-use-entrypoint-name
+            -o ${SHADER_OUTPUT}.spv
+            ${SHADER_SOURCE}
+    ${SHADER_DXIL_COMMAND}
+    COMMAND_EXPAND_LISTS
+    VERBATIM
   )
 
-  xxd(${TARGET} ${CMAKE_CURRENT_BINARY_DIR}/${SHADER_FILE}.metal)
+  add_custom_command(
+    OUTPUT ${SHADER_OUTPUT}.h
+    DEPENDS ${SHADER_OUTPUTS} ${SHADER_BLOB_SCRIPT}
+    COMMAND ${CMAKE_COMMAND}
+            -DOUTPUT=${SHADER_OUTPUT}.h
+            -DSYMBOL=xxd_${SHADER_NAME}
+            "-DINPUTS=${SHADER_BLOB_INPUTS}"
+            -P ${SHADER_BLOB_SCRIPT}
+    VERBATIM
+  )
+
+  add_custom_command(
+    OUTPUT ${SHADER_OUTPUT}.reflection.h
+    DEPENDS ${SHADER_OUTPUT}.reflection.json ${SHADER_REFLECTION_SCRIPT}
+    COMMAND ${CMAKE_COMMAND}
+            -DINPUT=${SHADER_OUTPUT}.reflection.json
+            -DOUTPUT=${SHADER_OUTPUT}.reflection.h
+            -DNAMESPACE=ts::shaders::${SHADER_NAME}
+            -DSOURCE=${SHADER_FILE}
+            -P ${SHADER_REFLECTION_SCRIPT}
+    VERBATIM
+  )
+
+  target_sources(${TARGET}
+    PRIVATE
+      ${SHADER_OUTPUT}.h
+      ${SHADER_OUTPUT}.reflection.h
+  )
+  target_compile_definitions(${TARGET}
+    PRIVATE
+      TS_SHADER_OPTIMIZATION_LEVEL=${SLANGC_OPTIMIZATION_LEVEL}
+      TS_SHADER_DEBUG_INFO=${SLANGC_DEBUG_INFO}
+  )
+  if(TS_SHADERS_DXIL)
+    # Public since the bundled formats in shader_blob.h depend on it.
+    target_compile_definitions(${TARGET} PUBLIC TS_SHADERS_DXIL=1)
+  endif()
 
 endfunction()
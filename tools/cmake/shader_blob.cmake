@@ -0,0 +1,82 @@
+# This source file is part of Epoxy licensed under the MIT License.
+# See LICENSE.md file for details.
+
+# Packs the per-format outputs of slangc into a single blob embedded in a
+# header. Invoked in script mode with:
+#
+#   -DOUTPUT=<header path>
+#   -DSYMBOL=<symbol name>
+#   -DINPUTS=<format>=<path>;<format>=<path>...
+#
+# Where <format> is the numeric value of the SDL_GPUShaderFormat.
+#
+# All integers are little-endian 32-bit values. The layout is:
+#
+#   magic ('TSSB'), version, entry count
+#   entry count x (format, offset, size)
+#   payloads
+#
+# Each payload starts at a multiple of 4 bytes since SPIR-V must be passed to
+# the driver as 32-bit words. Payloads are padded with zeros to get there.
+
+function(to_le32 VALUE OUT_VAR)
+  math(EXPR HEX "${VALUE}" OUTPUT_FORMAT HEXADECIMAL)
+  string(SUBSTRING "${HEX}" 2 -1 HEX)
+  string(LENGTH "${HEX}" HEX_LENGTH)
+  while(HEX_LENGTH LESS 8)
+    string(PREPEND HEX "0")
+    string(LENGTH "${HEX}" HEX_LENGTH)
+  endwhile()
+  string(SUBSTRING "${HEX}" 6 2 B0)
+  string(SUBSTRING "${HEX}" 4 2 B1)
+  string(SUBSTRING "${HEX}" 2 2 B2)
+  string(SUBSTRING "${HEX}" 0 2 B3)
+  set(${OUT_VAR} "${B0}${B1}${B2}${B3}" PARENT_SCOPE)
+endfunction()
+
+list(LENGTH INPUTS ENTRY_COUNT)
+
+to_le32(0x42535354 HEADER)
+to_le32(2 VERSION)
+string(APPEND HEADER "${VERSION}")
+to_le32(${ENTRY_COUNT} COUNT)
+string(APPEND HEADER "${COUNT}")
+
+math(EXPR OFFSET "12 + ${ENTRY_COUNT} * 12")
+set(PAYLOADS "")
+foreach(INPUT ${INPUTS})
+  string(FIND "${INPUT}" "=" SEPARATOR)
+  string(SUBSTRING "${INPUT}" 0 ${SEPARATOR} FORMAT)
+  math(EXPR PATH_START "${SEPARATOR} + 1")
+  string(SUBSTRING "${INPUT}" ${PATH_START} -1 PATH)
+  file(READ "${PATH}" PAYLOAD HEX)
+  string(LENGTH "${PAYLOAD}" PAYLOAD_LENGTH)
+  math(EXPR SIZE "${PAYLOAD_LENGTH} / 2")
+
+  to_le32(${FORMAT} ENTRY_FORMAT)
+  to_le32(${OFFSET} ENTRY_OFFSET)
+  to_le32(${SIZE} ENTRY_SIZE)
+  string(APPEND HEADER "${ENTRY_FORMAT}${ENTRY_OFFSET}${ENTRY_SIZE}")
+  string(APPEND PAYLOADS "${PAYLOAD}")
+  math(EXPR PADDED_SIZE "(${SIZE} + 3) / 4 * 4")
+  math(EXPR PADDING "${PADDED_SIZE} - ${SIZE}")
+  if(PADDING GREATER 0)
+    string(REPEAT "00" ${PADDING} PADDING_BYTES)
+    string(APPEND PAYLOADS "${PADDING_BYTES}")
+  endif()
+  math(EXPR OFFSET "${OFFSET} + ${PADDED_SIZE}")
+endforeach()
+
+set(BLOB "${HEADER}${PAYLOADS}")
+string(LENGTH "${BLOB}" BLOB_LENGTH)
+math(EXPR BLOB_SIZE "${BLOB_LENGTH} / 2")
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BLOB "${BLOB}")
+
+file(WRITE "${OUTPUT}.tmp"
+  "// Generated by shader_blob.cmake. Do not edit.\n"
+  "#pragma once\n\n"
+  "alignas(4) static const unsigned char ${SYMBOL}_data[] = {${BLOB}};\n"
+  "static const unsigned int ${SYMBOL}_length = ${BLOB_SIZE};\n"
+)
+file(COPY_FILE "${OUTPUT}.tmp" "${OUTPUT}" ONLY_IF_DIFFERENT)
+file(REMOVE "${OUTPUT}.tmp")
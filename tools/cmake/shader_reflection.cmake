@@ -0,0 +1,286 @@
+# This source file is part of Epoxy licensed under the MIT License.
+# See LICENSE.md file for details.
+
+# Turns the reflection JSON emitted by slangc into a header of constexpr
+# entrypoint descriptions. Invoked in script mode with:
+#
+#   -DINPUT=<reflection json path>
+#   -DOUTPUT=<header path>
+#   -DNAMESPACE=<C++ namespace for the shader>
+#   -DSOURCE=<shader file name used in the banner>
+#
+# Resource counts follow the SDL GPU conventions. Each category of resource
+# (samplers, storage textures, storage buffers and uniform buffers) is assigned
+# slots in declaration order and an entrypoint needs as many slots as the
+# highest slot it uses. The shaders pin these slots with vk::binding, so an
+# entrypoint that skips a lower slot must still declare it.
+
+set(CATEGORIES
+  samplers
+  storage_textures
+  storage_buffers
+  readwrite_storage_textures
+  readwrite_storage_buffers
+  uniform_buffers
+)
+
+macro(json_get OUT_VAR)
+  string(JSON ${OUT_VAR} ERROR_VARIABLE JSON_ERROR GET "${JSON}" ${ARGN})
+  if(JSON_ERROR)
+    set(${OUT_VAR} "")
+  endif()
+endmacro()
+
+macro(json_length OUT_VAR)
+  string(JSON ${OUT_VAR} ERROR_VARIABLE JSON_ERROR LENGTH "${JSON}" ${ARGN})
+  if(JSON_ERROR)
+    set(${OUT_VAR} 0)
+  endif()
+endmacro()
+
+# Combined texture-samplers like Sampler2D are samplers. Bare textures like
+# Texture2D are read-only storage textures.
+function(classify_parameter KIND BASE_SHAPE ACCESS COMBINED OUT_VAR)
+  set(CATEGORY "")
+  if(KIND STREQUAL "constantBuffer")
+    set(CATEGORY uniform_buffers)
+  elseif(KIND STREQUAL "resource")
+    if(BASE_SHAPE MATCHES "^texture")
+      if(ACCESS STREQUAL "readWrite")
+        set(CATEGORY readwrite_storage_textures)
+      elseif(COMBINED)
+        set(CATEGORY samplers)
+      else()
+        set(CATEGORY storage_textures)
+      endif()
+    elseif(BASE_SHAPE MATCHES "Buffer$")
+      if(ACCESS STREQUAL "readWrite")
+        set(CATEGORY readwrite_storage_buffers)
+      else()
+        set(CATEGORY storage_buffers)
+      endif()
+    endif()
+  endif()
+  set(${OUT_VAR} "${CATEGORY}" PARENT_SCOPE)
+endfunction()
+
+function(vertex_format SCALAR_TYPE ELEMENT_COUNT OUT_FORMAT OUT_SIZE)
+  if(SCALAR_TYPE STREQUAL "float32")
+    set(PREFIX FLOAT)
+  elseif(SCALAR_TYPE STREQUAL "int32")
+    set(PREFIX INT)
+  elseif(SCALAR_TYPE STREQUAL "uint32")
+    set(PREFIX UINT)
+  else()
+    message(FATAL_ERROR "Unsupported vertex input scalar type ${SCALAR_TYPE}.")
+  endif()
+  if(ELEMENT_COUNT EQUAL 1)
+    set(${OUT_FORMAT} "SDL_GPU_VERTEXELEMENTFORMAT_${PREFIX}" PARENT_SCOPE)
+  else()
+    set(${OUT_FORMAT} "SDL_GPU_VERTEXELEMENTFORMAT_${PREFIX}${ELEMENT_COUNT}"
+        PARENT_SCOPE)
+  endif()
+  math(EXPR SIZE "${ELEMENT_COUNT} * 4")
+  set(${OUT_SIZE} ${SIZE} PARENT_SCOPE)
+endfunction()
+
+file(READ "${INPUT}" JSON)
+
+# Assign slots to the global parameters.
+foreach(CATEGORY ${CATEGORIES})
+  set(NEXT_SLOT_${CATEGORY} 0)
+endforeach()
+set(PARAMETER_NAMES "")
+json_length(PARAMETER_COUNT parameters)
+if(PARAMETER_COUNT GREATER 0)
+  math(EXPR LAST_PARAMETER "${PARAMETER_COUNT} - 1")
+  foreach(INDEX RANGE ${LAST_PARAMETER})
+    json_get(NAME parameters ${INDEX} name)
+    json_get(KIND parameters ${INDEX} type kind)
+    json_get(BASE_SHAPE parameters ${INDEX} type baseShape)
+    json_get(ACCESS parameters ${INDEX} type access)
+    json_get(COMBINED parameters ${INDEX} type combined)
+    classify_parameter("${KIND}" "${BASE_SHAPE}" "${ACCESS}" "${COMBINED}"
+                       CATEGORY)
+    if(NOT CATEGORY)
+      continue()
+    endif()
+    list(APPEND PARAMETER_NAMES ${NAME})
+    set(CATEGORY_${NAME} ${CATEGORY})
+    set(SLOT_${NAME} ${NEXT_SLOT_${CATEGORY}})
+    math(EXPR NEXT_SLOT_${CATEGORY} "${NEXT_SLOT_${CATEGORY}} + 1")
+  endforeach()
+endif()
+
+set(BODY "")
+
+json_length(ENTRY_POINT_COUNT entryPoints)
+if(ENTRY_POINT_COUNT GREATER 0)
+  math(EXPR LAST_ENTRY_POINT "${ENTRY_POINT_COUNT} - 1")
+  foreach(ENTRY RANGE ${LAST_ENTRY_POINT})
+    json_get(ENTRY_NAME entryPoints ${ENTRY} name)
+    json_get(STAGE entryPoints ${ENTRY} stage)
+    if(STAGE STREQUAL "vertex")
+      set(STAGE_ENUM kVertex)
+    elseif(STAGE STREQUAL "fragment")
+      set(STAGE_ENUM kFragment)
+    elseif(STAGE STREQUAL "compute")
+      set(STAGE_ENUM kCompute)
+    else()
+      message(WARNING "Skipping entrypoint ${ENTRY_NAME} with stage ${STAGE}.")
+      continue()
+    endif()
+
+    # Thread group size.
+    set(THREADS "1, 1, 1")
+    json_length(THREAD_DIMENSIONS entryPoints ${ENTRY} threadGroupSize)
+    if(THREAD_DIMENSIONS EQUAL 3)
+      json_get(THREADS_X entryPoints ${ENTRY} threadGroupSize 0)
+      json_get(THREADS_Y entryPoints ${ENTRY} threadGroupSize 1)
+      json_get(THREADS_Z entryPoints ${ENTRY} threadGroupSize 2)
+      set(THREADS "${THREADS_X}, ${THREADS_Y}, ${THREADS_Z}")
+    endif()
+
+    # Resources used by the entrypoint. Older versions of Slang don't report
+    # per-entrypoint usage. Assume every global is used then.
+    set(USED_NAMES "")
+    json_length(BINDING_COUNT entryPoints ${ENTRY} bindings)
+    if(BINDING_COUNT GREATER 0)
+      math(EXPR LAST_BINDING "${BINDING_COUNT} - 1")
+      foreach(BINDING RANGE ${LAST_BINDING})
+        json_get(BINDING_NAME entryPoints ${ENTRY} bindings ${BINDING} name)
+        json_get(BINDING_USED
+                 entryPoints ${ENTRY} bindings ${BINDING} binding used)
+        if(BINDING_USED STREQUAL "" OR BINDING_USED)
+          list(APPEND USED_NAMES ${BINDING_NAME})
+        endif()
+      endforeach()
+    else()
+      set(USED_NAMES ${PARAMETER_NAMES})
+    endif()
+
+    foreach(CATEGORY ${CATEGORIES})
+      set(COUNT_${CATEGORY} 0)
+    endforeach()
+    foreach(NAME ${USED_NAMES})
+      if(NOT DEFINED CATEGORY_${NAME})
+        continue()
+      endif()
+      set(CATEGORY ${CATEGORY_${NAME}})
+      math(EXPR SLOT_COUNT "${SLOT_${NAME}} + 1")
+      if(SLOT_COUNT GREATER COUNT_${CATEGORY})
+        set(COUNT_${CATEGORY} ${SLOT_COUNT})
+      endif()
+    endforeach()
+
+    # Vertex inputs. Attributes are tightly packed in location order.
+    set(ATTRIBUTES "")
+    set(PITCH 0)
+    if(STAGE STREQUAL "vertex")
+      set(INPUTS "")
+      json_length(INPUT_COUNT entryPoints ${ENTRY} parameters)
+      if(INPUT_COUNT GREATER 0)
+        math(EXPR LAST_INPUT "${INPUT_COUNT} - 1")
+        foreach(INPUT_INDEX RANGE ${LAST_INPUT})
+          set(INPUT_PATH entryPoints ${ENTRY} parameters ${INPUT_INDEX})
+          json_get(INPUT_KIND ${INPUT_PATH} type kind)
+          set(FIELD_PATHS "")
+          if(INPUT_KIND STREQUAL "struct")
+            json_length(FIELD_COUNT ${INPUT_PATH} type fields)
+            if(FIELD_COUNT GREATER 0)
+              math(EXPR LAST_FIELD "${FIELD_COUNT} - 1")
+              foreach(FIELD RANGE ${LAST_FIELD})
+                list(APPEND FIELD_PATHS "${INPUT_INDEX}/type/fields/${FIELD}")
+              endforeach()
+            endif()
+          else()
+            list(APPEND FIELD_PATHS "${INPUT_INDEX}")
+          endif()
+          foreach(FIELD_PATH ${FIELD_PATHS})
+            string(REPLACE "/" ";" FIELD_PATH "${FIELD_PATH}")
+            set(FIELD_PATH entryPoints ${ENTRY} parameters ${FIELD_PATH})
+            json_get(BINDING_KIND ${FIELD_PATH} binding kind)
+            if(NOT BINDING_KIND STREQUAL "varyingInput")
+              continue()
+            endif()
+            json_get(LOCATION ${FIELD_PATH} binding index)
+            json_get(FIELD_KIND ${FIELD_PATH} type kind)
+            if(FIELD_KIND STREQUAL "vector")
+              json_get(ELEMENT_COUNT ${FIELD_PATH} type elementCount)
+              json_get(SCALAR_TYPE ${FIELD_PATH} type elementType scalarType)
+            elseif(FIELD_KIND STREQUAL "scalar")
+              set(ELEMENT_COUNT 1)
+              json_get(SCALAR_TYPE ${FIELD_PATH} type scalarType)
+            else()
+              message(FATAL_ERROR "Unsupported vertex input kind ${FIELD_KIND}.")
+            endif()
+            vertex_format("${SCALAR_TYPE}" ${ELEMENT_COUNT} FORMAT SIZE)
+            string(LENGTH "${LOCATION}" LOCATION_LENGTH)
+            set(SORT_KEY "${LOCATION}")
+            while(LOCATION_LENGTH LESS 4)
+              string(PREPEND SORT_KEY "0")
+              string(LENGTH "${SORT_KEY}" LOCATION_LENGTH)
+            endwhile()
+            list(APPEND INPUTS "${SORT_KEY}|${LOCATION}|${FORMAT}|${SIZE}")
+          endforeach()
+        endforeach()
+      endif()
+      list(SORT INPUTS)
+      foreach(VERTEX_INPUT ${INPUTS})
+        string(REPLACE "|" ";" VERTEX_INPUT "${VERTEX_INPUT}")
+        list(GET VERTEX_INPUT 1 LOCATION)
+        list(GET VERTEX_INPUT 2 FORMAT)
+        list(GET VERTEX_INPUT 3 SIZE)
+        string(APPEND ATTRIBUTES
+          "    SDL_GPUVertexAttribute{\n"
+          "        .location = ${LOCATION},\n"
+          "        .buffer_slot = 0,\n"
+          "        .format = ${FORMAT},\n"
+          "        .offset = ${PITCH},\n"
+          "    },\n"
+        )
+        math(EXPR PITCH "${PITCH} + ${SIZE}")
+      endforeach()
+    endif()
+
+    set(ATTRIBUTES_SPAN "{}")
+    if(ATTRIBUTES)
+      string(APPEND BODY
+        "inline constexpr SDL_GPUVertexAttribute k${ENTRY_NAME}Attributes[] = {\n"
+        "${ATTRIBUTES}"
+        "};\n\n"
+      )
+      set(ATTRIBUTES_SPAN "k${ENTRY_NAME}Attributes")
+    endif()
+
+    string(APPEND BODY
+      "inline constexpr EntryPointReflection k${ENTRY_NAME} = {\n"
+      "    .name = \"${ENTRY_NAME}\",\n"
+      "    .stage = ShaderStage::${STAGE_ENUM},\n"
+      "    .resources =\n"
+      "        {\n"
+      "            .num_samplers = ${COUNT_samplers},\n"
+      "            .num_storage_textures = ${COUNT_storage_textures},\n"
+      "            .num_storage_buffers = ${COUNT_storage_buffers},\n"
+      "            .num_readwrite_storage_textures = ${COUNT_readwrite_storage_textures},\n"
+      "            .num_readwrite_storage_buffers = ${COUNT_readwrite_storage_buffers},\n"
+      "            .num_uniform_buffers = ${COUNT_uniform_buffers},\n"
+      "        },\n"
+      "    .thread_count = {${THREADS}},\n"
+      "    .vertex_attributes = ${ATTRIBUTES_SPAN},\n"
+      "    .vertex_pitch = ${PITCH},\n"
+      "};\n\n"
+    )
+  endforeach()
+endif()
+
+file(WRITE "${OUTPUT}.tmp"
+  "// Generated by shader_reflection.cmake from ${SOURCE}. Do not edit.\n"
+  "#pragma once\n\n"
+  "#include \"shader_reflection.h\"\n\n"
+  "namespace ${NAMESPACE} {\n\n"
+  "${BODY}"
+  "}  // namespace ${NAMESPACE}\n"
+)
+file(COPY_FILE "${OUTPUT}.tmp" "${OUTPUT}" ONLY_IF_DIFFERENT)
+file(REMOVE "${OUTPUT}.tmp")